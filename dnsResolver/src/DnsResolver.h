@@ -12,7 +12,9 @@
 #include <algorithm>
 #include <stdexcept>
 #include <random>
+#include "../../lib/BufferPool.h"
 #include "../../lib/FileDesc.h"
+#include "../../lib/Logger.h"
 
 enum class DnsRecordType : uint16_t
 {
@@ -37,6 +39,13 @@ struct DnsResource
     std::vector<uint8_t> Data;
 };
 
+// Адреса из ответа и минимальный TTL среди записей, по которым они получены
+struct DnsAnswer
+{
+    std::vector<std::string> Addresses;
+    uint32_t TTL = 0;
+};
+
 struct DnsResponse
 {
     std::vector<DnsResource> Answers;
@@ -56,9 +65,14 @@ public:
     }
 
     std::vector<std::string> Resolve(const std::string& domain, DnsRecordType recordType)
+    {
+        return ResolveAnswer(domain, recordType).Addresses;
+    }
+
+    DnsAnswer ResolveAnswer(const std::string& domain, DnsRecordType recordType)
     {
         if (m_debugMode)
-            Log("Starting iterative DNS resolution for domain: " + domain + ", type: " + TypeToString(recordType));
+            LOG_INFO("DNS", "Starting iterative DNS resolution for domain: " + domain + ", type: " + TypeToString(recordType));
 
         try
         {
@@ -66,10 +80,11 @@ public:
 
             if (m_debugMode)
             {
-                if (result.empty())
-                    Log("DNS resolution failed for domain: " + domain);
+                if (result.Addresses.empty())
+                    LOG_INFO("DNS", "DNS resolution failed for domain: " + domain);
                 else
-                    Log("DNS resolution successful. Found " + std::to_string(result.size()) + " addresses");
+                    LOG_INFO("DNS", "DNS resolution successful. Found " + std::to_string(result.Addresses.size())
+                        + " addresses, TTL " + std::to_string(result.TTL));
             }
 
             return result;
@@ -77,7 +92,7 @@ public:
         catch (const std::exception& e)
         {
             if (m_debugMode)
-                Log("Error during DNS resolution: " + std::string(e.what()));
+                LOG_INFO("DNS", "Error during DNS resolution: " + std::string(e.what()));
             return {};
         }
     }
@@ -92,18 +107,18 @@ private:
     class DnsPacketReader
     {
     public:
-        explicit DnsPacketReader(const std::vector<uint8_t>& data)
-                : m_data(data), m_offset(0) {}
+        explicit DnsPacketReader(const BufferSlice& data)
+                : m_data(data.Data()), m_size(data.Size()), m_offset(0) {}
 
         uint8_t ReadU8()
         {
-            if (m_offset >= m_data.size()) throw std::runtime_error("Unexpected end of packet (U8)");
+            if (m_offset >= m_size) throw std::runtime_error("Unexpected end of packet (U8)");
             return m_data[m_offset++];
         }
 
         uint16_t ReadU16()
         {
-            if (m_offset + 2 > m_data.size()) throw std::runtime_error("Unexpected end of packet (U16)");
+            if (m_offset + 2 > m_size) throw std::runtime_error("Unexpected end of packet (U16)");
             uint16_t value;
             std::memcpy(&value, &m_data[m_offset], 2);
             m_offset += 2;
@@ -112,7 +127,7 @@ private:
 
         uint32_t ReadU32()
         {
-            if (m_offset + 4 > m_data.size()) throw std::runtime_error("Unexpected end of packet (U32)");
+            if (m_offset + 4 > m_size) throw std::runtime_error("Unexpected end of packet (U32)");
             uint32_t value;
             std::memcpy(&value, &m_data[m_offset], 4);
             m_offset += 4;
@@ -121,15 +136,15 @@ private:
 
         std::vector<uint8_t> ReadBytes(size_t length)
         {
-            if (m_offset + length > m_data.size()) throw std::runtime_error("Unexpected end of packet (Bytes)");
-            std::vector<uint8_t> bytes(m_data.begin() + m_offset, m_data.begin() + m_offset + length);
+            if (m_offset + length > m_size) throw std::runtime_error("Unexpected end of packet (Bytes)");
+            std::vector<uint8_t> bytes(m_data + m_offset, m_data + m_offset + length);
             m_offset += length;
             return bytes;
         }
 
         void Skip(size_t count)
         {
-            if (m_offset + count > m_data.size()) throw std::runtime_error("Unexpected end of packet (Skip)");
+            if (m_offset + count > m_size) throw std::runtime_error("Unexpected end of packet (Skip)");
             m_offset += count;
         }
 
@@ -138,13 +153,13 @@ private:
             std::string name;
             while (true)
             {
-                if (m_offset >= m_data.size()) throw std::runtime_error("Unexpected end of packet (Name)");
+                if (m_offset >= m_size) throw std::runtime_error("Unexpected end of packet (Name)");
 
                 uint8_t len = m_data[m_offset];
 
                 if ((len & 0xC0) == 0xC0)
                 {
-                    if (m_offset + 1 >= m_data.size()) throw std::runtime_error("Unexpected end of packet (Ptr)");
+                    if (m_offset + 1 >= m_size) throw std::runtime_error("Unexpected end of packet (Ptr)");
 
                     uint16_t pointer = ((len & 0x3F) << 8) | m_data[m_offset + 1];
                     m_offset += 2;
@@ -163,7 +178,7 @@ private:
                 else
                 {
                     m_offset++;
-                    if (m_offset + len > m_data.size()) throw std::runtime_error("Invalid label length");
+                    if (m_offset + len > m_size) throw std::runtime_error("Invalid label length");
 
                     if (!name.empty()) name += ".";
                     name.append(reinterpret_cast<const char*>(&m_data[m_offset]), len);
@@ -175,7 +190,7 @@ private:
         size_t GetOffset() const { return m_offset; }
         void SetOffset(size_t offset)
         {
-            if (offset > m_data.size()) throw std::runtime_error("Offset out of bounds");
+            if (offset > m_size) throw std::runtime_error("Offset out of bounds");
             m_offset = offset;
         }
 
@@ -189,13 +204,13 @@ private:
 
             while (true)
             {
-                if (current >= m_data.size()) throw std::runtime_error("Unexpected end of packet (At)");
+                if (current >= m_size) throw std::runtime_error("Unexpected end of packet (At)");
 
                 uint8_t len = m_data[current];
 
                 if ((len & 0xC0) == 0xC0)
                 {
-                    if (current + 1 >= m_data.size()) throw std::runtime_error("Unexpected end of packet (AtPtr)");
+                    if (current + 1 >= m_size) throw std::runtime_error("Unexpected end of packet (AtPtr)");
                     uint16_t pointer = ((len & 0x3F) << 8) | m_data[current + 1];
 
                     std::string suffix = ReadNameAt(pointer, recursionDepth + 1);
@@ -210,7 +225,7 @@ private:
                 else
                 {
                     current++;
-                    if (current + len > m_data.size()) throw std::runtime_error("Invalid label length (At)");
+                    if (current + len > m_size) throw std::runtime_error("Invalid label length (At)");
 
                     if (!name.empty()) name += ".";
                     name.append(reinterpret_cast<const char*>(&m_data[current]), len);
@@ -219,18 +234,14 @@ private:
             }
         }
 
-        const std::vector<uint8_t>& m_data;
+        const uint8_t* m_data;
+        size_t m_size;
         size_t m_offset;
     };
 
-    void Log(const std::string& message) const
-    {
-        std::cout << "[DNS] " << message << std::endl;
-    }
-
-    std::vector<std::string> ResolveIterative(const std::string& domain, DnsRecordType recordType)
+    DnsAnswer ResolveIterative(const std::string& domain, DnsRecordType recordType)
     {
-        if (m_debugMode) Log("Starting iterative resolution from root servers");
+        if (m_debugMode) LOG_INFO("DNS", "Starting iterative resolution from root servers");
 
         auto rootServers = GetRootServers();
         std::shuffle(rootServers.begin(), rootServers.end(), m_randomEngine);
@@ -238,18 +249,18 @@ private:
         return ResolveRecursive(domain, recordType, rootServers, 0);
     }
 
-    std::vector<std::string> ResolveRecursive(const std::string& domain, DnsRecordType recordType,
+    DnsAnswer ResolveRecursive(const std::string& domain, DnsRecordType recordType,
                                               const std::vector<std::string>& servers, int depth)
     {
         if (depth >= MAX_RECURSION_DEPTH)
         {
-            if (m_debugMode) Log("Max recursion depth reached");
+            if (m_debugMode) LOG_INFO("DNS", "Max recursion depth reached");
             return {};
         }
 
         for (const auto& server : servers)
         {
-            if (m_debugMode) Log("Querying server: " + server + " for domain: " + domain);
+            if (m_debugMode) LOG_INFO("DNS", "Querying server: " + server + " for domain: " + domain);
 
             try
             {
@@ -257,13 +268,13 @@ private:
 
                 if (!response.Answers.empty())
                 {
-                    if (m_debugMode) Log("Found " + std::to_string(response.Answers.size()) + " answers");
-                    return ExtractAddresses(response.Answers, recordType);
+                    if (m_debugMode) LOG_INFO("DNS", "Found " + std::to_string(response.Answers.size()) + " answers");
+                    return ExtractAnswer(response.Answers, recordType);
                 }
 
                 if (!response.Authority.empty())
                 {
-                    if (m_debugMode) Log("Found " + std::to_string(response.Authority.size()) + " authority records");
+                    if (m_debugMode) LOG_INFO("DNS", "Found " + std::to_string(response.Authority.size()) + " authority records");
 
                     auto nextLevelServers = ExtractNameServers(response.Authority);
                     if (!nextLevelServers.empty())
@@ -272,7 +283,7 @@ private:
                         if (!nextLevelIPs.empty())
                         {
                             auto result = ResolveRecursive(domain, recordType, nextLevelIPs, depth + 1);
-                            if (!result.empty()) return result;
+                            if (!result.Addresses.empty()) return result;
                         }
                     }
                 }
@@ -283,13 +294,13 @@ private:
                     if (!additionalIPs.empty())
                     {
                         auto result = ResolveRecursive(domain, recordType, additionalIPs, depth + 1);
-                        if (!result.empty()) return result;
+                        if (!result.Addresses.empty()) return result;
                     }
                 }
             }
             catch (const std::exception& e)
             {
-                if (m_debugMode) Log("Failed to query server " + server + ": " + e.what());
+                if (m_debugMode) LOG_INFO("DNS", "Failed to query server " + server + ": " + e.what());
             }
         }
 
@@ -310,7 +321,7 @@ private:
             }
             catch (...)
             {
-                if (m_debugMode) Log("Skipping resolution for nameserver: " + serverName);
+                if (m_debugMode) LOG_INFO("DNS", "Skipping resolution for nameserver: " + serverName);
             }
         }
         return serverIPs;
@@ -329,7 +340,7 @@ private:
             }
             catch (const std::exception& e)
             {
-                if (m_debugMode) Log("Failed to resolve nameserver IP via " + server + ": " + e.what());
+                if (m_debugMode) LOG_INFO("DNS", "Failed to resolve nameserver IP via " + server + ": " + e.what());
             }
         }
         throw std::runtime_error("Failed to resolve IP for server: " + serverName);
@@ -360,13 +371,15 @@ private:
             throw std::runtime_error("Failed to send DNS query");
         }
 
-        std::vector<uint8_t> buffer(512);
-        ssize_t received = recvfrom(sockFd.Get(), buffer.data(), buffer.size(), 0, nullptr, nullptr);
+        // Ответ по UDP не длиннее 512 байт (RFC 1035), блок пула потока вмещает его целиком
+        BufferSlice buffer = BufferPool::Local().Acquire();
+        buffer.Resize(512);
+        ssize_t received = recvfrom(sockFd.Get(), buffer.Data(), buffer.Size(), 0, nullptr, nullptr);
 
         if (received < 0) throw std::runtime_error("Failed to receive DNS response");
 
-        buffer.resize(received);
-        if (m_debugMode) Log("Received response: " + std::to_string(received) + " bytes from " + server);
+        buffer.Resize(received);
+        if (m_debugMode) LOG_INFO("DNS", "Received response: " + std::to_string(received) + " bytes from " + server);
 
         return ParseDnsResponse(buffer);
     }
@@ -432,7 +445,7 @@ private:
         return query;
     }
 
-    DnsResponse ParseDnsResponse(const std::vector<uint8_t>& data)
+    DnsResponse ParseDnsResponse(const BufferSlice& data)
     {
         DnsResponse response;
         DnsPacketReader reader(data);
@@ -512,6 +525,22 @@ private:
         return addresses;
     }
 
+    DnsAnswer ExtractAnswer(const std::vector<DnsResource>& resources, DnsRecordType recordType)
+    {
+        DnsAnswer answer;
+        answer.Addresses = ExtractAddresses(resources, recordType);
+        bool first = true;
+        for (const auto& res : resources)
+        {
+            if (res.Type == recordType || res.Type == DnsRecordType::CNAME)
+            {
+                answer.TTL = first ? res.TTL : std::min(answer.TTL, res.TTL);
+                first = false;
+            }
+        }
+        return answer;
+    }
+
     std::vector<std::string> ExtractNameServers(const std::vector<DnsResource>& resources)
     {
         std::vector<std::string> nameServers;
@@ -0,0 +1,61 @@
+#pragma once
+#include "../lib/Acceptor.h"
+#include "../lib/Socket.h"
+#include "../lib/Logger.h"
+#include "ProxyMetrics.h"
+#include <sys/time.h>
+#include <string>
+
+// Служебный HTTP-порт: GET /metrics отдаёт метрики в формате Prometheus.
+// Запросов здесь единицы в минуту, поэтому хватает одного блокирующего потока вне циклов событий
+class AdminServer {
+public:
+    AdminServer(const sockaddr_in& addr, const ProxyMetrics& metrics)
+            : m_acceptor(addr, SOMAXCONN), m_metrics(metrics) {}
+
+    [[noreturn]] void Run() {
+        while (true) {
+            try {
+                Socket client = m_acceptor.Accept();
+                Serve(client);
+            } catch (const std::exception& e) {
+                LOG_ERROR("Proxy", "Admin handler error: " + std::string(e.what()));
+            }
+        }
+    }
+
+private:
+    static constexpr size_t MaxRequestSize = 8192;
+
+    void Serve(Socket& client) {
+        // Зависший клиент не должен навсегда занять единственный поток
+        timeval timeout{5, 0};
+        setsockopt(client.Get(), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        std::string request;
+        char buffer[1024];
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < MaxRequestSize) {
+            const size_t bytesRead = client.Read(buffer, sizeof(buffer));
+            if (bytesRead == 0) return;
+            request.append(buffer, bytesRead);
+        }
+
+        std::string status = "200 OK";
+        std::string body;
+        if (request.rfind("GET /metrics ", 0) == 0 || request.rfind("GET /metrics?", 0) == 0) {
+            body = m_metrics.Render();
+        } else {
+            status = "404 Not Found";
+            body = "Not Found\n";
+        }
+        const std::string head = "HTTP/1.1 " + status + "\r\n"
+                                 "Content-Type: text/plain; version=0.0.4\r\n"
+                                 "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                                 "Connection: close\r\n\r\n";
+        iovec iov[2] = {{const_cast<char*>(head.data()), head.size()}, {body.data(), body.size()}};
+        client.SendV(iov, 2);
+    }
+
+    Acceptor m_acceptor;
+    const ProxyMetrics& m_metrics;
+};
@@ -0,0 +1,209 @@
+#pragma once
+#include "../lib/EventLoop.h"
+#include "../lib/FileDesc.h"
+#include "CacheWriter.h"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Заполнение записи кэша, которое идёт прямо сейчас. Данные с сервера передаёт один «ведущий» запрос,
+// а остальные клиенты этого URL подписываются и дочитывают файл по мере его роста.
+// Клиент ведущего получает ответ из памяти и переходит на файл, только если отстал от сервера.
+// На диск данные пишет CacheWriter: ведущий только ставит их в ограниченную очередь
+class CacheFill : public std::enable_shared_from_this<CacheFill> {
+public:
+    // Подписчик живёт в своём цикле событий; уведомление доставляется туда через Post
+    class Waiter {
+    public:
+        Waiter(EventLoop& loop, std::function<void()> onProgress)
+                : m_loop(loop), m_onProgress(std::move(onProgress)) {}
+
+        void Notify() {
+            // Пока прошлое уведомление не обработано, новое не ставим: подписчик всё равно прочитает всё до конца
+            if (m_pending.exchange(true)) return;
+            m_loop.Post([self = m_self.lock()] {
+                self->m_pending = false;
+                self->m_onProgress();
+            });
+        }
+
+    private:
+        friend class CacheFill;
+        EventLoop& m_loop;
+        std::function<void()> m_onProgress;
+        std::atomic<bool> m_pending = false;
+        std::weak_ptr<Waiter> m_self;
+    };
+
+    // Сколько байт может ждать записи на диск, прежде чем ведущий перестанет читать сервер
+    static constexpr size_t MaxQueuedBytes = 1024 * 1024;
+
+    using OnWritten = std::function<void(CacheFill&)>;
+
+    CacheFill(std::string path, FileDesc fd, off_t bodyOffset, CacheWriter& writer)
+            : m_path(std::move(path)), m_fd(std::move(fd)), m_bodyOffset(bodyOffset), m_writer(writer) {}
+
+    const std::string& Path() const { return m_path; }
+    // Ответ сервера лежит в файле начиная с этого смещения; Written() считается от него
+    off_t BodyOffset() const { return m_bodyOffset; }
+
+    // Вызывается только ведущим запросом. Данные копируются в очередь, запись идёт в потоке CacheWriter
+    void Append(const char* data, size_t size) {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        if (m_state.load(std::memory_order_relaxed) != State::Filling) return;
+        // Мелкие порции склеиваются: хвост очереди писатель ещё не забрал
+        if (m_queue.empty() || m_queue.back().size() >= ChunkSize) {
+            m_queue.emplace_back();
+            m_queue.back().reserve(ChunkSize);
+        }
+        m_queue.back().append(data, size);
+        m_queued.fetch_add(size, std::memory_order_relaxed);
+        ScheduleLocked();
+    }
+
+    // Ведущему пора приостановить чтение сервера; о продвижении записи он узнает через свою подписку
+    bool HasRoom() const { return m_queued.load(std::memory_order_relaxed) < MaxQueuedBytes; }
+
+    // Ответ получен целиком. Когда очередь будет записана, файл закрывается и вызывается onWritten
+    // (в потоке CacheWriter), затем подписчики узнают о завершении
+    void Finish(OnWritten onWritten) {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_onWritten = std::move(onWritten);
+        m_finishing = true;
+        ScheduleLocked();
+    }
+
+    void Fail() {
+        {
+            std::lock_guard<std::mutex> lock(m_queueMutex);
+            m_queue.clear();
+            m_state.store(State::Failed, std::memory_order_release);
+        }
+        NotifyAll();
+    }
+
+    // Сначала читайте состояние, потом Written(): у завершённого заполнения размер уже окончательный
+    bool IsFinished() const { return m_state.load(std::memory_order_acquire) == State::Finished; }
+    bool IsFailed() const { return m_state.load(std::memory_order_acquire) == State::Failed; }
+    uint64_t Written() const { return m_written.load(std::memory_order_acquire); }
+
+    // Сколько подписчиков ещё живо, включая ведущего
+    size_t Subscribers() {
+        std::lock_guard<std::mutex> lock(m_waitersMutex);
+        return static_cast<size_t>(std::count_if(m_waiters.begin(), m_waiters.end(),
+                                                 [](const std::weak_ptr<Waiter>& waiter) { return !waiter.expired(); }));
+    }
+
+    std::shared_ptr<Waiter> Subscribe(EventLoop& loop, std::function<void()> onProgress) {
+        auto waiter = std::make_shared<Waiter>(loop, std::move(onProgress));
+        waiter->m_self = waiter;
+        std::lock_guard<std::mutex> lock(m_waitersMutex);
+        m_waiters.push_back(waiter);
+        return waiter;
+    }
+
+private:
+    enum class State { Filling, Finished, Failed };
+
+    static constexpr size_t ChunkSize = 64 * 1024;
+
+    void ScheduleLocked() {
+        if (m_scheduled) return;
+        m_scheduled = true;
+        m_writer.Submit([self = shared_from_this()] { self->Drain(); });
+    }
+
+    // Выполняется в потоке CacheWriter; одновременно для одного заполнения работает не больше одного Drain
+    void Drain() {
+        while (true) {
+            std::string chunk;
+            OnWritten onWritten;
+            bool complete = false;
+            {
+                std::lock_guard<std::mutex> lock(m_queueMutex);
+                if (m_queue.empty()) {
+                    m_scheduled = false;
+                    if (!m_finishing) return;
+                    onWritten = std::move(m_onWritten);
+                    m_finishing = false;
+                    complete = true;
+                } else {
+                    chunk = std::move(m_queue.front());
+                    m_queue.pop_front();
+                }
+            }
+            if (complete) {
+                Complete(onWritten);
+                return;
+            }
+            if (!Write(chunk)) {
+                Fail();
+                return;
+            }
+            m_queued.fetch_sub(chunk.size(), std::memory_order_relaxed);
+            NotifyAll();
+        }
+    }
+
+    bool Write(const std::string& chunk) {
+        const char* data = chunk.data();
+        size_t size = chunk.size();
+        while (size > 0) {
+            const ssize_t written = write(m_fd.Get(), data, size);
+            if (written == -1) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+            m_written.fetch_add(static_cast<uint64_t>(written), std::memory_order_release);
+        }
+        return true;
+    }
+
+    void Complete(const OnWritten& onWritten) {
+        // Ошибка close после записи значит, что данные могли не дойти до файла. Исключение из потока
+        // писателя завершило бы процесс, поэтому сбой только отмечается, и файл не публикуется
+        const int fd = m_fd.Release();
+        if (fd != -1 && close(fd) != 0) Fail();
+        // onWritten видит IsFailed(), если запись не удалась, и тогда не публикует файл
+        if (onWritten) onWritten(*this);
+        if (!IsFailed()) m_state.store(State::Finished, std::memory_order_release);
+        NotifyAll();
+    }
+
+    void NotifyAll() {
+        std::lock_guard<std::mutex> lock(m_waitersMutex);
+        auto it = m_waiters.begin();
+        while (it != m_waiters.end()) {
+            if (auto waiter = it->lock()) {
+                waiter->Notify();
+                ++it;
+            } else {
+                it = m_waiters.erase(it);
+            }
+        }
+    }
+
+    std::string m_path;
+    FileDesc m_fd;
+    off_t m_bodyOffset;
+    CacheWriter& m_writer;
+    std::atomic<uint64_t> m_written = 0;
+    std::atomic<State> m_state = State::Filling;
+
+    std::mutex m_queueMutex;
+    std::deque<std::string> m_queue;
+    std::atomic<size_t> m_queued = 0;
+    bool m_scheduled = false;
+    bool m_finishing = false;
+    OnWritten m_onWritten;
+
+    std::mutex m_waitersMutex;
+    std::vector<std::weak_ptr<Waiter>> m_waiters;
+};
@@ -0,0 +1,95 @@
+#pragma once
+#include "CachePolicy.h"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Индекс записей дискового кэша: метаданные и LRU-порядок для вытеснения по общему лимиту байт.
+// В отличие от MemoryCache, не шардирован: лимит делится на доли, и крупные файлы не поместились бы
+// ни в один шард, а обращения к индексу и так редки по сравнению с операциями над файлами
+class CacheIndex {
+public:
+    using Entry = std::shared_ptr<const CacheMetadata>;
+
+    explicit CacheIndex(uint64_t budgetBytes)
+            : m_budget(budgetBytes) {}
+
+    Entry Find(const std::string& url) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_index.find(url);
+        if (it == m_index.end()) return nullptr;
+        m_lru.splice(m_lru.begin(), m_lru, it->second);
+        return *it->second;
+    }
+
+    // Возвращает URL записей, вытесненных ради новой: их файлы удаляет вызывающий
+    std::vector<std::string> Insert(Entry entry) {
+        std::vector<std::string> evicted;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        EraseLocked(entry->url);
+        if (entry->size > m_budget) {
+            evicted.push_back(entry->url);
+            return evicted;
+        }
+        while (m_bytes + entry->size > m_budget) {
+            evicted.push_back(m_lru.back()->url);
+            EraseLocked(evicted.back());
+        }
+        m_bytes += entry->size;
+        m_lru.push_front(entry);
+        m_index[entry->url] = m_lru.begin();
+        return evicted;
+    }
+
+    // Заменяет метаданные существующей записи (после ответа 304), не меняя её размер
+    void Update(Entry entry) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_index.find(entry->url);
+        if (it == m_index.end()) return;
+        *it->second = std::move(entry);
+        m_lru.splice(m_lru.begin(), m_lru, it->second);
+    }
+
+    bool Remove(const std::string& url) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return EraseLocked(url);
+    }
+
+    // Удаляет запись, только если в индексе всё ещё expected, а не заменившая её версия
+    bool Remove(const std::string& url, const Entry& expected) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_index.find(url);
+        if (it == m_index.end() || *it->second != expected) return false;
+        return EraseLocked(url);
+    }
+
+    size_t Size() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_lru.size();
+    }
+
+    // Все записи от давно не использованных к недавним
+    std::vector<Entry> Snapshot() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return {m_lru.rbegin(), m_lru.rend()};
+    }
+
+private:
+    bool EraseLocked(const std::string& url) {
+        auto it = m_index.find(url);
+        if (it == m_index.end()) return false;
+        m_bytes -= (*it->second)->size;
+        m_lru.erase(it->second);
+        m_index.erase(it);
+        return true;
+    }
+
+    uint64_t m_budget;
+    std::mutex m_mutex;
+    std::list<Entry> m_lru;
+    std::unordered_map<std::string, std::list<Entry>::iterator> m_index;
+    uint64_t m_bytes = 0;
+};
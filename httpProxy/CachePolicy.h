@@ -0,0 +1,103 @@
+#pragma once
+#include "HttpUtils.h"
+#include "../lib/HttpRange.h"
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+// Метаданные записи кэша: свежесть и валидаторы для условного GET
+struct CacheMetadata {
+    std::string url;
+    uint64_t size = 0;
+    int64_t storedAt = 0;
+    int64_t freshUntil = 0;
+    std::string etag;
+    std::string lastModified;
+
+    bool IsFresh(int64_t now) const { return now < freshUntil; }
+    bool HasValidators() const { return !etag.empty() || !lastModified.empty(); }
+};
+
+// Правила кэширования общего (shared) кэша по RFC 9111, в упрощённом виде
+class CachePolicy {
+public:
+    // Без явного срока и без Last-Modified ответ считается свежим столько секунд
+    static constexpr int64_t DefaultFreshness = 60;
+    static constexpr int64_t MaxHeuristicFreshness = 24 * 60 * 60;
+
+    static bool IsStorable(const ResponseHeaders& headers) {
+        if (headers.statusCode != 200) return false;
+        return !HasDirective(headers.cacheControl, "no-store") && !HasDirective(headers.cacheControl, "private");
+    }
+
+    static int64_t FreshUntil(const ResponseHeaders& headers, int64_t now) {
+        if (HasDirective(headers.cacheControl, "no-cache") || headers.pragma.find("no-cache") != std::string::npos) {
+            return now;
+        }
+
+        const int64_t age = headers.age.empty() ? 0 : ParseNumber(headers.age).value_or(0);
+        if (auto sMaxAge = DirectiveValue(headers.cacheControl, "s-maxage")) {
+            return now + *sMaxAge - age;
+        }
+        if (auto maxAge = DirectiveValue(headers.cacheControl, "max-age")) {
+            return now + *maxAge - age;
+        }
+
+        const int64_t date = ParseHttpDate(headers.date).value_or(now);
+        if (!headers.expires.empty()) {
+            // Некорректный Expires (например, "0") означает «уже устарел»
+            const auto expires = ParseHttpDate(headers.expires);
+            return expires ? now + (*expires - date) : now;
+        }
+        if (auto lastModified = ParseHttpDate(headers.lastModified); lastModified && *lastModified < date) {
+            // Эвристика: 10% от времени, прошедшего с последнего изменения
+            return now + std::min((date - *lastModified) / 10, MaxHeuristicFreshness);
+        }
+        return now + DefaultFreshness;
+    }
+
+    static std::optional<int64_t> ParseHttpDate(const std::string& value) {
+        return HttpRange::ParseHttpDate(value);
+    }
+
+private:
+    static constexpr int64_t MaxDeltaSeconds = 2147483648;
+
+    static bool HasDirective(const std::string& cacheControl, const std::string& name) {
+        return FindDirective(cacheControl, name) != std::string::npos;
+    }
+
+    static std::optional<int64_t> DirectiveValue(const std::string& cacheControl, const std::string& name) {
+        const size_t pos = FindDirective(cacheControl, name);
+        if (pos == std::string::npos || pos + name.size() >= cacheControl.size() || cacheControl[pos + name.size()] != '=') {
+            return std::nullopt;
+        }
+        return ParseNumber(cacheControl.substr(pos + name.size() + 1));
+    }
+
+    // Ищет директиву целиком, чтобы "max-age" не находился внутри "s-maxage"
+    static size_t FindDirective(const std::string& cacheControl, const std::string& name) {
+        size_t pos = 0;
+        while ((pos = cacheControl.find(name, pos)) != std::string::npos) {
+            const bool startOk = pos == 0 || cacheControl[pos - 1] == ',' || cacheControl[pos - 1] == ' ';
+            const size_t after = pos + name.size();
+            const bool endOk = after == cacheControl.size() || cacheControl[after] == ',' || cacheControl[after] == '='
+                               || cacheControl[after] == ' ';
+            if (startOk && endOk) return pos;
+            pos = after;
+        }
+        return std::string::npos;
+    }
+
+    // delta-seconds больше 2^31 считаются равными 2^31 (RFC 9111, 1.2.2): длинное число не переполнит результат
+    static std::optional<int64_t> ParseNumber(const std::string& value) {
+        int64_t result = 0;
+        size_t i = 0;
+        for (; i < value.size() && value[i] >= '0' && value[i] <= '9'; ++i) {
+            result = std::min(result * 10 + (value[i] - '0'), MaxDeltaSeconds);
+        }
+        if (i == 0) return std::nullopt;
+        return result;
+    }
+};
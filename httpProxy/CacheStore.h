@@ -0,0 +1,358 @@
+#pragma once
+#include "../lib/FileDesc.h"
+#include "CachePolicy.h"
+#include "Sha256.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <dirent.h>
+#include <fcntl.h>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// Файлы кэша на диске.
+//   ./cache/ab/abcdef...  — запись: заголовок HeaderSize байт, затем ответ сервера байт-в-байт.
+//                           Имя — SHA-256 от URL, в заголовке лежит сам URL и метаданные
+//   ./cache/tmp/          — заполняемые записи; в постоянное имя попадают только через rename
+//   ./cache/journal       — журнал добавлений и удалений, по нему индекс восстанавливается при старте
+class CacheStore {
+public:
+    using Entry = std::shared_ptr<const CacheMetadata>;
+
+    // Заголовок фиксированного размера можно переписать на месте, не трогая тело
+    static constexpr size_t HeaderSize = 4096;
+
+    explicit CacheStore(fs::path dir)
+            : m_dir(std::move(dir)) {
+        fs::create_directories(m_dir / "tmp");
+    }
+
+    std::string EntryPath(const std::string& url) const {
+        const std::string hash = Sha256::HexHash(url);
+        return (m_dir / hash.substr(0, 2) / hash).string();
+    }
+
+    // Временный файл для новой записи; место под заголовок уже пропущено
+    FileDesc CreateTemp(std::string& path) {
+        path = (m_dir / "tmp" / std::to_string(m_tempCounter.fetch_add(1))).string();
+        FileDesc fd(open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+        if (!fd.IsOpen() && errno == ENOENT) {
+            // Каталог могли удалить вручную, пока прокси работает
+            std::error_code ec;
+            fs::create_directories(m_dir / "tmp", ec);
+            fd = FileDesc(open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+        }
+        if (!fd.IsOpen() || lseek(fd.Get(), static_cast<off_t>(HeaderSize), SEEK_SET) == -1) {
+            throw std::system_error(errno, std::generic_category());
+        }
+        return fd;
+    }
+
+    // Дописывает заголовок и атомарно подменяет запись: читатель видит либо старую версию, либо новую целиком.
+    // Данные доходят до диска раньше rename, а rename — раньше записи в журнал: после сбоя под постоянным
+    // именем не окажется пустого или недописанного файла
+    bool Publish(const std::string& tempPath, const CacheMetadata& meta) {
+        const fs::path path = EntryPath(meta.url);
+        std::error_code ec;
+        if (fs::create_directory(path.parent_path(), ec)) SyncDirectory(m_dir);
+        if (!WriteHeader(tempPath, meta, true) || rename(tempPath.c_str(), path.c_str()) == -1) {
+            unlink(tempPath.c_str());
+            return false;
+        }
+        SyncDirectory(path.parent_path());
+        AppendJournal(JournalOp::Put, meta, true);
+        return true;
+    }
+
+    // После 304 меняются только метаданные, тело остаётся прежним
+    bool Refresh(const CacheMetadata& meta) {
+        if (!WriteHeader(EntryPath(meta.url), meta, false)) return false;
+        AppendJournal(JournalOp::Put, meta);
+        return true;
+    }
+
+    void Remove(const std::string& url) {
+        unlink(EntryPath(url).c_str());
+        CacheMetadata meta;
+        meta.url = url;
+        AppendJournal(JournalOp::Remove, meta);
+    }
+
+    void Discard(const std::string& tempPath) {
+        unlink(tempPath.c_str());
+    }
+
+    // Открывает запись, только если заголовок принадлежит этому URL и файл не обрезан.
+    // Так хэш-коллизия или недописанный после сбоя файл становятся промахом, а не чужим ответом
+    FileDesc Open(const CacheMetadata& meta) const {
+        FileDesc fd(open(EntryPath(meta.url).c_str(), O_RDONLY | O_CLOEXEC));
+        if (!fd.IsOpen()) return fd;
+        struct stat st{};
+        auto header = ReadHeader(fd.Get());
+        if (!header || header->url != meta.url || fstat(fd.Get(), &st) == -1
+            || static_cast<uint64_t>(st.st_size) != HeaderSize + meta.size) {
+            fd.Close();
+        }
+        return fd;
+    }
+
+    // Восстанавливает записи при старте: журнал читается одним файлом, каталоги — через readdir без stat.
+    // Файлы, которых нет в журнале (сбой между rename и записью в журнал), проверяются по своему заголовку.
+    // Журнал переписывается заново, уже без удалённых и повторяющихся записей.
+    // Записи возвращаются от старых к новым, чтобы вставка в LRU восстановила порядок
+    std::vector<Entry> Load() {
+        ClearDirectory(m_dir / "tmp");
+        std::unordered_map<std::string, Entry> journal = ReadJournal();
+
+        std::vector<Entry> entries;
+        ForEachFile(m_dir, [&](const std::string& name, unsigned char type) {
+            if (type == DT_DIR && name.size() == 2) {
+                ForEachFile(m_dir / name, [&](const std::string& hash, unsigned char) {
+                    const std::string path = (m_dir / name / hash).string();
+                    auto it = journal.find(hash);
+                    Entry entry = it != journal.end() ? it->second : RecoverEntry(path);
+                    if (entry && EntryPath(entry->url) == path) {
+                        entries.push_back(std::move(entry));
+                    } else {
+                        unlink(path.c_str());
+                    }
+                });
+            } else if (type != DT_DIR && name != JournalName) {
+                // Файлы прежнего формата (./cache/<std::hash>) к новым записям не относятся
+                unlink((m_dir / name).c_str());
+            }
+        });
+
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+            return a->storedAt < b->storedAt;
+        });
+        Compact(entries);
+        return entries;
+    }
+
+    // Журнал только растёт; когда записей в нём заметно больше, чем живых, его пора переписать
+    bool NeedsCompaction(size_t liveEntries) const {
+        return m_journalRecords > 2 * liveEntries + 1024;
+    }
+
+    void Compact(const std::vector<Entry>& entries) {
+        std::lock_guard<std::mutex> lock(m_journalMutex);
+        const fs::path tempPath = m_dir / "tmp" / "journal";
+        FileDesc fd(open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+        std::string buffer;
+        for (const auto& entry : entries) {
+            buffer += EncodeRecord(JournalOp::Put, *entry);
+        }
+        if (fd.IsOpen() && WriteAll(fd.Get(), buffer.data(), buffer.size(), 0) && fdatasync(fd.Get()) == 0
+            && rename(tempPath.c_str(), (m_dir / JournalName).c_str()) == 0) {
+            SyncDirectory(m_dir);
+            m_journalRecords = entries.size();
+        }
+        // Если переписать не удалось, продолжаем дописывать прежний журнал
+        m_journal = FileDesc(open((m_dir / JournalName).c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644));
+    }
+
+private:
+    static constexpr const char* JournalName = "journal";
+    static constexpr uint32_t HeaderMagic = 0x31435048; // "HPC1"
+
+    enum class JournalOp : char { Put = '+', Remove = '-' };
+
+    // Формат метаданных — по значению на строку: URL, размер, время сохранения, срок свежести, ETag, Last-Modified
+    static std::string SerializeMetadata(const CacheMetadata& meta) {
+        return meta.url + '\n' + std::to_string(meta.size) + '\n' + std::to_string(meta.storedAt) + '\n'
+               + std::to_string(meta.freshUntil) + '\n' + meta.etag + '\n' + meta.lastModified + '\n';
+    }
+
+    static std::shared_ptr<CacheMetadata> ParseMetadata(std::string_view text) {
+        std::string_view fields[6];
+        for (auto& field : fields) {
+            const size_t newline = text.find('\n');
+            if (newline == std::string_view::npos) return nullptr;
+            field = text.substr(0, newline);
+            text.remove_prefix(newline + 1);
+        }
+        auto meta = std::make_shared<CacheMetadata>();
+        meta->url = std::string(fields[0]);
+        try {
+            meta->size = std::stoull(std::string(fields[1]));
+            meta->storedAt = std::stoll(std::string(fields[2]));
+            meta->freshUntil = std::stoll(std::string(fields[3]));
+        } catch (const std::exception&) {
+            return nullptr;
+        }
+        meta->etag = std::string(fields[4]);
+        meta->lastModified = std::string(fields[5]);
+        return meta;
+    }
+
+    // FNV-1a: ловит оборванную или частично перезаписанную запись, криптостойкость здесь не нужна
+    static uint32_t Checksum(std::string_view data) {
+        uint32_t hash = 2166136261u;
+        for (const char c : data) {
+            hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+        }
+        return hash;
+    }
+
+    static void PutU32(std::string& out, uint32_t value) {
+        for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>(value >> (8 * i)));
+    }
+
+    static uint32_t GetU32(const char* data) {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) value |= uint32_t(static_cast<uint8_t>(data[i])) << (8 * i);
+        return value;
+    }
+
+    // Заголовок записи: magic, длина и контрольная сумма метаданных, метаданные, нули до HeaderSize.
+    // С sync на диск уходит и заголовок, и всё тело файла
+    static bool WriteHeader(const std::string& path, const CacheMetadata& meta, bool sync) {
+        const std::string text = SerializeMetadata(meta);
+        if (text.size() + 12 > HeaderSize) return false;
+        std::string header;
+        PutU32(header, HeaderMagic);
+        PutU32(header, static_cast<uint32_t>(text.size()));
+        PutU32(header, Checksum(text));
+        header += text;
+        header.resize(HeaderSize, '\0');
+
+        FileDesc fd(open(path.c_str(), O_WRONLY | O_CLOEXEC));
+        return fd.IsOpen() && WriteAll(fd.Get(), header.data(), header.size(), 0) && (!sync || fdatasync(fd.Get()) == 0);
+    }
+
+    // rename и новые файлы переживают сбой, только когда на диск записан и сам каталог
+    static void SyncDirectory(const fs::path& dir) {
+        FileDesc fd(open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+        if (fd.IsOpen()) fsync(fd.Get());
+    }
+
+    static std::shared_ptr<CacheMetadata> ReadHeader(int fd) {
+        char header[HeaderSize];
+        const ssize_t size = pread(fd, header, sizeof(header), 0);
+        if (size != static_cast<ssize_t>(sizeof(header)) || GetU32(header) != HeaderMagic) return nullptr;
+        const uint32_t length = GetU32(header + 4);
+        if (length + 12 > HeaderSize) return nullptr;
+        const std::string_view text(header + 12, length);
+        if (Checksum(text) != GetU32(header + 8)) return nullptr;
+        return ParseMetadata(text);
+    }
+
+    static Entry RecoverEntry(const std::string& path) {
+        FileDesc fd(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+        struct stat st{};
+        if (!fd.IsOpen() || fstat(fd.Get(), &st) == -1) return nullptr;
+        auto meta = ReadHeader(fd.Get());
+        if (!meta || static_cast<uint64_t>(st.st_size) != HeaderSize + meta->size) return nullptr;
+        return meta;
+    }
+
+    static bool WriteAll(int fd, const char* data, size_t size, off_t offset) {
+        while (size > 0) {
+            const ssize_t written = pwrite(fd, data, size, offset);
+            if (written == -1) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+            offset += written;
+        }
+        return true;
+    }
+
+    // Запись журнала: длина, контрольная сумма, операция и метаданные. Оборванный хвост после сбоя отбрасывается
+    static std::string EncodeRecord(JournalOp op, const CacheMetadata& meta) {
+        const std::string payload = static_cast<char>(op) + SerializeMetadata(meta);
+        std::string record;
+        PutU32(record, static_cast<uint32_t>(payload.size()));
+        PutU32(record, Checksum(payload));
+        return record + payload;
+    }
+
+    // Синхронно пишется только публикация новой записи. Потерянное после сбоя удаление или обновление
+    // срока свежести безопасно: файла нет или он отдаётся по прежним метаданным, которые потребуют проверки
+    void AppendJournal(JournalOp op, const CacheMetadata& meta, bool sync = false) {
+        const std::string record = EncodeRecord(op, meta);
+        std::lock_guard<std::mutex> lock(m_journalMutex);
+        if (!m_journal.IsOpen()) return;
+        // O_APPEND: одна запись уходит одним write, смещение ядро выставляет само
+        if (write(m_journal.Get(), record.data(), record.size()) == static_cast<ssize_t>(record.size())) {
+            ++m_journalRecords;
+            if (sync) fdatasync(m_journal.Get());
+        }
+    }
+
+    // Ключ результата — имя файла записи (SHA-256 от URL)
+    std::unordered_map<std::string, Entry> ReadJournal() const {
+        std::unordered_map<std::string, Entry> entries;
+        FileDesc fd(open((m_dir / JournalName).c_str(), O_RDONLY | O_CLOEXEC));
+        if (!fd.IsOpen()) return entries;
+
+        std::string data;
+        char buffer[65536];
+        ssize_t size;
+        while ((size = read(fd.Get(), buffer, sizeof(buffer))) > 0) {
+            data.append(buffer, static_cast<size_t>(size));
+        }
+
+        size_t pos = 0;
+        while (pos + 8 <= data.size()) {
+            const uint32_t length = GetU32(data.data() + pos);
+            if (length == 0 || pos + 8 + length > data.size()) break;
+            const std::string_view payload(data.data() + pos + 8, length);
+            if (Checksum(payload) != GetU32(data.data() + pos + 4)) break;
+            pos += 8 + length;
+
+            auto meta = ParseMetadata(payload.substr(1));
+            if (!meta) continue;
+            std::string hash = Sha256::HexHash(meta->url);
+            if (static_cast<JournalOp>(payload[0]) == JournalOp::Put) {
+                entries[std::move(hash)] = std::move(meta);
+            } else {
+                entries.erase(hash);
+            }
+        }
+        return entries;
+    }
+
+    template <typename Callback>
+    static void ForEachFile(const fs::path& dir, Callback&& callback) {
+        DIR* handle = opendir(dir.c_str());
+        if (handle == nullptr) return;
+        while (dirent* entry = readdir(handle)) {
+            const std::string name = entry->d_name;
+            if (name == "." || name == "..") continue;
+            unsigned char type = entry->d_type;
+            if (type == DT_UNKNOWN) {
+                // Не все файловые системы заполняют d_type — только тогда приходится делать stat
+                std::error_code ec;
+                type = fs::is_directory(dir / name, ec) ? DT_DIR : DT_REG;
+            }
+            callback(name, type);
+        }
+        closedir(handle);
+    }
+
+    static void ClearDirectory(const fs::path& dir) {
+        ForEachFile(dir, [&](const std::string& name, unsigned char) {
+            unlink((dir / name).c_str());
+        });
+    }
+
+    fs::path m_dir;
+    std::atomic<uint64_t> m_tempCounter = 0;
+    std::mutex m_journalMutex;
+    FileDesc m_journal;
+    std::atomic<size_t> m_journalRecords = 0;
+};
@@ -0,0 +1,64 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Потоки записи в кэш. Запись на диск выносится из циклов событий,
+// чтобы медленный диск не останавливал обслуживание клиентов
+class CacheWriter {
+public:
+    using Task = std::function<void()>;
+
+    explicit CacheWriter(size_t threads = 2) {
+        for (size_t i = 0; i < std::max<size_t>(1, threads); ++i) {
+            m_threads.emplace_back([this] { Work(); });
+        }
+    }
+
+    CacheWriter(const CacheWriter&) = delete;
+    CacheWriter& operator=(const CacheWriter&) = delete;
+
+    ~CacheWriter() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wakeup.notify_all();
+        for (auto& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    void Submit(Task task) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.push_back(std::move(task));
+        }
+        m_wakeup.notify_one();
+    }
+
+private:
+    void Work() {
+        while (true) {
+            Task task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wakeup.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+                if (m_tasks.empty()) return;
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::deque<Task> m_tasks;
+    bool m_stopping = false;
+    std::vector<std::thread> m_threads;
+};
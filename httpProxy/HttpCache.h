@@ -1,44 +1,239 @@
 #pragma once
+#include "MemoryCache.h"
+#include "CacheFill.h"
+#include "CacheIndex.h"
+#include "CachePolicy.h"
+#include "CacheStore.h"
+#include "CacheWriter.h"
+#include <chrono>
 #include <string>
-#include <fstream>
-#include <filesystem>
 #include <functional>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
 
-namespace fs = std::filesystem;
+// Результат поиска в кэше: либо готовые байты из памяти, либо уже открытый файл на диске
+// (тело начинается со смещения offset). Устаревшая (stale) запись перед отдачей
+// должна быть подтверждена сервером условным GET
+struct CacheHit {
+    MemoryCache::Value memory;
+    FileDesc file;
+    off_t offset = 0;
+    size_t size = 0;
+    CacheIndex::Entry meta;
+    bool stale = false;
+};
 
+// Двухуровневый кэш: горячие объекты в памяти (MemoryCache), остальные — файлы в ./cache (CacheStore).
+// Метаданные всех записей — срок свежести и валидаторы — хранятся в CacheIndex;
+// общий объём файлов ограничен, лишнее вытесняется по LRU
 class HttpCache {
 public:
-    HttpCache() {
-        if (!fs::exists(m_cacheDir)) {
-            fs::create_directory(m_cacheDir);
+    static constexpr size_t DefaultMemoryBudget = 64 * 1024 * 1024;
+    static constexpr uint64_t DefaultDiskBudget = 1024ull * 1024 * 1024;
+    // Объекты крупнее отдаются с диска и в память не поднимаются
+    static constexpr size_t MaxMemoryObjectSize = 1024 * 1024;
+
+    explicit HttpCache(uint64_t diskBudget = DefaultDiskBudget, size_t memoryBudget = DefaultMemoryBudget)
+            : m_store("./cache"), m_memory(memoryBudget), m_index(diskBudget) {
+        for (auto& entry : m_store.Load()) {
+            for (const auto& evicted : m_index.Insert(std::move(entry))) {
+                m_store.Remove(evicted);
+            }
         }
     }
 
-    std::string GetCacheFilePath(const std::string& url) const {
-        std::hash<std::string> hasher;
-        size_t hash = hasher(url);
-        return (m_cacheDir / std::to_string(hash)).string();
+    bool Has(const std::string& url) {
+        return m_index.Find(url) != nullptr;
     }
 
-    bool Has(const std::string& url) const {
-        return fs::exists(GetCacheFilePath(url));
+    // Устаревшая запись без ETag и Last-Modified подтвердить нельзя — это промах
+    std::optional<CacheHit> Lookup(const std::string& url) {
+        auto meta = m_index.Find(url);
+        if (!meta) return std::nullopt;
+        const bool stale = !meta->IsFresh(Now());
+        if (stale && !meta->HasValidators()) return std::nullopt;
+
+        if (auto value = m_memory.Get(url)) {
+            return CacheHit{value, FileDesc(), 0, value->size(), meta, stale};
+        }
+
+        FileDesc file = m_store.Open(*meta);
+        if (!file.IsOpen()) {
+            // Файл пропал или не совпал с индексом (например, обрезан после сбоя) — запись больше не действительна
+            EraseBroken(url, meta);
+            return std::nullopt;
+        }
+        const size_t size = static_cast<size_t>(meta->size);
+        const off_t offset = static_cast<off_t>(CacheStore::HeaderSize);
+        if (size > MaxMemoryObjectSize) {
+            return CacheHit{nullptr, std::move(file), offset, size, meta, stale};
+        }
+
+        auto body = std::make_shared<std::string>(size, '\0');
+        if (pread(file.Get(), body->data(), size, offset) != static_cast<ssize_t>(size)) return std::nullopt;
+
+        m_memory.Put(url, body);
+        // Пока файл читался, запись могли заменить: старое тело в памяти оставлять нельзя.
+        // Commit и Erase чистят память после индекса, поэтому одна из двух проверок гонку поймает
+        if (m_index.Find(url) != meta) m_memory.Remove(url);
+        return CacheHit{std::move(body), FileDesc(), 0, size, meta, stale};
     }
 
-    void ServeFromCache(const std::string& url, std::function<void(const char*, size_t)> sendCallback) {
-        std::string path = GetCacheFilePath(url);
-        std::ifstream file(path, std::ios::binary);
-        if (!file.is_open()) return;
+    // Single-flight: первый промах по URL становится ведущим (leader = true) и заполняет запись,
+    // остальные получают то же заполнение и в reader — свой дескриптор временного файла,
+    // который читают по мере записи. Ведущий отдаёт ответ клиенту из памяти, ему reader не нужен.
+    // Заполнение пишется во временный файл, поэтому прежняя версия записи до публикации остаётся целой
+    std::shared_ptr<CacheFill> BeginFill(const std::string& url, bool& leader, FileDesc& reader) {
+        std::lock_guard<std::mutex> lock(m_fillingMutex);
+        if (auto it = m_filling.find(url); it != m_filling.end()) {
+            leader = false;
+            // Открываем под тем же мьютексом, под которым Store убирает заполнение перед переименованием файла
+            reader = FileDesc(open(it->second->Path().c_str(), O_RDONLY | O_CLOEXEC));
+            return it->second;
+        }
+        std::string path;
+        FileDesc fd = m_store.CreateTemp(path);
+        auto fill = std::make_shared<CacheFill>(std::move(path), std::move(fd),
+                                                static_cast<off_t>(CacheStore::HeaderSize), m_writer);
+        m_filling.emplace(url, fill);
+        leader = true;
+        return fill;
+    }
 
-        char buffer[4096];
-        while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) {
-            sendCallback(buffer, file.gcount());
+    // Ответ получен полностью. Когда очередь записи опустеет, запись атомарно заменит прежнюю версию,
+    // если ответ можно хранить; иначе прежняя версия удаляется вместе с временным файлом
+    // (подписчики, уже открывшие его, дочитают ответ)
+    void Commit(const std::string& url, const ResponseHeaders& headers) {
+        std::shared_ptr<CacheFill> fill;
+        {
+            std::lock_guard<std::mutex> lock(m_fillingMutex);
+            auto it = m_filling.find(url);
+            if (it == m_filling.end()) return;
+            fill = it->second;
         }
+        // До публикации заполнение остаётся в m_filling: новые промахи по URL присоединяются к нему
+        fill->Finish([this, url, headers](CacheFill& written) { Store(url, headers, written); });
+    }
+
+    // Сервер ответил 304 на условный GET: тело прежнее, обновляется только срок свежести.
+    // Валидаторы, которых нет в ответе 304, берутся из сохранённой записи
+    void Refresh(const std::string& url, ResponseHeaders headers) {
+        auto old = m_index.Find(url);
+        if (!old) return;
+        if (headers.etag.empty()) headers.etag = old->etag;
+        if (headers.lastModified.empty()) headers.lastModified = old->lastModified;
+
+        const int64_t now = Now();
+        auto meta = std::make_shared<CacheMetadata>(*old);
+        meta->storedAt = now;
+        meta->freshUntil = CachePolicy::FreshUntil(headers, now);
+        meta->etag = headers.etag;
+        meta->lastModified = headers.lastModified;
+        if (m_store.Refresh(*meta)) m_index.Update(std::move(meta));
+        CompactJournal();
     }
 
-    std::ofstream OpenWrite(const std::string& url) {
-        return std::ofstream(GetCacheFilePath(url), std::ios::binary);
+    // Заполнение не удалось: временный файл удаляется, прежняя версия записи, если была, остаётся
+    void Remove(const std::string& url) {
+        auto fill = TakeFill(url);
+        if (!fill) return;
+        m_store.Discard(fill->Path());
+        fill->Fail();
     }
 
 private:
-    fs::path m_cacheDir = "./cache";
-};
\ No newline at end of file
+    static int64_t Now() {
+        return std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    // Вызывается в потоке CacheWriter, когда всё тело заполнения уже на диске
+    void Store(const std::string& url, const ResponseHeaders& headers, CacheFill& fill) {
+        {
+            std::lock_guard<std::mutex> lock(m_fillingMutex);
+            auto it = m_filling.find(url);
+            if (it != m_filling.end() && it->second.get() == &fill) m_filling.erase(it);
+        }
+        if (fill.IsFailed()) {
+            m_store.Discard(fill.Path());
+            return;
+        }
+        if (!CachePolicy::IsStorable(headers)) {
+            m_store.Discard(fill.Path());
+            Erase(url);
+            return;
+        }
+        const int64_t now = Now();
+        auto meta = std::make_shared<CacheMetadata>();
+        meta->url = url;
+        meta->size = fill.Written();
+        meta->storedAt = now;
+        meta->freshUntil = CachePolicy::FreshUntil(headers, now);
+        meta->etag = headers.etag;
+        meta->lastModified = headers.lastModified;
+        bool published = false;
+        std::vector<std::string> evicted;
+        {
+            std::lock_guard<std::mutex> lock(m_publishMutex);
+            published = m_store.Publish(fill.Path(), *meta);
+            if (published) evicted = m_index.Insert(std::move(meta));
+        }
+        if (!published) {
+            Erase(url);
+            return;
+        }
+        for (const auto& evictedUrl : evicted) {
+            m_memory.Remove(evictedUrl);
+            m_store.Remove(evictedUrl);
+        }
+        m_memory.Remove(url);
+        CompactJournal();
+    }
+
+    void Erase(const std::string& url) {
+        const bool indexed = m_index.Remove(url);
+        m_memory.Remove(url);
+        if (indexed) {
+            m_store.Remove(url);
+            CompactJournal();
+        }
+    }
+
+    // Удаляет версию meta, файл которой не открылся. Между поиском в индексе и открытием файла могла
+    // выйти новая версия: её запись и файл остаются, поэтому проверка и удаление идут под m_publishMutex
+    void EraseBroken(const std::string& url, const CacheIndex::Entry& meta) {
+        {
+            std::lock_guard<std::mutex> lock(m_publishMutex);
+            if (!m_index.Remove(url, meta)) return;
+            m_store.Remove(url);
+        }
+        m_memory.Remove(url);
+        CompactJournal();
+    }
+
+    void CompactJournal() {
+        if (m_store.NeedsCompaction(m_index.Size())) {
+            m_store.Compact(m_index.Snapshot());
+        }
+    }
+
+    std::shared_ptr<CacheFill> TakeFill(const std::string& url) {
+        std::lock_guard<std::mutex> lock(m_fillingMutex);
+        auto it = m_filling.find(url);
+        if (it == m_filling.end()) return nullptr;
+        auto fill = std::move(it->second);
+        m_filling.erase(it);
+        return fill;
+    }
+
+    CacheStore m_store;
+    MemoryCache m_memory;
+    CacheIndex m_index;
+    std::mutex m_fillingMutex;
+    // Публикация файла и вставка в индекс — одно действие для EraseBroken
+    std::mutex m_publishMutex;
+    std::unordered_map<std::string, std::shared_ptr<CacheFill>> m_filling;
+    // Объявлен последним, чтобы остановиться первым: его задачи обращаются к остальным полям
+    CacheWriter m_writer;
+};
@@ -1,7 +1,13 @@
 #pragma once
+#include "../lib/HttpParser.h"
+#include "../lib/Logger.h"
 #include <string>
-#include <regex>
 #include <iostream>
+#include <sstream>
+#include <optional>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
 
 struct ParsedRequest {
     std::string method;
@@ -15,33 +21,246 @@ struct ParsedRequest {
 
 class HttpUtils {
 public:
-    static ParsedRequest ParseRequest(const std::string& rawRequest) {
+    // Запрос уже разобран HttpRequestParser; здесь только проверка метода и разбор абсолютного URL
+    static ParsedRequest ParseRequest(const HttpRequestView& request) {
         ParsedRequest req;
-        std::istringstream stream(rawRequest);
-        std::string url;
-
-        stream >> req.method >> url >> req.version;
+        req.method = request.method;
+        req.version = request.version;
 
         if (req.method != "GET") {
             return req;
         }
 
-        req.fullUrl = url;
-
-        std::regex urlRegex(R"(http://([^/:]+)(?::(\d+))?(/.*)?)");
-        std::smatch match;
+        req.fullUrl = request.target;
 
-        if (std::regex_search(url, match, urlRegex)) {
-            req.host = match[1];
-            if (match[2].matched) {
-                req.port = std::stoi(match[2]);
-            }
-            req.path = match[3].matched ? match[3].str() : "/";
+        if (auto url = ParseHttpUrl(request.target)) {
+            req.host = url->host;
+            req.port = url->port;
+            req.path = url->path;
             req.isValid = true;
         } else {
-            std::cerr << "Unsupported URL format: " << url << std::endl;
+            LOG_WARNING("Proxy", "Unsupported URL format: " + req.fullUrl);
         }
 
         return req;
     }
-};
\ No newline at end of file
+
+    // Начало сохранённого в кэше ответа, чтобы отдать из него диапазон: длина заголовка, его поля без тех,
+    // что описывают тело целиком или соединение, и отдельно Content-Type (у multipart он свой).
+    // false — заголовок не найден или тело нельзя резать по байтам (не 200 либо chunked)
+    static bool ParseStoredHead(const std::string& data, size_t& headSize, std::string& fields, std::string& contentType) {
+        const size_t end = data.find("\r\n\r\n");
+        if (end == std::string::npos || data.compare(0, 5, "HTTP/") != 0) return false;
+        const size_t status = data.find(' ');
+        if (status == std::string::npos || data.compare(status + 1, 3, "200") != 0) return false;
+        headSize = end + 4;
+
+        fields.clear();
+        contentType.clear();
+        size_t pos = data.find("\r\n") + 2;
+        while (pos < end) {
+            const size_t lineEnd = data.find("\r\n", pos);
+            const std::string line = data.substr(pos, lineEnd - pos);
+            pos = lineEnd + 2;
+            const size_t colon = line.find(':');
+            if (colon == std::string::npos) continue;
+            std::string name = line.substr(0, colon);
+            for (auto& c : name) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            if (name == "transfer-encoding") return false;
+            if (name == "content-length" || name == "content-range" || name == "connection" || name == "keep-alive"
+                || name == "proxy-connection") {
+                continue;
+            }
+            if (name == "content-type") {
+                const size_t begin = line.find_first_not_of(" \t", colon + 1);
+                if (begin != std::string::npos) contentType = line.substr(begin);
+                continue;
+            }
+            fields += line + "\r\n";
+        }
+        return true;
+    }
+};
+
+
+// Заголовки ответа, от которых зависит кэширование
+struct ResponseHeaders {
+    int statusCode = 0;
+    std::string cacheControl;
+    std::string pragma;
+    std::string expires;
+    std::string date;
+    std::string age;
+    std::string etag;
+    std::string lastModified;
+};
+
+// Инкрементальный разбор границ HTTP-ответа: по Content-Length, chunked или до закрытия соединения.
+// Нужен, чтобы понять, где закончился ответ, и вернуть соединение с сервером в пул
+class HttpResponseFramer {
+public:
+    static constexpr size_t MaxHeaderSize = 64 * 1024;
+
+    // Возвращает, сколько байт из data относится к текущему ответу
+    size_t Feed(const char* data, size_t size) {
+        size_t pos = 0;
+        while (pos < size && m_state != State::Done) {
+            switch (m_state) {
+                case State::Headers: pos += FeedHeaders(data + pos, size - pos); break;
+                case State::Body: pos += FeedBody(data + pos, size - pos); break;
+                case State::ChunkSize: pos += FeedLine(data + pos, size - pos, &HttpResponseFramer::OnChunkSizeLine); break;
+                case State::ChunkData: pos += FeedBody(data + pos, size - pos); break;
+                case State::ChunkEnd: pos += FeedLine(data + pos, size - pos, &HttpResponseFramer::OnChunkEndLine); break;
+                case State::Trailers: pos += FeedLine(data + pos, size - pos, &HttpResponseFramer::OnTrailerLine); break;
+                case State::UntilClose: pos = size; break;
+                case State::Done: break;
+            }
+        }
+        return pos;
+    }
+
+    // Сервер закрыл соединение. true, если ответ при этом получен целиком
+    bool OnEof() {
+        if (m_state == State::UntilClose) {
+            m_state = State::Done;
+            m_keepAlive = false;
+        }
+        return m_state == State::Done;
+    }
+
+    bool IsComplete() const { return m_state == State::Done; }
+    bool HasHeaders() const { return m_state != State::Headers; }
+    bool KeepAlive() const { return m_keepAlive && m_state == State::Done; }
+    int StatusCode() const { return m_headers.statusCode; }
+    const ResponseHeaders& Headers() const { return m_headers; }
+    // Сколько байт в начале ответа занимают промежуточные заголовки 1xx перед окончательным
+    size_t InterimSize() const { return m_interimSize; }
+
+private:
+    enum class State { Headers, Body, ChunkSize, ChunkData, ChunkEnd, Trailers, UntilClose, Done };
+
+    size_t FeedHeaders(const char* data, size_t size) {
+        const size_t before = m_line.size();
+        m_line.append(data, size);
+        const size_t end = m_line.find("\r\n\r\n");
+        if (end == std::string::npos) {
+            if (m_line.size() > MaxHeaderSize) throw std::runtime_error("Response headers too large");
+            return size;
+        }
+        ParseHeaders(m_line.substr(0, end));
+        m_line.clear();
+        if (m_state == State::Headers) m_interimSize += end + 4;
+        return end + 4 - before;
+    }
+
+    void ParseHeaders(const std::string& head) {
+        std::istringstream stream(head);
+        std::string version;
+        m_headers = ResponseHeaders{};
+        stream >> version >> m_headers.statusCode;
+        m_keepAlive = version == "HTTP/1.1";
+
+        bool chunked = false;
+        std::optional<uint64_t> contentLength;
+        std::string line;
+        std::getline(stream, line);
+        while (std::getline(stream, line)) {
+            const size_t colon = line.find(':');
+            if (colon == std::string::npos) continue;
+            std::string name = ToLower(line.substr(0, colon));
+            std::string rawValue = Trim(line.substr(colon + 1));
+            std::string value = ToLower(rawValue);
+            if (name == "cache-control") {
+                m_headers.cacheControl = value;
+            } else if (name == "pragma") {
+                m_headers.pragma = value;
+            } else if (name == "expires") {
+                m_headers.expires = rawValue;
+            } else if (name == "date") {
+                m_headers.date = rawValue;
+            } else if (name == "age") {
+                m_headers.age = value;
+            } else if (name == "etag") {
+                m_headers.etag = rawValue;
+            } else if (name == "last-modified") {
+                m_headers.lastModified = rawValue;
+            } else if (name == "content-length") {
+                contentLength = std::stoull(value);
+            } else if (name == "transfer-encoding") {
+                chunked = value.find("chunked") != std::string::npos;
+            } else if (name == "connection") {
+                if (value.find("close") != std::string::npos) m_keepAlive = false;
+                if (value.find("keep-alive") != std::string::npos) m_keepAlive = true;
+            }
+        }
+
+        const int statusCode = m_headers.statusCode;
+        if (statusCode / 100 == 1 && statusCode != 101) {
+            // 100 Continue, 103 Early Hints: промежуточный ответ без тела, окончательный идёт следом
+            m_state = State::Headers;
+        } else if (statusCode == 101 || statusCode == 204 || statusCode == 304) {
+            m_state = State::Done;
+        } else if (chunked) {
+            m_state = State::ChunkSize;
+        } else if (contentLength) {
+            m_remaining = *contentLength;
+            m_state = m_remaining == 0 ? State::Done : State::Body;
+        } else {
+            m_state = State::UntilClose;
+        }
+    }
+
+    size_t FeedBody(const char* /*data*/, size_t size) {
+        const size_t take = static_cast<size_t>(std::min<uint64_t>(m_remaining, size));
+        m_remaining -= take;
+        if (m_remaining == 0) {
+            m_state = m_state == State::ChunkData ? State::ChunkEnd : State::Done;
+        }
+        return take;
+    }
+
+    size_t FeedLine(const char* data, size_t size, void (HttpResponseFramer::*onLine)(const std::string&)) {
+        const char* newline = static_cast<const char*>(std::memchr(data, '\n', size));
+        const size_t take = newline ? static_cast<size_t>(newline - data) + 1 : size;
+        m_line.append(data, take);
+        if (m_line.size() > MaxHeaderSize) throw std::runtime_error("Chunk framing line too long");
+        if (newline) {
+            std::string line = Trim(m_line);
+            m_line.clear();
+            (this->*onLine)(line);
+        }
+        return take;
+    }
+
+    void OnChunkSizeLine(const std::string& line) {
+        m_remaining = std::stoull(line.substr(0, line.find(';')), nullptr, 16);
+        m_state = m_remaining == 0 ? State::Trailers : State::ChunkData;
+    }
+
+    void OnChunkEndLine(const std::string&) {
+        m_state = State::ChunkSize;
+    }
+
+    void OnTrailerLine(const std::string& line) {
+        if (line.empty()) m_state = State::Done;
+    }
+
+    static std::string Trim(const std::string& s) {
+        const size_t begin = s.find_first_not_of(" \t\r\n");
+        if (begin == std::string::npos) return {};
+        const size_t end = s.find_last_not_of(" \t\r\n");
+        return s.substr(begin, end - begin + 1);
+    }
+
+    static std::string ToLower(std::string s) {
+        for (auto& c : s) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        return s;
+    }
+
+    State m_state = State::Headers;
+    std::string m_line;
+    uint64_t m_remaining = 0;
+    ResponseHeaders m_headers;
+    bool m_keepAlive = false;
+    size_t m_interimSize = 0;
+};
@@ -0,0 +1,82 @@
+#pragma once
+#include <array>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// LRU-кэш в памяти с ограничением по байтам. Разбит на шарды по хэшу URL,
+// чтобы потоки разных циклов событий не конкурировали за одну блокировку
+class MemoryCache {
+public:
+    using Value = std::shared_ptr<const std::string>;
+
+    explicit MemoryCache(size_t budgetBytes)
+            : m_shardBudget(budgetBytes / ShardCount) {}
+
+    Value Get(const std::string& url) {
+        Shard& shard = ShardFor(url);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(url);
+        if (it == shard.index.end()) return nullptr;
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        return it->second->value;
+    }
+
+    void Put(const std::string& url, Value value) {
+        const size_t size = url.size() + value->size();
+        if (size > m_shardBudget) return;
+
+        Shard& shard = ShardFor(url);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (auto it = shard.index.find(url); it != shard.index.end()) {
+            shard.bytes -= it->second->size;
+            shard.lru.erase(it->second);
+            shard.index.erase(it);
+        }
+        while (shard.bytes + size > m_shardBudget && !shard.lru.empty()) {
+            auto& victim = shard.lru.back();
+            shard.bytes -= victim.size;
+            shard.index.erase(victim.url);
+            shard.lru.pop_back();
+        }
+        shard.lru.push_front(Entry{url, std::move(value), size});
+        shard.index[url] = shard.lru.begin();
+        shard.bytes += size;
+    }
+
+    void Remove(const std::string& url) {
+        Shard& shard = ShardFor(url);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (auto it = shard.index.find(url); it != shard.index.end()) {
+            shard.bytes -= it->second->size;
+            shard.lru.erase(it->second);
+            shard.index.erase(it);
+        }
+    }
+
+private:
+    static constexpr size_t ShardCount = 16;
+
+    struct Entry {
+        std::string url;
+        Value value;
+        size_t size;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> lru;
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+        size_t bytes = 0;
+    };
+
+    Shard& ShardFor(const std::string& url) {
+        return m_shards[std::hash<std::string>{}(url) % ShardCount];
+    }
+
+    size_t m_shardBudget;
+    std::array<Shard, ShardCount> m_shards;
+};
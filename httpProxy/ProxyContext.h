@@ -0,0 +1,22 @@
+#pragma once
+#include "../lib/EventLoop.h"
+#include "../lib/HostResolver.h"
+#include "HttpCache.h"
+#include "ProxyMetrics.h"
+#include "UpstreamPool.h"
+
+struct ProxyOptions {
+    // Отправлять крупные тела из памяти с MSG_ZEROCOPY
+    bool zeroCopy = false;
+};
+
+// Всё, что сессия получает от своего потока: цикл событий, его пул соединений и метрики,
+// а также общие для процесса кэш, резолвер имён и настройки
+struct WorkerContext {
+    EventLoop& loop;
+    HttpCache& cache;
+    UpstreamPool& pool;
+    HostResolver& resolver;
+    WorkerMetrics& metrics;
+    const ProxyOptions& options;
+};
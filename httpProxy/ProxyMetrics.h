@@ -0,0 +1,252 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Счётчик, в который пишет только поток-владелец. Обычные load/store вместо атомарного сложения
+// не блокируют шину, а читать значение для /metrics можно из любого потока
+class Counter {
+public:
+    void Add(uint64_t value = 1) {
+        m_value.store(m_value.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    uint64_t Get() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> m_value = 0;
+};
+
+// Гистограмма задержек в духе HdrHistogram: каждая степень двойки микросекунд делится на 16 равных корзин,
+// поэтому относительная погрешность не больше 1/16 на любом масштабе. Корзина включает верхнюю границу,
+// как корзины Prometheus (le). Как и Counter, пишет только поток-владелец
+class LatencyHistogram {
+public:
+    static constexpr int SubBucketBits = 4;
+    static constexpr size_t SubBuckets = size_t(1) << SubBucketBits;
+    // 2^36 мкс — почти 19 часов; всё, что дольше, попадает в последнюю корзину
+    static constexpr int MaxExponent = 36;
+    static constexpr size_t BucketCount = (MaxExponent - SubBucketBits + 2) * SubBuckets;
+
+    struct Snapshot {
+        std::vector<uint64_t> buckets = std::vector<uint64_t>(BucketCount);
+        uint64_t count = 0;
+        uint64_t sum = 0;
+
+        void Merge(const LatencyHistogram& histogram) {
+            for (size_t i = 0; i < BucketCount; ++i) {
+                buckets[i] += histogram.m_buckets[i].load(std::memory_order_relaxed);
+            }
+            count += histogram.m_count.load(std::memory_order_relaxed);
+            sum += histogram.m_sum.load(std::memory_order_relaxed);
+        }
+
+        // Верхняя граница корзины, в которую попадает квантиль q, в микросекундах
+        uint64_t Quantile(double q) const {
+            if (count == 0) return 0;
+            // Ранг по методу ближайшего ранга: ceil(q * count), но не меньше 1
+            const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(count))));
+            uint64_t seen = 0;
+            for (size_t i = 0; i < BucketCount; ++i) {
+                seen += buckets[i];
+                if (seen >= rank) return UpperBound(i);
+            }
+            return UpperBound(BucketCount - 1);
+        }
+
+        // Сколько значений не больше limit; limit должен быть степенью двойки — на них совпадают границы корзин
+        uint64_t CountAtMost(uint64_t limit) const {
+            uint64_t result = 0;
+            for (size_t i = 0; i < BucketCount && UpperBound(i) <= limit; ++i) {
+                result += buckets[i];
+            }
+            return result;
+        }
+    };
+
+    void Record(std::chrono::steady_clock::duration duration) {
+        const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+        const uint64_t value = micros > 0 ? static_cast<uint64_t>(micros) : 0;
+        Bump(m_buckets[Index(value)], 1);
+        Bump(m_count, 1);
+        Bump(m_sum, value);
+    }
+
+    // Корзина i — значения (UpperBound(i - 1), UpperBound(i)]; 0 попадает в первую
+    static size_t Index(uint64_t value) {
+        if (value > 0) value--;
+        if (value < SubBuckets) return static_cast<size_t>(value);
+        const int exponent = 63 - __builtin_clzll(value);
+        if (exponent > MaxExponent) return BucketCount - 1;
+        const int shift = exponent - SubBucketBits;
+        return static_cast<size_t>(shift + 1) * SubBuckets + static_cast<size_t>((value >> shift) - SubBuckets);
+    }
+
+    static uint64_t UpperBound(size_t index) {
+        const size_t group = index / SubBuckets;
+        const uint64_t sub = index % SubBuckets;
+        if (group == 0) return sub + 1;
+        const size_t shift = group - 1;
+        return (SubBuckets + sub + 1) << shift;
+    }
+
+private:
+    static void Bump(std::atomic<uint64_t>& value, uint64_t delta) {
+        value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<uint64_t>, BucketCount> m_buckets{};
+    std::atomic<uint64_t> m_count = 0;
+    std::atomic<uint64_t> m_sum = 0;
+};
+
+// Метрики одного цикла событий. Сессии пишут только в метрики своего потока,
+// а выравнивание не даёт соседним потокам делить строку кэша
+struct alignas(64) WorkerMetrics {
+    Counter requests;
+    Counter cacheHits;
+    Counter cacheMisses;
+    Counter cacheRevalidated;
+    Counter cacheStale;
+    Counter fillJoins;
+    Counter upstreamErrors;
+    Counter bytesServed;
+
+    // От получения запроса до закрытия соединения с клиентом
+    LatencyHistogram hitDuration;
+    LatencyHistogram missDuration;
+    // Подключение к серверу вместе с разрешением имени; соединения из пула не учитываются
+    LatencyHistogram upstreamConnect;
+    // От отправки запроса серверу до первого байта ответа
+    LatencyHistogram upstreamTtfb;
+};
+
+// Реестр метрик всех потоков. Render суммирует их в текстовом формате Prometheus
+class ProxyMetrics {
+public:
+    // Ссылка остаётся действительной всё время жизни реестра (deque не перемещает элементы)
+    WorkerMetrics& AddWorker() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_workers.emplace_back();
+    }
+
+    std::string Render() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::string out;
+        RenderCounter(out, "proxy_requests_total", "Requests received from clients", "",
+                      Sum(&WorkerMetrics::requests));
+        RenderCounter(out, "proxy_cache_requests_total", "Requests by cache result", "result=\"hit\"",
+                      Sum(&WorkerMetrics::cacheHits));
+        RenderCounter(out, "proxy_cache_requests_total", nullptr, "result=\"revalidated\"",
+                      Sum(&WorkerMetrics::cacheRevalidated));
+        RenderCounter(out, "proxy_cache_requests_total", nullptr, "result=\"stale\"",
+                      Sum(&WorkerMetrics::cacheStale));
+        RenderCounter(out, "proxy_cache_requests_total", nullptr, "result=\"miss\"",
+                      Sum(&WorkerMetrics::cacheMisses));
+        RenderCounter(out, "proxy_cache_fill_joins_total", "Misses served from another request's cache fill", "",
+                      Sum(&WorkerMetrics::fillJoins));
+        RenderCounter(out, "proxy_upstream_errors_total", "Failed upstream fetches", "",
+                      Sum(&WorkerMetrics::upstreamErrors));
+        RenderCounter(out, "proxy_served_bytes_total", "Bytes sent to clients", "",
+                      Sum(&WorkerMetrics::bytesServed));
+
+        const auto hit = Merge(&WorkerMetrics::hitDuration);
+        const auto miss = Merge(&WorkerMetrics::missDuration);
+        const auto connect = Merge(&WorkerMetrics::upstreamConnect);
+        const auto ttfb = Merge(&WorkerMetrics::upstreamTtfb);
+        RenderHistogram(out, "proxy_request_duration_seconds", "Time from request to response end",
+                        "cache=\"hit\"", hit);
+        RenderHistogram(out, "proxy_request_duration_seconds", nullptr, "cache=\"miss\"", miss);
+        RenderHistogram(out, "proxy_upstream_connect_seconds", "Upstream DNS and TCP connect time", "", connect);
+        RenderHistogram(out, "proxy_upstream_ttfb_seconds", "Time from upstream request to first response byte", "",
+                        ttfb);
+
+        // Квантили с точностью HDR; корзины Prometheus для них слишком грубые
+        RenderQuantiles(out, "proxy_request_duration_quantile_seconds", "Request duration quantiles",
+                        "cache=\"hit\"", hit);
+        RenderQuantiles(out, "proxy_request_duration_quantile_seconds", nullptr, "cache=\"miss\"", miss);
+        RenderQuantiles(out, "proxy_upstream_connect_quantile_seconds", "Upstream connect time quantiles", "",
+                        connect);
+        RenderQuantiles(out, "proxy_upstream_ttfb_quantile_seconds", "Upstream TTFB quantiles", "", ttfb);
+        return out;
+    }
+
+private:
+    uint64_t Sum(Counter WorkerMetrics::*counter) const {
+        uint64_t result = 0;
+        for (const auto& worker : m_workers) {
+            result += (worker.*counter).Get();
+        }
+        return result;
+    }
+
+    LatencyHistogram::Snapshot Merge(LatencyHistogram WorkerMetrics::*histogram) const {
+        LatencyHistogram::Snapshot snapshot;
+        for (const auto& worker : m_workers) {
+            snapshot.Merge(worker.*histogram);
+        }
+        return snapshot;
+    }
+
+    // help == nullptr — продолжение уже начатого семейства с другими метками
+    static void RenderCounter(std::string& out, const std::string& name, const char* help,
+                              const std::string& labels, uint64_t value) {
+        if (help) {
+            out += "# HELP " + name + " " + help + "\n";
+            out += "# TYPE " + name + " counter\n";
+        }
+        out += name + (labels.empty() ? "" : "{" + labels + "}") + " " + std::to_string(value) + "\n";
+    }
+
+    // Корзины Prometheus — степени двойки микросекунд, на них совпадают границы корзин HDR
+    static void RenderHistogram(std::string& out, const std::string& name, const char* help,
+                                const std::string& labels, const LatencyHistogram::Snapshot& snapshot) {
+        if (help) {
+            out += "# HELP " + name + " " + help + "\n";
+            out += "# TYPE " + name + " histogram\n";
+        }
+        const std::string prefix = labels.empty() ? "" : labels + ",";
+        for (int exponent = LatencyHistogram::SubBucketBits; exponent <= LatencyHistogram::MaxExponent; ++exponent) {
+            const uint64_t limit = uint64_t(1) << exponent;
+            out += name + "_bucket{" + prefix + "le=\"" + Seconds(limit) + "\"} "
+                   + std::to_string(snapshot.CountAtMost(limit)) + "\n";
+        }
+        out += name + "_bucket{" + prefix + "le=\"+Inf\"} " + std::to_string(snapshot.count) + "\n";
+        const std::string suffix = labels.empty() ? "" : "{" + labels + "}";
+        out += name + "_sum" + suffix + " " + Seconds(snapshot.sum) + "\n";
+        out += name + "_count" + suffix + " " + std::to_string(snapshot.count) + "\n";
+    }
+
+    static void RenderQuantiles(std::string& out, const std::string& name, const char* help,
+                                const std::string& labels, const LatencyHistogram::Snapshot& snapshot) {
+        if (help) {
+            out += "# HELP " + name + " " + help + "\n";
+            out += "# TYPE " + name + " gauge\n";
+        }
+        const std::string prefix = labels.empty() ? "" : labels + ",";
+        for (const double q : {0.5, 0.9, 0.99, 0.999}) {
+            char quantile[16];
+            std::snprintf(quantile, sizeof(quantile), "%g", q);
+            out += name + "{" + prefix + "quantile=\"" + quantile + "\"} " + Seconds(snapshot.Quantile(q)) + "\n";
+        }
+    }
+
+    // Точно, без округления: границы корзин должны совпадать с тем, что в них считается, а сумма — не терять точность
+    static std::string Seconds(uint64_t micros) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%llu.%06llu", static_cast<unsigned long long>(micros / 1000000),
+                      static_cast<unsigned long long>(micros % 1000000));
+        return buffer;
+    }
+
+    mutable std::mutex m_mutex;
+    std::deque<WorkerMetrics> m_workers;
+};
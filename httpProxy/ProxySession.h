@@ -0,0 +1,851 @@
+#pragma once
+#include "../lib/EventLoop.h"
+#include "../lib/HttpRange.h"
+#include "../lib/Socket.h"
+#include "UpstreamConnection.h"
+#include "HttpUtils.h"
+#include "HttpCache.h"
+#include "ProxyContext.h"
+#include "../lib/Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Обработка одного клиента как конечного автомата поверх EventLoop:
+// чтение запроса -> (HIT) отдача из кэша | (MISS) подключение к серверу -> пересылка ответа.
+// При промахе ответ сервера идёт и клиенту из буфера в памяти, и в заполнение кэша, которое пишется на диск независимо.
+// Клиент, отставший от сервера больше чем на буфер, дочитывает ответ из файла заполнения в своём темпе
+class ProxySession : public std::enable_shared_from_this<ProxySession> {
+public:
+    ProxySession(const WorkerContext& ctx, Socket client)
+            : m_loop(ctx.loop), m_client(std::move(client)), m_cache(ctx.cache), m_pool(ctx.pool),
+              m_resolver(ctx.resolver), m_metrics(ctx.metrics), m_options(ctx.options) {}
+
+    void Start() {
+        auto self = shared_from_this();
+        m_loop.Add(m_client.Get(), EPOLLIN | EPOLLRDHUP, [self](uint32_t events) {
+            self->OnClientEvent(events);
+        });
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // Буфер ответа для клиента. Без заполнения кэша, пока клиент не забрал столько данных, чтение с сервера
+    // приостанавливается; с заполнением клиент, не забравший буфер, переходит на чтение файла заполнения
+    static constexpr size_t MaxPendingOutput = 256 * 1024;
+    // Сколько за ответ клиент может ждать отстающий диск, прежде чем копия в кэше будет отменена
+    static constexpr std::chrono::milliseconds MaxDiskStall{1000};
+    // Для буферов меньше этого размера закрепление страниц обходится дороже копирования
+    static constexpr size_t ZeroCopyThreshold = 64 * 1024;
+
+    void OnClientEvent(uint32_t events) {
+        try {
+            if (m_zeroCopyPending > 0 && (events & EPOLLERR)) {
+                // Через EPOLLERR приходят и уведомления о завершённых zerocopy-отправках
+                m_zeroCopyPending -= std::min(m_zeroCopyPending, m_client.ReapZeroCopy());
+                if (m_closed) {
+                    if (m_zeroCopyPending == 0) m_loop.Remove(m_client.Get());
+                    return;
+                }
+                if (m_client.GetError() == 0) events &= ~EPOLLERR;
+            }
+            if (m_closed) return;
+            if (events & (EPOLLERR | EPOLLHUP)) {
+                Close();
+                return;
+            }
+            if (!m_requestDone && (events & (EPOLLIN | EPOLLRDHUP))) {
+                ReadRequest();
+            }
+            if (!m_closed && (events & EPOLLOUT)) {
+                FlushClient();
+            }
+        } catch (const std::exception& e) {
+            LOG_ERROR("Proxy", "Client handler error: " + std::string(e.what()));
+            Close();
+        }
+    }
+
+    void OnUpstreamEvent(uint32_t events) {
+        try {
+            if (!m_connected) {
+                const int fd = m_upstream->Get();
+                if (!m_upstream->FinishConnect()) {
+                    if (m_upstream->Get() != fd) {
+                        // Переключились на следующий адрес — новый дескриптор нужно зарегистрировать заново
+                        m_loop.Remove(fd);
+                        RegisterUpstream(EPOLLOUT);
+                    }
+                    return;
+                }
+                m_connected = true;
+                m_metrics.upstreamConnect.Record(Clock::now() - m_connectStart);
+            }
+            if (m_upstreamRequestPos < m_upstreamRequest.size()) {
+                SendUpstreamRequest();
+                return;
+            }
+            if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                ReadUpstream();
+            }
+        } catch (const std::exception& e) {
+            if (CanRetryUpstream()) {
+                RetryUpstream();
+                return;
+            }
+            LOG_ERROR("Proxy", "Error fetching from upstream: " + std::string(e.what()));
+            FailUpstream();
+        }
+    }
+
+    void ReadRequest() {
+        char buffer[4096];
+        while (true) {
+            auto bytesRead = m_client.TryRead(buffer, sizeof(buffer));
+            if (!bytesRead) return;
+            if (*bytesRead == 0) {
+                Close();
+                return;
+            }
+            m_request.append(buffer, *bytesRead);
+            // Парсер продолжает с того места, где остановился, и не сканирует уже прочитанное заново
+            const auto result = m_parser.Parse(m_request);
+            if (result == HttpRequestParser::Result::Complete) break;
+            if (result == HttpRequestParser::Result::Error) {
+                LOG_WARNING("Proxy", "Malformed request: " + m_request.substr(0, m_request.find('\n')));
+                Close();
+                return;
+            }
+        }
+        m_requestDone = true;
+        m_loop.Modify(m_client.Get(), 0);
+        HandleRequest();
+    }
+
+    void HandleRequest() {
+        ParsedRequest req = HttpUtils::ParseRequest(m_parser.Request());
+
+        if (!req.isValid) {
+            LOG_WARNING("Proxy", "Invalid or unsupported request: " + m_request.substr(0, m_request.find('\n')));
+            Close();
+            return;
+        }
+
+        LOG_INFO("Proxy", "Request: " + req.method + " " + req.fullUrl);
+        m_metrics.requests.Add();
+        m_requestStart = Clock::now();
+
+        m_url = req.fullUrl;
+        auto hit = m_cache.Lookup(m_url);
+        if (hit) LoadHit(*hit);
+        if (hit && !hit->stale) {
+            LOG_INFO("Proxy", "Cache HIT: " + req.fullUrl);
+            m_metrics.cacheHits.Add();
+            m_servedFromCache = true;
+            m_sourceDone = true;
+            ApplyClientConditions();
+            FlushClient();
+            return;
+        }
+
+        m_host = req.host;
+        m_port = req.port;
+
+        m_upstreamRequest = "GET " + req.path + " " + req.version + "\r\n";
+        m_upstreamRequest += "Host: " + req.host + "\r\n";
+        if (hit) {
+            LOG_INFO("Proxy", "Cache STALE: Revalidating " + m_url);
+            m_revalidating = true;
+            if (!hit->meta->etag.empty()) {
+                m_upstreamRequest += "If-None-Match: " + hit->meta->etag + "\r\n";
+            }
+            if (!hit->meta->lastModified.empty()) {
+                m_upstreamRequest += "If-Modified-Since: " + hit->meta->lastModified + "\r\n";
+            }
+        }
+        m_upstreamRequest += "Connection: keep-alive\r\n\r\n";
+
+        if (m_revalidating) {
+            StartUpstream();
+            return;
+        }
+
+        LOG_INFO("Proxy", "Cache MISS: Fetching from " + req.host);
+        m_metrics.cacheMisses.Add();
+        BeginFill();
+        if (IsFollower()) {
+            LOG_INFO("Proxy", "Cache FILL: joining in-flight fetch of " + m_url);
+            m_metrics.fillJoins.Add();
+            FollowFill();
+            return;
+        }
+        if (m_fill) SubscribeFill();
+        StartUpstream();
+    }
+
+    // Файл уже открыт кэшем: пока устаревшая запись проверяется, её могут вытеснить или заменить
+    void LoadHit(CacheHit& hit) {
+        m_hitMeta = hit.meta;
+        m_hitBody = std::move(hit.memory);
+        if (!m_hitBody) {
+            m_hitFile = std::move(hit.file);
+            m_hitFileBase = hit.offset;
+            m_hitFileOffset = hit.offset;
+            m_hitFileEnd = hit.offset + static_cast<off_t>(hit.size);
+            return;
+        }
+        m_hitEnd = m_hitBody->size();
+        if (m_options.zeroCopy && m_hitBody->size() >= ZeroCopyThreshold) {
+            m_zeroCopy = m_client.EnableZeroCopy();
+        }
+    }
+
+    // Попадание отдаётся с учётом условий клиента: 304, если его копия актуальна, или запрошенные диапазоны.
+    // Валидаторы берутся из индекса, а границы тела — из заголовка сохранённого ответа
+    void ApplyClientConditions() {
+        const HttpRequestView& request = m_parser.Request();
+        if (HttpRange::IsNotModified(request, m_hitMeta->etag, m_hitMeta->lastModified)) {
+            LOG_INFO("Proxy", "Cache HIT: not modified " + m_url);
+            m_out = "HTTP/1.1 304 Not Modified\r\n";
+            if (!m_hitMeta->etag.empty()) m_out += "ETag: " + m_hitMeta->etag + "\r\n";
+            if (!m_hitMeta->lastModified.empty()) m_out += "Last-Modified: " + m_hitMeta->lastModified + "\r\n";
+            m_out += "Connection: close\r\n\r\n";
+            DropHitBody();
+            return;
+        }
+        if (request.Header("Range").empty()) return;
+
+        size_t headSize = 0;
+        std::string fields;
+        std::string contentType;
+        if (!HttpUtils::ParseStoredHead(ReadStoredHead(), headSize, fields, contentType)) return;
+        const uint64_t size = HitSize() - headSize;
+        const auto ranges = HttpRange::Parse(request, size, m_hitMeta->etag, m_hitMeta->lastModified);
+        if (!ranges) return;
+
+        if (ranges->empty()) {
+            m_out = "HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */" + std::to_string(size)
+                    + "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+            DropHitBody();
+            return;
+        }
+        LOG_INFO("Proxy", "Cache HIT: " + std::to_string(ranges->size()) + " range(s) of " + m_url);
+        m_hitHeadSize = headSize;
+        m_out = "HTTP/1.1 206 Partial Content\r\n" + fields;
+        if (ranges->size() == 1) {
+            const ByteRange& range = ranges->front();
+            if (!contentType.empty()) m_out += "Content-Type: " + contentType + "\r\n";
+            m_out += "Content-Range: " + HttpRange::ContentRange(range, size) + "\r\n";
+            m_out += "Content-Length: " + std::to_string(range.last - range.first + 1) + "\r\n";
+            SetHitSlice(range.first, range.last + 1);
+        } else {
+            // Исходный Content-Type повторяется в каждой части
+            const std::string boundary = HttpRange::MakeBoundary();
+            uint64_t length = 0;
+            m_rangeParts = HttpRange::Multipart(*ranges, size, contentType, boundary, length);
+            m_out += "Content-Type: multipart/byteranges; boundary=" + boundary + "\r\n";
+            m_out += "Content-Length: " + std::to_string(length) + "\r\n";
+            SetHitSlice(0, 0);
+        }
+        m_out += "Connection: close\r\n\r\n";
+    }
+
+    // Размер сохранённого ответа вместе с заголовком
+    uint64_t HitSize() const {
+        return m_hitBody ? m_hitBody->size() : static_cast<uint64_t>(m_hitFileEnd - m_hitFileBase);
+    }
+
+    // Заголовок сохранённого ответа не длиннее предела разбора ответов сервера
+    std::string ReadStoredHead() const {
+        const size_t size = static_cast<size_t>(std::min<uint64_t>(HitSize(), HttpResponseFramer::MaxHeaderSize));
+        if (m_hitBody) return m_hitBody->substr(0, size);
+        std::string head(size, '\0');
+        const ssize_t bytesRead = pread(m_hitFile.Get(), head.data(), size, m_hitFileBase);
+        head.resize(bytesRead > 0 ? static_cast<size_t>(bytesRead) : 0);
+        return head;
+    }
+
+    // Следующим отправляется кусок тела [begin, end), границы — от начала тела сохранённого ответа
+    void SetHitSlice(uint64_t begin, uint64_t end) {
+        if (m_hitBody) {
+            m_hitPos = m_hitHeadSize + begin;
+            m_hitEnd = m_hitHeadSize + end;
+        } else {
+            m_hitFileOffset = m_hitFileBase + static_cast<off_t>(m_hitHeadSize + begin);
+            m_hitFileEnd = m_hitFileBase + static_cast<off_t>(m_hitHeadSize + end);
+        }
+    }
+
+    // Переходит к следующей части multipart, когда предыдущая отправлена целиком
+    bool NextRangePart() {
+        if (m_rangePartIndex >= m_rangeParts.size() || (!m_hitBody && !m_hitFile.IsOpen())) return false;
+        const RangePart& part = m_rangeParts[m_rangePartIndex++];
+        m_out.append(part.head);
+        SetHitSlice(part.offset, part.end);
+        return true;
+    }
+
+    void DropHitBody() {
+        m_hitBody.reset();
+        m_hitFile.Close();
+    }
+
+    void BeginFill() {
+        try {
+            m_fill = m_cache.BeginFill(m_url, m_fillLeader, m_hitFile);
+        } catch (const std::exception& e) {
+            // Без записи в кэш ответ всё равно можно переслать клиенту
+            LOG_ERROR("Proxy", "Cache write failed: " + std::string(e.what()));
+            m_fillLeader = true;
+        }
+    }
+
+    void StartUpstream() {
+        // Сначала пробуем соединение из пула: без DNS и без рукопожатия TCP
+        m_upstream = m_pool.Acquire(m_host, m_port);
+        m_upstreamReused = m_upstream != nullptr;
+        if (m_upstreamReused) {
+            m_connected = true;
+            RegisterUpstream(EPOLLOUT);
+            return;
+        }
+        ConnectUpstream();
+    }
+
+    // Вместо своего запроса к серверу дочитываем файл, который заполняет ведущий запрос
+    void FollowFill() {
+        SubscribeFill();
+        m_sourceDone = true;
+        FlushClient();
+    }
+
+    // Подписчик читает файл заполнения по мере записи. Ведущий узнаёт о продвижении записи и о сбое диска
+    // по той же подписке и возобновляет чтение сервера, если очередь записи освободилась
+    void SubscribeFill() {
+        m_hitFileOffset = m_fill->BodyOffset();
+        std::weak_ptr<ProxySession> weak = weak_from_this();
+        m_fillWaiter = m_fill->Subscribe(m_loop, [weak] {
+            if (auto self = weak.lock()) self->OnFillProgress();
+        });
+    }
+
+    void OnFillProgress() {
+        if (m_closed && !m_clientGone) return;
+        try {
+            if (m_fillLeader && m_fill && m_fill->IsFailed()) {
+                // Данные, которые ещё не дошли до диска, есть только в уже очищенной очереди записи
+                if (m_fillFromFile) throw std::runtime_error("Cache fill aborted: " + m_url);
+                DropFill("write failed");
+            }
+            FlushClient();
+        } catch (const std::exception& e) {
+            LOG_ERROR("Proxy", "Client handler error: " + std::string(e.what()));
+            Close();
+        }
+    }
+
+    bool IsFollower() const {
+        return m_fill && !m_fillLeader;
+    }
+
+    // Имя разрешается в потоках HostResolver, результат возвращается в наш цикл через Post
+    void ConnectUpstream() {
+        m_connectStart = Clock::now();
+        std::weak_ptr<ProxySession> weak = weak_from_this();
+        EventLoop& loop = m_loop;
+        m_resolver.ResolveAsync(m_host, [weak, &loop](HostResolver::Result result) {
+            loop.Post([weak, result = std::move(result)] {
+                if (auto self = weak.lock()) self->OnResolved(*result);
+            });
+        });
+    }
+
+    void OnResolved(const HostAddresses& result) {
+        if (m_closed && !m_clientGone) return;
+        try {
+            if (!result.Ok()) throw std::runtime_error(result.error);
+            m_upstream = std::make_unique<UpstreamConnection>(m_host, m_port, result.addresses);
+            m_connected = false;
+            RegisterUpstream(EPOLLOUT);
+        } catch (const std::exception& e) {
+            LOG_ERROR("Proxy", "Error fetching from upstream: " + std::string(e.what()));
+            FailUpstream();
+        }
+    }
+
+    // Соединение из пула мог закрыть сервер, пока оно простаивало.
+    // Если ответ ещё не начался, запрос безопасно повторить по новому соединению
+    bool CanRetryUpstream() const {
+        return m_upstreamReused && !m_framer.HasHeaders() && m_totalBytes == 0;
+    }
+
+    void RetryUpstream() {
+        m_loop.Remove(m_upstream->Get());
+        m_upstream.reset();
+        m_upstreamReused = false;
+        m_upstreamRequestPos = 0;
+        m_framer = HttpResponseFramer{};
+        m_upstreamHead.clear();
+        m_out.clear();
+        ConnectUpstream();
+    }
+
+    void FinishUpstream() {
+        LOG_INFO("Proxy", "Completed: " + m_url + " (" + std::to_string(m_totalBytes) + " bytes)");
+        m_sourceDone = true;
+        ReleaseUpstream();
+        if (m_fill) m_cache.Commit(m_url, m_framer.Headers());
+    }
+
+    void ReleaseUpstream() {
+        m_loop.Remove(m_upstream->Get());
+        if (m_framer.KeepAlive() && !m_upstreamDirty) {
+            m_pool.Release(m_host, m_port, std::move(m_upstream));
+        }
+        m_upstream.reset();
+    }
+
+    // Ответ на условный GET получен целиком по заголовкам: 304 подтверждает сохранённую копию,
+    // любой другой ответ заменяет её и дальше пересылается как при обычном промахе
+    void OnRevalidationResponse() {
+        m_revalidating = false;
+        if (m_framer.StatusCode() == 304) {
+            LOG_INFO("Proxy", "Cache REVALIDATED: " + m_url);
+            m_metrics.cacheRevalidated.Add();
+            m_servedFromCache = true;
+            m_out.clear();
+            m_sourceDone = true;
+            ReleaseUpstream();
+            m_cache.Refresh(m_url, m_framer.Headers());
+            ApplyClientConditions();
+            return;
+        }
+
+        LOG_INFO("Proxy", "Cache MISS: " + m_url + " changed on server");
+        m_metrics.cacheMisses.Add();
+        m_hitMeta.reset();
+        m_hitBody.reset();
+        m_hitFile.Close();
+        m_hitFileOffset = 0;
+        m_hitFileEnd = 0;
+        m_zeroCopy = false;
+        BeginFill();
+        if (IsFollower()) {
+            // Новую версию уже загружает другой запрос; этот ответ просто пересылаем без записи
+            m_fill.reset();
+        }
+        if (m_fill) {
+            SubscribeFill();
+            AppendFill(m_out.data(), m_out.size());
+        }
+    }
+
+    void RegisterUpstream(uint32_t events) {
+        auto self = shared_from_this();
+        m_loop.Add(m_upstream->Get(), events, [self](uint32_t ev) {
+            self->OnUpstreamEvent(ev);
+        });
+    }
+
+    void SendUpstreamRequest() {
+        while (m_upstreamRequestPos < m_upstreamRequest.size()) {
+            auto sent = m_upstream->TrySend(m_upstreamRequest.data() + m_upstreamRequestPos,
+                                            m_upstreamRequest.size() - m_upstreamRequestPos);
+            if (!sent) return;
+            m_upstreamRequestPos += *sent;
+        }
+        m_requestSent = Clock::now();
+        m_loop.Modify(m_upstream->Get(), EPOLLIN);
+    }
+
+    void ReadUpstream() {
+        char buffer[16384];
+        while (HasUpstreamRoom()) {
+            auto bytesRead = m_upstream->TryReceive(buffer, sizeof(buffer));
+            if (!bytesRead) break;
+            if (*bytesRead == 0) {
+                if (CanRetryUpstream()) {
+                    RetryUpstream();
+                    return;
+                }
+                if (!m_framer.OnEof()) {
+                    throw std::runtime_error("Upstream closed connection mid-response");
+                }
+                FinishUpstream();
+                break;
+            }
+            // Всё, что сервер прислал сверх границы ответа, отбрасывается вместе с соединением
+            const size_t size = m_framer.Feed(buffer, *bytesRead);
+            if (size < *bytesRead) m_upstreamDirty = true;
+            if (m_totalBytes == 0) m_metrics.upstreamTtfb.Record(Clock::now() - m_requestSent);
+            m_totalBytes += size;
+            const char* data = buffer;
+            size_t length = size;
+            if (!m_framer.HasHeaders() || !m_upstreamHead.empty()) {
+                // Заголовок копится, пока не придёт окончательный: промежуточные 1xx не идут ни клиенту, ни в кэш
+                m_upstreamHead.append(buffer, size);
+                if (!m_framer.HasHeaders()) continue;
+                m_upstreamHead.erase(0, m_framer.InterimSize());
+                data = m_upstreamHead.data();
+                length = m_upstreamHead.size();
+            }
+            if (m_revalidating) {
+                // Пока не ясно, 304 это или новое тело, ответ копится в буфере и клиенту не уходит
+                m_out.append(data, length);
+                m_upstreamHead.clear();
+                OnRevalidationResponse();
+                if (m_sourceDone) break;
+            } else {
+                if (m_fill) AppendFill(data, length);
+                if (!m_fillFromFile && !m_clientGone) m_out.append(data, length);
+            }
+            m_upstreamHead.clear();
+            if (m_framer.IsComplete()) {
+                FinishUpstream();
+                break;
+            }
+        }
+        if (m_revalidating) return;
+        if (m_upstream && !HasUpstreamRoom()) {
+            // Клиент или диск не успевают — перестаём читать сервер, пока очередь не освободится
+            m_loop.Modify(m_upstream->Get(), 0);
+            if (WaitsForDisk()) StartDiskStall();
+        }
+        FlushClient();
+    }
+
+    // Отправляет клиенту всё, что готово: буфер, затем тело из памяти или файл с диска через sendfile
+    void FlushClient() {
+        if (m_clientGone) {
+            // Клиента нет: ответ дочитывается только ради заполнения кэша
+            if (m_sourceDone || !m_fill) EndDetached(); else ResumeUpstream();
+            return;
+        }
+        if (m_fill && m_hitFileOffset == m_fill->BodyOffset() && m_hitFile.IsOpen() && m_fill->IsFailed()) {
+            m_hitFile.Close();
+            m_out = "HTTP/1.0 502 Bad Gateway\r\n\r\n";
+            m_outPos = 0;
+        }
+
+        bool blocked = false;
+        bool waiting = false;
+        do {
+            // Заголовок и тело из памяти уходят одним вызовом, если тело не отправляется через MSG_ZEROCOPY
+            while (!blocked && m_outPos < m_out.size() && m_hitBody && m_hitPos < m_hitEnd &&
+                   !(m_zeroCopy && m_hitEnd - m_hitPos >= ZeroCopyThreshold)) {
+                iovec iov[2] = {{m_out.data() + m_outPos, m_out.size() - m_outPos},
+                                {const_cast<char*>(m_hitBody->data()) + m_hitPos, m_hitEnd - m_hitPos}};
+                auto sent = m_client.TrySendV(iov, 2);
+                if (!sent) {
+                    blocked = true;
+                    break;
+                }
+                m_metrics.bytesServed.Add(*sent);
+                const size_t head = std::min(*sent, m_out.size() - m_outPos);
+                m_outPos += head;
+                m_hitPos += *sent - head;
+            }
+            while (!blocked && m_outPos < m_out.size()) {
+                auto sent = m_client.TrySend(m_out.data() + m_outPos, m_out.size() - m_outPos);
+                if (sent) m_outPos += *sent; else blocked = true;
+                if (sent) m_metrics.bytesServed.Add(*sent);
+            }
+            while (!blocked && m_hitBody && m_hitPos < m_hitEnd) {
+                const char* data = m_hitBody->data() + m_hitPos;
+                const size_t remaining = m_hitEnd - m_hitPos;
+                std::optional<size_t> sent;
+                if (m_zeroCopy && remaining >= ZeroCopyThreshold) {
+                    bool zeroCopied = false;
+                    sent = m_client.TrySendZeroCopy(data, remaining, zeroCopied);
+                    if (zeroCopied) ++m_zeroCopyPending;
+                } else {
+                    sent = m_client.TrySend(data, remaining);
+                }
+                if (sent) m_hitPos += *sent; else blocked = true;
+                if (sent) m_metrics.bytesServed.Add(*sent);
+            }
+            // Без заполнения файл остаётся открытым до конца сессии: из него могут читаться следующие части
+            while (!blocked && !waiting && m_hitFile.IsOpen() && (m_fill || m_hitFileOffset < m_hitFileEnd)) {
+                off_t end = m_hitFileEnd;
+                if (m_fill) {
+                    // Состояние читаем до размера: у завершённого заполнения размер уже окончательный
+                    const bool failed = m_fill->IsFailed();
+                    const bool finished = m_fill->IsFinished();
+                    end = m_fill->BodyOffset() + static_cast<off_t>(m_fill->Written());
+                    if (m_hitFileOffset >= end) {
+                        if (failed) throw std::runtime_error("Cache fill aborted: " + m_url);
+                        if (finished) m_hitFile.Close(); else waiting = true;
+                        continue;
+                    }
+                }
+                auto sent = m_client.TrySendFile(m_hitFile.Get(), m_hitFileOffset,
+                                                 static_cast<size_t>(end - m_hitFileOffset));
+                if (sent) m_metrics.bytesServed.Add(*sent);
+                if (!sent) {
+                    blocked = true;
+                } else if (*sent == 0) {
+                    m_hitFile.Close();
+                }
+            }
+        } while (!blocked && !waiting && NextRangePart());
+
+        if (m_outPos == m_out.size()) {
+            m_out.clear();
+            m_outPos = 0;
+        } else if (m_outPos > m_out.size() / 2) {
+            m_out.erase(0, m_outPos);
+            m_outPos = 0;
+        }
+
+        if (!blocked && !waiting && m_sourceDone) {
+            Close();
+            return;
+        }
+        m_loop.Modify(m_client.Get(), blocked ? uint32_t{EPOLLOUT} : 0);
+        if (blocked && m_fill && m_fillLeader && !m_fillFromFile && m_upstream
+            && m_out.size() - m_outPos >= MaxPendingOutput) {
+            SpillToFile();
+        }
+        ResumeUpstream();
+    }
+
+    void ResumeUpstream() {
+        if (m_upstream && m_connected && m_upstreamRequestPos == m_upstreamRequest.size() && HasUpstreamRoom()) {
+            m_loop.Modify(m_upstream->Get(), EPOLLIN);
+            EndDiskStall();
+        }
+    }
+
+    // Клиент ждёт только диск: файл заполнения никто не читает, а очередь записи полна
+    bool WaitsForDisk() {
+        return m_fill && !m_fill->HasRoom() && !m_fillFromFile && !m_clientGone && m_fill->Subscribers() <= 1;
+    }
+
+    // Короткие задержки записи переживаем, а если за ответ диск задержал клиента дольше MaxDiskStall,
+    // копия в кэше отменяется и ответ идёт дальше только из памяти
+    void StartDiskStall() {
+        if (m_diskStallTimer != 0) return;
+        m_diskStallStart = Clock::now();
+        const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(MaxDiskStall - m_diskStall);
+        std::weak_ptr<ProxySession> weak = weak_from_this();
+        m_diskStallTimer = m_loop.RunAfter(std::max(remaining, std::chrono::milliseconds{0}), [weak] {
+            if (auto self = weak.lock()) self->OnDiskStall();
+        });
+    }
+
+    void EndDiskStall() {
+        if (m_diskStallTimer == 0) return;
+        m_loop.CancelTimer(m_diskStallTimer);
+        m_diskStallTimer = 0;
+        m_diskStall += Clock::now() - m_diskStallStart;
+    }
+
+    void OnDiskStall() {
+        m_diskStallTimer = 0;
+        m_diskStall += Clock::now() - m_diskStallStart;
+        if (m_closed || !WaitsForDisk()) return;
+        try {
+            DropFill("disk is too slow");
+            ResumeUpstream();
+        } catch (const std::exception& e) {
+            LOG_ERROR("Proxy", "Client handler error: " + std::string(e.what()));
+            Close();
+        }
+    }
+
+    // Сервер читается, пока есть место и в очереди записи на диск, и в буфере клиента.
+    // Клиент, перешедший на файл заполнения или ушедший, чтение сервера не сдерживает
+    bool HasUpstreamRoom() const {
+        if (m_fill && !m_fill->HasRoom()) return false;
+        if (m_fillFromFile || m_clientGone) return true;
+        return m_out.size() - m_outPos < MaxPendingOutput;
+    }
+
+    // Ответ сервера уходит в заполнение. При сбое записи отменяется только копия в кэше:
+    // клиент, который ещё не перешёл на файл заполнения, получает ответ дальше из памяти
+    void AppendFill(const char* data, size_t size) {
+        if (m_fill->IsFailed()) {
+            if (m_fillFromFile) throw std::runtime_error("Cache fill aborted: " + m_url);
+            DropFill("write failed");
+            return;
+        }
+        m_fill->Append(data, size);
+        m_fillAppended += size;
+    }
+
+    void DropFill(const std::string& reason) {
+        LOG_WARNING("Proxy", "Cache fill dropped (" + reason + "): " + m_url);
+        m_cache.Remove(m_url);
+        m_fill.reset();
+        m_fillWaiter.reset();
+    }
+
+    // Клиент ведущего не забирает буфер: вместо того чтобы тормозить сервер, а с ним и подписчиков,
+    // он дальше читает файл заполнения с первого байта после буфера, как подписчик
+    void SpillToFile() {
+        m_hitFile = FileDesc(open(m_fill->Path().c_str(), O_RDONLY | O_CLOEXEC));
+        if (!m_hitFile.IsOpen()) return;
+        m_hitFileOffset = m_fill->BodyOffset() + static_cast<off_t>(m_fillAppended);
+        m_fillFromFile = true;
+    }
+
+    void FailUpstream() {
+        m_metrics.upstreamErrors.Add();
+        if (m_upstream) {
+            m_loop.Remove(m_upstream->Get());
+            m_upstream.reset();
+        }
+        if (m_revalidating) {
+            // Сервер недоступен — отдаём устаревшую копию (RFC 9111, 4.2.4), это лучше, чем 502
+            LOG_INFO("Proxy", "Cache STALE: Serving " + m_url + " without revalidation");
+            m_metrics.cacheStale.Add();
+            m_servedFromCache = true;
+            m_revalidating = false;
+            m_out.clear();
+            m_outPos = 0;
+            m_sourceDone = true;
+            ApplyClientConditions();
+            FlushClient();
+            return;
+        }
+        if (m_fill && m_fillLeader) {
+            // Клиент, читающий файл заполнения, увидит его сбой и обрыв соединения
+            m_cache.Remove(m_url);
+            if (!m_fillFromFile) {
+                m_fill.reset();
+                m_fillWaiter.reset();
+            }
+        }
+        // Пока нет окончательного заголовка, клиенту ещё ничего не ушло
+        if (!m_fill && !m_framer.HasHeaders()) {
+            m_out = "HTTP/1.0 502 Bad Gateway\r\n\r\n";
+            m_outPos = 0;
+        }
+        m_sourceDone = true;
+        try {
+            FlushClient();
+        } catch (const std::exception& e) {
+            LOG_ERROR("Proxy", "Client handler error: " + std::string(e.what()));
+            Close();
+        }
+    }
+
+    void Close() {
+        if (m_closed) {
+            if (m_clientGone) EndDetached();
+            return;
+        }
+        m_closed = true;
+        m_loop.CancelTimer(m_diskStallTimer);
+        if (m_requestStart != Clock::time_point{}) {
+            auto& duration = m_servedFromCache ? m_metrics.hitDuration : m_metrics.missDuration;
+            duration.Record(Clock::now() - m_requestStart);
+        }
+        if (m_fill && m_fillLeader && !m_sourceDone && !m_fill->IsFailed()) {
+            // Загрузку ждут подписчики и кэш: ушедший клиент её не прерывает, сессия дочитывает сервер сама
+            LOG_INFO("Proxy", "Client left, finishing cache fill: " + m_url);
+            m_clientGone = true;
+            m_detachedSelf = shared_from_this();
+            m_fillFromFile = false;
+            m_hitFile.Close();
+            m_out.clear();
+            m_outPos = 0;
+        } else {
+            if (m_upstream) {
+                m_loop.Remove(m_upstream->Get());
+                m_upstream.reset();
+            }
+            if (m_fill && m_fillLeader && !m_sourceDone) {
+                // Недокачанный ответ не должен считаться попаданием в кэш
+                m_cache.Remove(m_url);
+            }
+            m_fillWaiter.reset();
+        }
+        if (m_zeroCopyPending > 0) {
+            // Ядро ещё держит страницы тела: буфер можно отпустить только после всех уведомлений
+            m_loop.Modify(m_client.Get(), 0);
+            return;
+        }
+        m_loop.Remove(m_client.Get());
+    }
+
+    // Заполнение без клиента закончилось: загружено целиком, отменено или сервер не ответил
+    void EndDetached() {
+        if (m_upstream) {
+            m_loop.Remove(m_upstream->Get());
+            m_upstream.reset();
+        }
+        if (m_fill && !m_sourceDone) m_cache.Remove(m_url);
+        m_fillWaiter.reset();
+        m_clientGone = false;
+        // Сессию держит только эта ссылка, а мы ещё внутри её метода
+        m_loop.Post([self = std::move(m_detachedSelf)] {});
+    }
+
+    EventLoop& m_loop;
+    Socket m_client;
+    HttpCache& m_cache;
+    UpstreamPool& m_pool;
+    HostResolver& m_resolver;
+    WorkerMetrics& m_metrics;
+    const ProxyOptions& m_options;
+
+    std::string m_request;
+    HttpRequestParser m_parser;
+    bool m_requestDone = false;
+    std::string m_url;
+
+    std::string m_host;
+    int m_port = 80;
+    std::unique_ptr<UpstreamConnection> m_upstream;
+    bool m_upstreamReused = false;
+    bool m_upstreamDirty = false;
+    HttpResponseFramer m_framer;
+    // Начало ответа до окончательной строки статуса
+    std::string m_upstreamHead;
+    bool m_connected = false;
+    std::string m_upstreamRequest;
+    size_t m_upstreamRequestPos = 0;
+    bool m_sourceDone = false;
+    bool m_revalidating = false;
+    size_t m_totalBytes = 0;
+    std::shared_ptr<CacheFill> m_fill;
+    bool m_fillLeader = false;
+    // Сколько байт ответа ведущий передал в заполнение; столько же ушло в буфер клиента до перехода на файл
+    uint64_t m_fillAppended = 0;
+    bool m_fillFromFile = false;
+    // Сколько клиент уже прождал диск за этот ответ
+    Clock::duration m_diskStall{};
+    Clock::time_point m_diskStallStart;
+    EventLoop::TimerId m_diskStallTimer = 0;
+    std::shared_ptr<CacheFill::Waiter> m_fillWaiter;
+
+    CacheIndex::Entry m_hitMeta;
+    MemoryCache::Value m_hitBody;
+    size_t m_hitPos = 0;
+    size_t m_hitEnd = 0;
+    FileDesc m_hitFile;
+    off_t m_hitFileBase = 0;
+    off_t m_hitFileOffset = 0;
+    off_t m_hitFileEnd = 0;
+    size_t m_hitHeadSize = 0;
+    std::vector<RangePart> m_rangeParts;
+    size_t m_rangePartIndex = 0;
+    bool m_zeroCopy = false;
+    size_t m_zeroCopyPending = 0;
+
+    std::string m_out;
+    size_t m_outPos = 0;
+    bool m_closed = false;
+    // Клиент ведущего ушёл, а сессия дочитывает ответ сервера в кэш и держит себя сама
+    bool m_clientGone = false;
+    std::shared_ptr<ProxySession> m_detachedSelf;
+
+    Clock::time_point m_requestStart;
+    Clock::time_point m_connectStart;
+    Clock::time_point m_requestSent;
+    bool m_servedFromCache = false;
+};
@@ -2,74 +2,111 @@
 #include "../lib/FileDesc.h"
 #include <arpa/inet.h>
 #include <netinet/in.h>
-#include <netdb.h>
-#include <iostream>
+#include <sys/socket.h>
+#include <optional>
 #include <vector>
-#include <cstring>
+#include <string>
 
+// Неблокирующее соединение с целевым сервером. Подключение завершается асинхронно:
+// после EPOLLOUT нужно вызвать FinishConnect()
 class UpstreamConnection
 {
 public:
-    UpstreamConnection(const std::string& host, int port)
+    // Адреса уже разрешены (HostResolver); пробуются по очереди, пока один не примет подключение
+    UpstreamConnection(const std::string& host, int port, const std::vector<in_addr>& addresses)
+            : m_host(host)
     {
-        sockaddr_in addr{};
-        addr.sin_family = AF_INET;
-        addr.sin_port = htons(port);
-
-        addrinfo hints{};
-        hints.ai_family = AF_INET;
-        hints.ai_socktype = SOCK_STREAM;
-
-        addrinfo* result;
-        std::string portStr = std::to_string(port);
-        const int status = getaddrinfo(host.c_str(), portStr.c_str(), &hints, &result);
+        for (const auto& address : addresses) {
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(static_cast<uint16_t>(port));
+            addr.sin_addr = address;
+            m_addresses.push_back(addr);
+        }
 
-        if (status != 0)
+        if (!ConnectNext())
         {
-            throw std::runtime_error("DNS resolution failed for " + host + ": " + gai_strerror(status));
+            throw std::runtime_error("Connection to " + host + " failed");
         }
+    }
 
-        bool connected = false;
-        for (addrinfo* rp = result; rp != nullptr; rp = rp->ai_next) {
-            int sock = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
-            if (sock == -1) continue;
-
-            m_fd = FileDesc(sock);
-            if (connect(m_fd.Get(), rp->ai_addr, rp->ai_addrlen) != -1) {
-                connected = true;
-                break;
-            }
-            m_fd.Close();
+    // true — соединение установлено, false — ещё ждём; исключение, если все адреса исчерпаны
+    bool FinishConnect()
+    {
+        int error = 0;
+        socklen_t len = sizeof(error);
+        if (getsockopt(m_fd.Get(), SOL_SOCKET, SO_ERROR, &error, &len) == -1)
+        {
+            error = errno;
         }
-
-        freeaddrinfo(result);
-
-        if (!connected)
+        if (error == 0)
         {
-            throw std::runtime_error("Connection to " + host + " failed");
+            return true;
+        }
+        if (error == EINPROGRESS || error == EALREADY)
+        {
+            return false;
         }
+        if (!ConnectNext())
+        {
+            throw std::runtime_error("Connection to " + m_host + " failed");
+        }
+        return false;
     }
 
-    void Send(const std::string& message)
+    std::optional<size_t> TrySend(const char* data, size_t size)
     {
-        size_t totalSent = 0;
-        while (totalSent < message.size()) {
-            ssize_t sent = send(m_fd.Get(), message.data() + totalSent, message.size() - totalSent, 0);
-            if (sent == -1) throw std::runtime_error("Failed to send request");
-            totalSent += sent;
+        ssize_t sent = send(m_fd.Get(), data, size, MSG_NOSIGNAL);
+        if (sent == -1)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return std::nullopt;
+            throw std::runtime_error("Failed to send request");
         }
+        return static_cast<size_t>(sent);
     }
 
-    size_t Receive(char* buffer, size_t size)
+    std::optional<size_t> TryReceive(char* buffer, size_t size)
     {
         ssize_t bytesRead = recv(m_fd.Get(), buffer, size, 0);
         if (bytesRead == -1)
         {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return std::nullopt;
             throw std::runtime_error("Failed to receive data");
         }
         return static_cast<size_t>(bytesRead);
     }
 
+    // Простаивающее соединение живо, если сервер его не закрыл и ничего не прислал без запроса
+    bool IsAlive() const
+    {
+        char byte;
+        const ssize_t result = recv(m_fd.Get(), &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+        return result == -1 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+
+    [[nodiscard]] int Get() const noexcept
+    {
+        return m_fd.Get();
+    }
+
 private:
+    bool ConnectNext()
+    {
+        while (m_next < m_addresses.size()) {
+            const auto& addr = m_addresses[m_next++];
+            m_fd = FileDesc(socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+            if (!m_fd.IsOpen()) continue;
+
+            if (connect(m_fd.Get(), reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0 || errno == EINPROGRESS) {
+                return true;
+            }
+            m_fd.Close();
+        }
+        return false;
+    }
+
+    std::string m_host;
+    std::vector<sockaddr_in> m_addresses;
+    size_t m_next = 0;
     FileDesc m_fd;
-};
\ No newline at end of file
+};
@@ -0,0 +1,114 @@
+#pragma once
+#include "../lib/EventLoop.h"
+#include "UpstreamConnection.h"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// Пул keep-alive соединений с серверами по ключу (host, port).
+// Свой у каждого цикла событий, поэтому блокировки не нужны.
+// Простаивающих соединений не больше MaxIdle на весь пул, лишние закрываются начиная с самых старых;
+// таймер цикла периодически закрывает просроченные и закрытые сервером
+class UpstreamPool {
+public:
+    explicit UpstreamPool(EventLoop& loop)
+            : m_loop(loop) {
+        ScheduleSweep();
+    }
+
+    UpstreamPool(const UpstreamPool&) = delete;
+    UpstreamPool& operator=(const UpstreamPool&) = delete;
+
+    ~UpstreamPool() {
+        m_loop.CancelTimer(m_sweepTimer);
+    }
+
+    std::unique_ptr<UpstreamConnection> Acquire(const std::string& host, int port) {
+        auto it = m_byHost.find(Key(host, port));
+        if (it == m_byHost.end()) return nullptr;
+
+        auto& idle = it->second;
+        const auto now = std::chrono::steady_clock::now();
+        std::unique_ptr<UpstreamConnection> connection;
+        while (!idle.empty() && !connection) {
+            const auto entry = idle.back();
+            idle.pop_back();
+            if (now - entry->since < MaxIdleTime && entry->connection->IsAlive()) {
+                connection = std::move(entry->connection);
+            }
+            m_idle.erase(entry);
+        }
+        if (idle.empty()) m_byHost.erase(it);
+        return connection;
+    }
+
+    void Release(const std::string& host, int port, std::unique_ptr<UpstreamConnection> connection) {
+        std::string key = Key(host, port);
+        auto& idle = m_byHost[key];
+        if (idle.size() >= MaxIdlePerHost) {
+            m_idle.erase(idle.front());
+            idle.pop_front();
+        }
+        idle.push_back(m_idle.insert(m_idle.end(),
+                                     IdleConnection{std::move(key), std::move(connection),
+                                                    std::chrono::steady_clock::now()}));
+        if (m_idle.size() > MaxIdle) {
+            Evict(m_idle.begin());
+        }
+    }
+
+private:
+    static constexpr size_t MaxIdlePerHost = 8;
+    static constexpr size_t MaxIdle = 256;
+    static constexpr auto MaxIdleTime = std::chrono::seconds(30);
+    static constexpr auto SweepInterval = std::chrono::seconds(5);
+
+    struct IdleConnection {
+        std::string key;
+        std::unique_ptr<UpstreamConnection> connection;
+        std::chrono::steady_clock::time_point since;
+    };
+
+    // Все простаивающие соединения от давно возвращённых к недавним; по ключу — те же, в том же порядке
+    using IdleList = std::list<IdleConnection>;
+
+    static std::string Key(const std::string& host, int port) {
+        return host + ":" + std::to_string(port);
+    }
+
+    void Evict(IdleList::iterator entry) {
+        auto it = m_byHost.find(entry->key);
+        auto& idle = it->second;
+        idle.erase(std::find(idle.begin(), idle.end(), entry));
+        if (idle.empty()) m_byHost.erase(it);
+        m_idle.erase(entry);
+    }
+
+    void ScheduleSweep() {
+        m_sweepTimer = m_loop.RunAfter(SweepInterval, [this] {
+            Sweep();
+            ScheduleSweep();
+        });
+    }
+
+    // Соединения, которые Acquire уже не выдал бы: простояли дольше MaxIdleTime или закрыты сервером
+    void Sweep() {
+        const auto now = std::chrono::steady_clock::now();
+        for (auto entry = m_idle.begin(); entry != m_idle.end();) {
+            const auto next = std::next(entry);
+            if (now - entry->since >= MaxIdleTime || !entry->connection->IsAlive()) {
+                Evict(entry);
+            }
+            entry = next;
+        }
+    }
+
+    EventLoop& m_loop;
+    EventLoop::TimerId m_sweepTimer = 0;
+    IdleList m_idle;
+    std::unordered_map<std::string, std::deque<IdleList::iterator>> m_byHost;
+};
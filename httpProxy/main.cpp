@@ -1,105 +1,131 @@
 #include "../lib/Acceptor.h"
+#include "../lib/EventLoop.h"
+#include "../lib/HostResolver.h"
 #include "../lib/Socket.h"
-#include "UpstreamConnection.h"
-#include "HttpUtils.h"
+#include "../dnsResolver/src/DnsResolver.h"
+#include "AdminServer.h"
+#include "ProxyContext.h"
+#include "ProxySession.h"
+#include "../lib/Logger.h"
 #include "HttpCache.h"
+#include "ProxyMetrics.h"
+#include <csignal>
 #include <iostream>
 #include <thread>
 #include <vector>
-#include <mutex>
-#include <atomic>
 
-std::mutex logMutex;
-HttpCache cache;
+ProxyOptions options;
 
-void Log(const std::string& msg) {
-    std::lock_guard<std::mutex> lock(logMutex);
-    std::cout << "[Proxy] " << msg << std::endl;
-}
-
-void HandleClient(Socket clientSocket) {
-    try {
-        char buffer[8192];
-        size_t bytesRead = clientSocket.Read(buffer, sizeof(buffer) - 1);
-        if (bytesRead == 0) return;
-
-        buffer[bytesRead] = '\0';
-        std::string rawRequest(buffer);
-
-        ParsedRequest req = HttpUtils::ParseRequest(rawRequest);
-
-        if (!req.isValid) {
-            Log("Invalid or unsupported request: " + rawRequest.substr(0, rawRequest.find('\n')));
-            return;
-        }
-
-        Log("Request: " + req.method + " " + req.fullUrl);
-
-        if (cache.Has(req.fullUrl)) {
-            Log("Cache HIT: " + req.fullUrl);
-            cache.ServeFromCache(req.fullUrl, [&](const char* data, size_t len) {
-                clientSocket.Send(data, len, 0);
-            });
-            return;
-        }
-
-        Log("Cache MISS: Fetching from " + req.host);
+// Каждый поток держит свой слушающий сокет (SO_REUSEPORT) и свой цикл событий,
+// поэтому потоки не делят между собой ни соединения, ни блокировки на приёме
+void RunWorker(const sockaddr_in& addr, HttpCache& cache, HostResolver& resolver, WorkerMetrics& metrics,
+               IoBackend backend) {
+    EventLoop loop(backend);
+    if (backend == IoBackend::Uring && !loop.UsesIoUring()) {
+        LOG_WARNING("Proxy", "io_uring is not supported by the kernel, falling back to epoll");
+    }
+    UpstreamPool pool(loop);
+    const WorkerContext ctx{loop, cache, pool, resolver, metrics, options};
+    Acceptor acceptor(addr, SOMAXCONN, /*reusePort*/ true);
+    acceptor.SetNonBlocking();
 
+    loop.AddAcceptor(acceptor.Get(), [&](FileDesc client) {
         try {
-            UpstreamConnection server(req.host, req.port);
-
-            std::string newRequest = "GET " + req.path + " " + req.version + "\r\n";
-            newRequest += "Host: " + req.host + "\r\n";
-            newRequest += "Connection: close\r\n\r\n";
-
-            server.Send(newRequest);
-
-            auto cacheFile = cache.OpenWrite(req.fullUrl);
-
-            char remoteBuf[4096];
-            size_t remoteRead;
-            size_t totalBytes = 0;
-
-            while ((remoteRead = server.Receive(remoteBuf, sizeof(remoteBuf))) > 0) {
-                clientSocket.Send(remoteBuf, remoteRead, 0);
-                if (cacheFile.is_open()) {
-                    cacheFile.write(remoteBuf, remoteRead);
-                }
-                totalBytes += remoteRead;
-            }
-
-            Log("Completed: " + req.fullUrl + " (" + std::to_string(totalBytes) + " bytes)");
-
+            std::make_shared<ProxySession>(ctx, Socket{std::move(client)})->Start();
         } catch (const std::exception& e) {
-            Log("Error fetching from upstream: " + std::string(e.what()));
-            std::string errorResponse = "HTTP/1.0 502 Bad Gateway\r\n\r\n";
-            clientSocket.Send(errorResponse.data(), errorResponse.size(), 0);
+            LOG_ERROR("Proxy", "Client handler error: " + std::string(e.what()));
         }
+    });
 
-    } catch (const std::exception& e) {
-        Log("Client handler error: " + std::string(e.what()));
+    loop.Run();
+}
+
+// Источник адресов для --dns=iterative: собственный итеративный резолвер, который в отличие от getaddrinfo
+// сообщает TTL ответа
+HostResolver::Lookup ResolveIteratively(const std::string& host) {
+    DnsResolver dns;
+    const DnsAnswer answer = dns.ResolveAnswer(host, DnsRecordType::A);
+    HostResolver::Lookup lookup{{}, std::chrono::seconds(answer.TTL)};
+    for (const auto& address : answer.Addresses) {
+        in_addr addr{};
+        if (inet_pton(AF_INET, address.c_str(), &addr) == 1) lookup.addresses.push_back(addr);
+    }
+    if (lookup.addresses.empty()) {
+        throw std::runtime_error("DNS resolution failed for " + host);
     }
+    return lookup;
 }
 
 int main(int argc, char* argv[]) {
+    std::vector<std::string> args;
+    uint64_t cacheSize = HttpCache::DefaultDiskBudget;
+    HostResolver::Backend dnsBackend = HostResolver::GetAddrInfo;
+    int adminPort = 0;
+    IoBackend backend = IoBackend::Epoll;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--zerocopy") {
+            options.zeroCopy = true;
+        } else if (arg == "--io-uring") {
+            backend = IoBackend::Uring;
+        } else if (arg == "--dns=iterative") {
+            dnsBackend = ResolveIteratively;
+        } else if (arg.rfind("--admin-port=", 0) == 0) {
+            adminPort = std::stoi(arg.substr(std::string("--admin-port=").size()));
+        } else if (arg.rfind("--cache-size=", 0) == 0) {
+            cacheSize = std::stoull(arg.substr(std::string("--cache-size=").size())) * 1024 * 1024;
+        } else {
+            args.emplace_back(argv[i]);
+        }
+    }
+
     int port = 8080;
-    if (argc > 1) {
-        port = std::stoi(argv[1]);
+    if (args.size() > 0) {
+        port = std::stoi(args[0]);
+    }
+    unsigned workers = std::max(1u, std::thread::hardware_concurrency());
+    if (args.size() > 1) {
+        workers = std::max(1, std::stoi(args[1]));
     }
 
+    std::signal(SIGPIPE, SIG_IGN);
+
     try {
         sockaddr_in addr{};
         addr.sin_family = AF_INET;
         addr.sin_addr.s_addr = INADDR_ANY;
         addr.sin_port = htons(port);
 
-        Acceptor acceptor(addr, 10);
-        Log("Proxy Server started on port " + std::to_string(port));
-        Log("Cache directory: ./cache");
-
-        while (true) {
-            Socket client = acceptor.Accept();
-            std::thread(HandleClient, std::move(client)).detach();
+        // Первый сокет создаётся в главном потоке, чтобы ошибка bind всплыла до старта воркеров
+        { Acceptor probe(addr, SOMAXCONN, /*reusePort*/ true); }
+
+        LOG_INFO("Proxy", "Proxy Server started on port " + std::to_string(port) + " with " + std::to_string(workers) + " event loops");
+        HttpCache cache(cacheSize);
+        HostResolver resolver(dnsBackend);
+        ProxyMetrics metrics;
+        LOG_INFO("Proxy", "Cache directory: ./cache (limit " + std::to_string(cacheSize / (1024 * 1024)) + " MB)");
+
+        std::vector<std::thread> threads;
+        if (adminPort != 0) {
+            sockaddr_in adminAddr = addr;
+            adminAddr.sin_port = htons(adminPort);
+            // Как и для основного порта, ошибка bind должна всплыть до старта потоков
+            auto admin = std::make_shared<AdminServer>(adminAddr, metrics);
+            LOG_INFO("Proxy", "Metrics available at http://localhost:" + std::to_string(adminPort) + "/metrics");
+            threads.emplace_back([admin] { admin->Run(); });
+        }
+        for (unsigned i = 0; i < workers; ++i) {
+            threads.emplace_back([addr, &cache, &resolver, &metrics = metrics.AddWorker(), backend] {
+                try {
+                    RunWorker(addr, cache, resolver, metrics, backend);
+                } catch (const std::exception& e) {
+                    std::cerr << "Fatal error: " << e.what() << std::endl;
+                    std::exit(1);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
         }
     } catch (const std::exception& e) {
         std::cerr << "Fatal error: " << e.what() << std::endl;
@@ -107,4 +133,4 @@ int main(int argc, char* argv[]) {
     }
 
     return 0;
-}
\ No newline at end of file
+}
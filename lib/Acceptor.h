@@ -8,8 +8,23 @@
 class Acceptor
 {
 public:
-	Acceptor(const sockaddr_in& addr, const int queueSize)
+	Acceptor(const sockaddr_in& addr, const int queueSize, const bool reusePort = false)
 	{
+		// После перезапуска порт можно занять сразу, не дожидаясь окончания TIME_WAIT старых соединений
+		const int reuseAddr = 1;
+		if (setsockopt(m_fd.Get(), SOL_SOCKET, SO_REUSEADDR, &reuseAddr, sizeof(reuseAddr)) != 0)
+		{
+			throw std::system_error(errno, std::generic_category());
+		}
+		if (reusePort)
+		{
+			// Несколько слушающих сокетов на одном порту, ядро балансирует подключения между ними
+			const int enable = 1;
+			if (setsockopt(m_fd.Get(), SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) != 0)
+			{
+				throw std::system_error(errno, std::generic_category());
+			}
+		}
 		if (bind(m_fd.Get(), reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0)
 		{
 			throw std::system_error(errno, std::generic_category());
@@ -30,6 +45,31 @@ public:
 		return Socket{ std::move(clientFd) };
 	}
 
+	// Неблокирующий accept: std::nullopt, когда очередь подключений пуста
+	[[nodiscard]] std::optional<Socket> TryAccept() const
+	{
+		const int clientFd = accept4(m_fd.Get(), nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (clientFd == -1)
+		{
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR || errno == ECONNABORTED)
+			{
+				return std::nullopt;
+			}
+			throw std::system_error(errno, std::generic_category());
+		}
+		return Socket{ FileDesc{ clientFd } };
+	}
+
+	void SetNonBlocking()
+	{
+		m_fd.SetNonBlocking();
+	}
+
+	[[nodiscard]] int Get() const noexcept
+	{
+		return m_fd.Get();
+	}
+
 private:
 	FileDesc m_fd{ socket(AF_INET, SOCK_STREAM, /*protocol*/ 0) };
 };
\ No newline at end of file
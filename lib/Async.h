@@ -0,0 +1,291 @@
+#pragma once
+#include "EventLoop.h"
+#include "Logger.h"
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+// Сопрограммы C++20 поверх EventLoop: последовательный код вместо цепочек обработчиков,
+// при этом один поток ведёт сколько угодно потоков данных. Только для целей на C++20
+template <typename T>
+class Async;
+
+// Общее у обещаний всех Async: кого продолжить по завершении и пойманное исключение
+struct AsyncPromiseBase
+{
+    struct FinalAwaiter
+    {
+        bool await_ready() noexcept
+        {
+            return false;
+        }
+
+        // Симметричная передача управления: продолжение запускается без роста стека
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+        {
+            return handle.promise().continuation;
+        }
+
+        void await_resume() noexcept
+        {
+        }
+    };
+
+    std::suspend_always initial_suspend() noexcept
+    {
+        return {};
+    }
+
+    FinalAwaiter final_suspend() noexcept
+    {
+        return {};
+    }
+
+    void unhandled_exception() noexcept
+    {
+        exception = std::current_exception();
+    }
+
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+    std::exception_ptr exception;
+};
+
+template <typename T>
+struct AsyncPromiseResult
+{
+    template <typename U>
+    void return_value(U&& value)
+    {
+        result.emplace(std::forward<U>(value));
+    }
+
+    T Take()
+    {
+        return std::move(*result);
+    }
+
+    std::optional<T> result;
+};
+
+template <>
+struct AsyncPromiseResult<void>
+{
+    void return_void() noexcept
+    {
+    }
+
+    void Take()
+    {
+    }
+};
+
+// Ленивая сопрограмма: начинает выполняться, когда её ждут через co_await, и возвращает T или исключение.
+// Владеет своим кадром, как unique_ptr.
+// Результат co_await здесь и у ожиданий AsyncFd сначала сохраняют в переменную и только потом проверяют:
+// GCC 12 неверно собирает co_await прямо в условии if, особенно с throw внутри ветки
+template <typename T = void>
+class [[nodiscard]] Async
+{
+public:
+    struct promise_type : AsyncPromiseBase, AsyncPromiseResult<T>
+    {
+        Async get_return_object() noexcept
+        {
+            return Async(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+    };
+
+    Async(Async&& other) noexcept
+        : m_handle(std::exchange(other.m_handle, nullptr))
+    {
+    }
+
+    Async& operator=(Async&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Reset();
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+        return *this;
+    }
+
+    Async(const Async&) = delete;
+    Async& operator=(const Async&) = delete;
+
+    ~Async()
+    {
+        Reset();
+    }
+
+    auto operator co_await() && noexcept
+    {
+        struct Awaiter
+        {
+            std::coroutine_handle<promise_type> handle;
+
+            bool await_ready() noexcept
+            {
+                return handle.done();
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept
+            {
+                handle.promise().continuation = continuation;
+                return handle;
+            }
+
+            T await_resume()
+            {
+                if (handle.promise().exception)
+                {
+                    std::rethrow_exception(handle.promise().exception);
+                }
+                return handle.promise().Take();
+            }
+        };
+        return Awaiter{ m_handle };
+    }
+
+private:
+    explicit Async(std::coroutine_handle<promise_type> handle) noexcept
+        : m_handle(handle)
+    {
+    }
+
+    void Reset() noexcept
+    {
+        if (m_handle)
+        {
+            m_handle.destroy();
+        }
+        m_handle = nullptr;
+    }
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+// Сопрограмма, которую никто не ждёт: стартует сразу и сама освобождает кадр по завершении
+struct DetachedAsync
+{
+    struct promise_type
+    {
+        DetachedAsync get_return_object() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void return_void() noexcept
+        {
+        }
+
+        void unhandled_exception() noexcept
+        {
+            std::terminate();
+        }
+    };
+};
+
+inline DetachedAsync RunDetached(Async<void> task)
+{
+    try
+    {
+        co_await std::move(task);
+    }
+    catch (const std::exception& e)
+    {
+        LOG_ERROR("Async", "Unhandled exception in coroutine: " + std::string(e.what()));
+    }
+}
+
+// Запускает сопрограмму в фоне: она выполняется до первого ожидания, дальше её продолжает цикл событий.
+// Исключение, вылетевшее из неё, только пишется в журнал
+inline void Spawn(Async<void> task)
+{
+    RunDetached(std::move(task));
+}
+
+// co_await Sleep(loop, 100ms) — продолжить сопрограмму в потоке цикла через delay
+inline auto Sleep(EventLoop& loop, const std::chrono::milliseconds delay)
+{
+    struct Awaiter
+    {
+        EventLoop& loop;
+        std::chrono::milliseconds delay;
+
+        bool await_ready() const noexcept
+        {
+            return delay.count() <= 0;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            loop.RunAfter(delay, [handle] { handle.resume(); });
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+    };
+    return Awaiter{ loop, delay };
+}
+
+template <typename T>
+using AsyncStored = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+template <typename T>
+Async<void> CompleteInto(Async<T> task, std::optional<AsyncStored<T>>& result, std::exception_ptr& error)
+{
+    try
+    {
+        if constexpr (std::is_void_v<T>)
+        {
+            co_await std::move(task);
+            result.emplace();
+        }
+        else
+        {
+            result.emplace(co_await std::move(task));
+        }
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+}
+
+// Для программ без своего цикла: крутит loop, пока сопрограмма не завершится, и возвращает её результат
+template <typename T>
+T RunSync(EventLoop& loop, Async<T> task)
+{
+    std::optional<AsyncStored<T>> result;
+    std::exception_ptr error;
+    Spawn(CompleteInto(std::move(task), result, error));
+    while (!result && !error)
+    {
+        loop.RunOnce();
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+    if constexpr (!std::is_void_v<T>)
+    {
+        return std::move(*result);
+    }
+}
@@ -0,0 +1,365 @@
+#pragma once
+#include "Acceptor.h"
+#include "Async.h"
+#include "HostResolver.h"
+#include "Socket.h"
+#include "UdpSocket.h"
+#include <chrono>
+#include <coroutine>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+using AsyncTimeout = std::optional<std::chrono::milliseconds>;
+
+// Неблокирующий дескриптор в цикле событий: сопрограмма ждёт его готовности через co_await.
+// Одновременно может ждать один читатель и один писатель. Объект не перемещается: цикл хранит указатель на него
+class AsyncFd
+{
+public:
+    AsyncFd(EventLoop& loop, const int fd)
+        : m_loop(loop)
+        , m_fd(fd)
+    {
+        m_loop.Add(m_fd, 0, [this](uint32_t events) { OnEvent(events); });
+    }
+
+    AsyncFd(const AsyncFd&) = delete;
+    AsyncFd& operator=(const AsyncFd&) = delete;
+
+    ~AsyncFd()
+    {
+        *m_alive = false;
+        m_loop.CancelTimer(m_reader.timer);
+        m_loop.CancelTimer(m_writer.timer);
+        m_loop.Remove(m_fd);
+    }
+
+    // co_await Readable(): true — можно читать (или на сокете ошибка), false — истёк timeout
+    auto Readable(const AsyncTimeout timeout = std::nullopt)
+    {
+        return Awaiter{ *this, m_reader, timeout };
+    }
+
+    auto Writable(const AsyncTimeout timeout = std::nullopt)
+    {
+        return Awaiter{ *this, m_writer, timeout };
+    }
+
+    [[nodiscard]] EventLoop& Loop() const noexcept
+    {
+        return m_loop;
+    }
+
+private:
+    struct Waiter
+    {
+        std::coroutine_handle<> handle;
+        EventLoop::TimerId timer = 0;
+        bool ready = false;
+    };
+
+    struct Awaiter
+    {
+        AsyncFd& owner;
+        Waiter& waiter;
+        AsyncTimeout timeout;
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            if (waiter.handle)
+            {
+                throw std::logic_error("Descriptor is already awaited");
+            }
+            waiter.handle = handle;
+            if (timeout)
+            {
+                AsyncFd* self = &owner;
+                Waiter* target = &waiter;
+                waiter.timer = owner.m_loop.RunAfter(*timeout, [self, target] { self->Wake(*target, false); });
+            }
+            owner.UpdateEvents();
+        }
+
+        bool await_resume() const noexcept
+        {
+            return waiter.ready;
+        }
+    };
+
+    void OnEvent(const uint32_t events)
+    {
+        // Продолженная сопрограмма может тут же уничтожить этот объект
+        const auto alive = m_alive;
+        if (m_reader.handle && (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)))
+        {
+            Wake(m_reader, true);
+        }
+        if (*alive && m_writer.handle && (events & (EPOLLOUT | EPOLLHUP | EPOLLERR)))
+        {
+            Wake(m_writer, true);
+        }
+    }
+
+    void Wake(Waiter& waiter, const bool ready)
+    {
+        const std::coroutine_handle<> handle = std::exchange(waiter.handle, nullptr);
+        m_loop.CancelTimer(std::exchange(waiter.timer, 0));
+        waiter.ready = ready;
+        UpdateEvents();
+        handle.resume();
+    }
+
+    void UpdateEvents()
+    {
+        const uint32_t events = (m_reader.handle ? uint32_t{ EPOLLIN | EPOLLRDHUP } : 0) | (m_writer.handle ? uint32_t{ EPOLLOUT } : 0);
+        if (events != m_events)
+        {
+            m_loop.Modify(m_fd, events);
+            m_events = events;
+        }
+    }
+
+    EventLoop& m_loop;
+    int m_fd;
+    uint32_t m_events = 0;
+    Waiter m_reader;
+    Waiter m_writer;
+    std::shared_ptr<bool> m_alive = std::make_shared<bool>(true);
+};
+
+// Ожидание адресов от HostResolver: результат приходит из потока резолвера и переносится в цикл через Post
+inline auto ResolveAsync(EventLoop& loop, const std::string& host, HostResolver& resolver = HostResolver::Default())
+{
+    struct Awaiter
+    {
+        EventLoop& loop;
+        HostResolver& resolver;
+        std::string host;
+        HostResolver::Result result;
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            resolver.ResolveAsync(host, [this, handle](HostResolver::Result value) {
+                loop.Post([this, handle, value = std::move(value)]() mutable {
+                    result = std::move(value);
+                    handle.resume();
+                });
+            });
+        }
+
+        std::vector<in_addr> await_resume() const
+        {
+            if (!result->Ok())
+            {
+                throw std::runtime_error(result->error);
+            }
+            return result->addresses;
+        }
+    };
+    return Awaiter{ loop, resolver, host, nullptr };
+}
+
+// Потоковый сокет для сопрограмм: Read, Write и ReadLine не блокируют поток, а ждут готовности в цикле событий.
+// Таймаут (SetTimeout) ограничивает каждое ожидание; по его истечении операция бросает исключение
+class AsyncSocket
+{
+public:
+    AsyncSocket(EventLoop& loop, Socket socket)
+        : m_socket(std::move(socket))
+    {
+        m_socket.SetNonBlocking();
+        m_fd = std::make_unique<AsyncFd>(loop, m_socket.Get());
+    }
+
+    // Подключение без блокировки: имя разрешается в потоках HostResolver, connect завершается по EPOLLOUT
+    static Async<AsyncSocket> Connect(EventLoop& loop, const std::string& host, const uint16_t port,
+                                      const AsyncTimeout timeout = std::nullopt)
+    {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr = (co_await ResolveAsync(loop, host)).front();
+        co_return co_await Connect(loop, addr, timeout);
+    }
+
+    static Async<AsyncSocket> Connect(EventLoop& loop, const sockaddr_in addr, const AsyncTimeout timeout = std::nullopt)
+    {
+        FileDesc fd(socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, /*protocol*/ 0));
+        if (!fd.IsOpen())
+        {
+            throw std::system_error(errno, std::generic_category());
+        }
+        AsyncSocket result(loop, Socket{ std::move(fd) });
+        if (connect(result.m_socket.Get(), reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0)
+        {
+            if (errno != EINPROGRESS)
+            {
+                throw std::system_error(errno, std::generic_category());
+            }
+            const bool connected = co_await result.m_fd->Writable(timeout);
+            if (!connected)
+            {
+                throw std::runtime_error("Connection timed out");
+            }
+            if (const int error = result.m_socket.GetError(); error != 0)
+            {
+                throw std::system_error(error, std::generic_category());
+            }
+        }
+        result.m_timeout = timeout;
+        co_return result;
+    }
+
+    // Сколько прочитано; 0 — собеседник закрыл соединение
+    Async<size_t> Read(void* buffer, const size_t length)
+    {
+        while (true)
+        {
+            if (const auto bytesRead = m_socket.TryRead(buffer, length))
+            {
+                co_return *bytesRead;
+            }
+            const bool readable = co_await m_fd->Readable(m_timeout);
+            if (!readable)
+            {
+                throw std::runtime_error("Receive timed out");
+            }
+        }
+    }
+
+    // Отправляет всё: короткие записи дописываются после ожидания готовности
+    Async<void> Write(std::string_view data)
+    {
+        while (!data.empty())
+        {
+            if (const auto sent = m_socket.TrySend(data.data(), data.size()))
+            {
+                data.remove_prefix(*sent);
+                continue;
+            }
+            const bool writable = co_await m_fd->Writable(m_timeout);
+            if (!writable)
+            {
+                throw std::runtime_error("Send timed out");
+            }
+        }
+    }
+
+    // Строка вместе с '\n'. Обрыв соединения до конца строки — ошибка
+    Async<std::string> ReadLine()
+    {
+        size_t pos;
+        while ((pos = m_readBuffer.find('\n')) == std::string::npos)
+        {
+            char buffer[4096];
+            const size_t bytesRead = co_await Read(buffer, sizeof(buffer));
+            if (bytesRead == 0)
+            {
+                throw std::runtime_error("Connection closed by server unexpectedly");
+            }
+            m_readBuffer.append(buffer, bytesRead);
+        }
+        std::string line = m_readBuffer.substr(0, pos + 1);
+        m_readBuffer.erase(0, pos + 1);
+        co_return line;
+    }
+
+    void SetTimeout(const AsyncTimeout timeout)
+    {
+        m_timeout = timeout;
+    }
+
+    [[nodiscard]] int Get() const noexcept
+    {
+        return m_socket.Get();
+    }
+
+private:
+    Socket m_socket;
+    std::unique_ptr<AsyncFd> m_fd;
+    AsyncTimeout m_timeout;
+    std::string m_readBuffer;
+};
+
+// Слушающий сокет для сопрограмм: co_await Accept() возвращает следующее подключение
+class AsyncAcceptor
+{
+public:
+    AsyncAcceptor(EventLoop& loop, const sockaddr_in& addr, const int queueSize, const bool reusePort = false)
+        : m_acceptor(addr, queueSize, reusePort)
+    {
+        m_acceptor.SetNonBlocking();
+        m_fd = std::make_unique<AsyncFd>(loop, m_acceptor.Get());
+    }
+
+    Async<AsyncSocket> Accept()
+    {
+        while (true)
+        {
+            if (auto client = m_acceptor.TryAccept())
+            {
+                co_return AsyncSocket(m_fd->Loop(), std::move(*client));
+            }
+            co_await m_fd->Readable();
+        }
+    }
+
+private:
+    Acceptor m_acceptor;
+    std::unique_ptr<AsyncFd> m_fd;
+};
+
+// UDP для сопрограмм: отправка не ждёт (датаграмма либо уходит, либо теряется), приём ждёт с таймаутом
+class AsyncUdpSocket
+{
+public:
+    explicit AsyncUdpSocket(EventLoop& loop)
+    {
+        m_socket.SetNonBlocking();
+        m_fd = std::make_unique<AsyncFd>(loop, m_socket.Get());
+    }
+
+    void Bind(const int port)
+    {
+        m_socket.Bind(port);
+    }
+
+    void SendTo(const std::string& message, const sockaddr_in& destAddr)
+    {
+        m_socket.SendTo(message, destAddr);
+    }
+
+    // std::nullopt — за timeout ничего не пришло
+    Async<std::optional<std::string>> RecvFrom(sockaddr_in& srcAddr, const AsyncTimeout timeout = std::nullopt)
+    {
+        while (true)
+        {
+            if (auto message = m_socket.TryRecvFrom(srcAddr))
+            {
+                co_return message;
+            }
+            const bool readable = co_await m_fd->Readable(timeout);
+            if (!readable)
+            {
+                co_return std::nullopt;
+            }
+        }
+    }
+
+private:
+    UdpSocket m_socket;
+    std::unique_ptr<AsyncFd> m_fd;
+};
@@ -0,0 +1,228 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+class BufferPool;
+
+// Кусок буфера из BufferPool со счётчиком ссылок: копия и Sub делят один блок без копирования данных,
+// блок возвращается в пул, когда отпущена последняя ссылка.
+// Счётчик не атомарный — срез живёт в потоке своего пула и не переживает сам пул
+class BufferSlice
+{
+public:
+    BufferSlice() = default;
+
+    BufferSlice(const BufferSlice& other) noexcept
+        : m_block(other.m_block)
+        , m_offset(other.m_offset)
+        , m_size(other.m_size)
+    {
+        AddRef();
+    }
+
+    BufferSlice(BufferSlice&& other) noexcept
+        : m_block(std::exchange(other.m_block, nullptr))
+        , m_offset(std::exchange(other.m_offset, 0))
+        , m_size(std::exchange(other.m_size, 0))
+    {
+    }
+
+    BufferSlice& operator=(BufferSlice other) noexcept
+    {
+        std::swap(m_block, other.m_block);
+        std::swap(m_offset, other.m_offset);
+        std::swap(m_size, other.m_size);
+        return *this;
+    }
+
+    ~BufferSlice()
+    {
+        Release();
+    }
+
+    [[nodiscard]] uint8_t* Data() noexcept;
+    [[nodiscard]] const uint8_t* Data() const noexcept;
+
+    [[nodiscard]] size_t Size() const noexcept
+    {
+        return m_size;
+    }
+
+    [[nodiscard]] bool Empty() const noexcept
+    {
+        return m_size == 0;
+    }
+
+    // Сколько байт можно занять от начала среза до конца блока
+    [[nodiscard]] size_t Capacity() const noexcept;
+
+    // Например, после recv: срез на весь блок укорачивается до принятых байт
+    void Resize(const size_t size)
+    {
+        if (size > Capacity())
+        {
+            throw std::length_error("BufferSlice size exceeds block capacity");
+        }
+        m_size = size;
+    }
+
+    // Часть среза на том же блоке
+    [[nodiscard]] BufferSlice Sub(const size_t offset, const size_t size) const
+    {
+        if (offset > m_size || size > m_size - offset)
+        {
+            throw std::out_of_range("BufferSlice::Sub out of range");
+        }
+        BufferSlice result(*this);
+        result.m_offset += offset;
+        result.m_size = size;
+        return result;
+    }
+
+    [[nodiscard]] std::string_view View() const noexcept
+    {
+        return { reinterpret_cast<const char*>(Data()), m_size };
+    }
+
+private:
+    friend class BufferPool;
+
+    struct Block
+    {
+        BufferPool* pool;
+        Block* next;
+        uint32_t refs;
+    };
+
+    explicit BufferSlice(Block* block, const size_t size) noexcept
+        : m_block(block)
+        , m_size(size)
+    {
+    }
+
+    void AddRef() noexcept
+    {
+        if (m_block)
+        {
+            ++m_block->refs;
+        }
+    }
+
+    void Release() noexcept;
+
+    Block* m_block = nullptr;
+    size_t m_offset = 0;
+    size_t m_size = 0;
+};
+
+// Пул буферов одного размера для путей приёма: блоки нарезаются из крупных слэбов и после освобождения
+// снова идут в дело, так что на каждую датаграмму не нужен malloc. Память возвращается системе только вместе с пулом
+class BufferPool
+{
+public:
+    // Хватает на датаграмму размером с MTU Ethernet
+    static constexpr size_t DefaultBlockSize = 2048;
+
+    explicit BufferPool(const size_t blockSize = DefaultBlockSize, const size_t blocksPerSlab = 64)
+        : m_blockSize(blockSize)
+        , m_blocksPerSlab(blocksPerSlab)
+    {
+    }
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // Пул потока с блоками DefaultBlockSize. Срезы из него не передаются в другие потоки
+    static BufferPool& Local()
+    {
+        thread_local BufferPool pool;
+        return pool;
+    }
+
+    // Срез на весь блок; содержимое не обнуляется
+    BufferSlice Acquire()
+    {
+        if (!m_free)
+        {
+            Grow();
+        }
+        BufferSlice::Block* block = std::exchange(m_free, m_free->next);
+        block->refs = 1;
+        return BufferSlice(block, m_blockSize);
+    }
+
+    [[nodiscard]] size_t BlockSize() const noexcept
+    {
+        return m_blockSize;
+    }
+
+private:
+    friend class BufferSlice;
+
+    // Данные блока идут сразу за заголовком, выровненным как max_align_t
+    static constexpr size_t HeaderSize =
+        (sizeof(BufferSlice::Block) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+    static uint8_t* DataOf(BufferSlice::Block* block) noexcept
+    {
+        return reinterpret_cast<uint8_t*>(block) + HeaderSize;
+    }
+
+    void Grow()
+    {
+        const size_t stride = HeaderSize + (m_blockSize + alignof(std::max_align_t) - 1) / alignof(std::max_align_t)
+            * alignof(std::max_align_t);
+        auto& slab = m_slabs.emplace_back(std::make_unique<std::max_align_t[]>(
+            (stride * m_blocksPerSlab + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t)));
+        auto* memory = reinterpret_cast<uint8_t*>(slab.get());
+        for (size_t i = 0; i < m_blocksPerSlab; ++i)
+        {
+            auto* block = new (memory + i * stride) BufferSlice::Block{ this, m_free, 0 };
+            m_free = block;
+        }
+    }
+
+    void Recycle(BufferSlice::Block* block) noexcept
+    {
+        block->next = m_free;
+        m_free = block;
+    }
+
+    size_t m_blockSize;
+    size_t m_blocksPerSlab;
+    std::vector<std::unique_ptr<std::max_align_t[]>> m_slabs;
+    BufferSlice::Block* m_free = nullptr;
+};
+
+inline uint8_t* BufferSlice::Data() noexcept
+{
+    return m_block ? BufferPool::DataOf(m_block) + m_offset : nullptr;
+}
+
+inline const uint8_t* BufferSlice::Data() const noexcept
+{
+    return m_block ? BufferPool::DataOf(m_block) + m_offset : nullptr;
+}
+
+inline size_t BufferSlice::Capacity() const noexcept
+{
+    return m_block ? m_block->pool->BlockSize() - m_offset : 0;
+}
+
+inline void BufferSlice::Release() noexcept
+{
+    if (m_block && --m_block->refs == 0)
+    {
+        m_block->pool->Recycle(m_block);
+    }
+    m_block = nullptr;
+    m_offset = 0;
+    m_size = 0;
+}
@@ -1,54 +1,37 @@
 #pragma once
+#include "./BufferPool.h"
 #include "./FileDesc.h"
+#include "./HostResolver.h"
+#include "./Logger.h"
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <netdb.h>
-#include <iostream>
 #include <string>
 
 class Connection
 {
 public:
-    Connection(uint16_t port, std::string const& serverAddrStr)
+    Connection(uint16_t port, std::string const& serverAddrStr, HostResolver& resolver = HostResolver::Default())
     {
         sockaddr_in addr{};
         addr.sin_family = AF_INET;
         addr.sin_port = htons(port);
 
-        if (inet_pton(AF_INET, serverAddrStr.c_str(), &addr.sin_addr) <= 0)
+        try
         {
-            addrinfo hints{};
-            hints.ai_family = AF_INET;
-            hints.ai_socktype = SOCK_STREAM;
-
-            addrinfo* result;
-
-            std::string portStr = std::to_string(port);
-
-            const int status = getaddrinfo(serverAddrStr.c_str(), portStr.c_str(), &hints, &result);
-            if (status != 0)
-            {
-                throw std::runtime_error("Invalid address or address not supported: " + std::string(gai_strerror(status)));
-            }
-
-            if (result->ai_addrlen >= sizeof(addr))
-            {
-                addr = *reinterpret_cast<sockaddr_in*>(result->ai_addr);
-            }
-            else
-            {
-                freeaddrinfo(result);
-                throw std::runtime_error("Invalid address structure");
-            }
-
-            freeaddrinfo(result);
+            // Повторные подключения к тому же имени обходятся без запроса к DNS
+            addr.sin_addr = resolver.Resolve(serverAddrStr).front();
+        }
+        catch (const std::exception& e)
+        {
+            throw std::runtime_error("Invalid address or address not supported: " + std::string(e.what()));
         }
 
         if (connect(m_fd.Get(), reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
         {
             throw std::runtime_error("Connection failed");
         }
-        std::cout << "Connection created to " << serverAddrStr << ":" << port << std::endl;
+        LOG_DEBUG("Connection", "Connection created to " + serverAddrStr + ":" + std::to_string(port));
     }
 
     void Send(std::string const& message)
@@ -65,15 +48,16 @@ public:
         }
     }
 
-    std::string Receive()
+    // Принятое лежит в блоке пула потока; пустой срез — собеседник закрыл соединение
+    BufferSlice Receive()
     {
-        char buffer[1024];
-        const ssize_t bytesRead = recv(m_fd.Get(), buffer, sizeof(buffer) - 1, 0);
+        BufferSlice buffer = BufferPool::Local().Acquire();
+        const ssize_t bytesRead = recv(m_fd.Get(), buffer.Data(), buffer.Size(), 0);
         if (bytesRead == -1)
         {
             throw std::runtime_error("Failed to receive message");
         }
-        buffer[bytesRead] = '\0';
+        buffer.Resize(static_cast<size_t>(bytesRead));
 
         return buffer;
     }
@@ -106,7 +90,7 @@ public:
 
     ~Connection()
     {
-        std::cout << "Connection closed" << std::endl;
+        LOG_DEBUG("Connection", "Connection closed");
     }
 
 private:
@@ -0,0 +1,735 @@
+#pragma once
+#include "FileDesc.h"
+#include "IoUring.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Чем цикл событий ждёт готовности дескрипторов
+enum class IoBackend
+{
+    Epoll,
+    // io_uring, если ядро его поддерживает, иначе epoll
+    Uring,
+};
+
+// Реактор на epoll или io_uring: один экземпляр на поток, дескрипторы регистрируются вместе с обработчиком событий.
+// С io_uring готовность ждётся одноразовыми IORING_OP_POLL_ADD, которые взводятся заново после каждого события
+// (как level-triggered epoll), а все перевзводы уходят в ядро одним io_uring_enter вместе с ожиданием.
+// Приём подключений и данных можно отдать циклу целиком (AddAcceptor, AddReceiver): тогда с io_uring работают
+// multishot accept и multishot recv с буферами из общего кольца, без системного вызова на каждое подключение и чтение
+// https://man7.org/linux/man-pages/man7/epoll.7.html
+// https://man7.org/linux/man-pages/man7/io_uring.7.html
+class EventLoop
+{
+public:
+    using Handler = std::function<void(uint32_t events)>;
+    using Task = std::function<void()>;
+    using AcceptHandler = std::function<void(FileDesc client)>;
+    // size > 0 — принятые данные (действительны только внутри вызова), 0 — собеседник закрыл соединение, < 0 — -errno
+    using Receiver = std::function<void(const char* data, ssize_t size)>;
+    using TimerId = uint64_t;
+
+    explicit EventLoop(const IoBackend backend = IoBackend::Epoll)
+            : m_wakeup(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+            , m_timerFd(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC))
+    {
+        if (backend == IoBackend::Uring)
+        {
+            m_ring = IoUring::TryCreate(RingEntries);
+            if (m_ring)
+            {
+                // Без кольца буферов (ядро до 5.19) данные читаются по готовности, как с epoll
+                m_buffers = ProvidedBuffers::TryCreate(*m_ring, ReceiveBufferGroup, ReceiveBuffers, ReceiveBufferSize);
+            }
+        }
+        if (!m_ring)
+        {
+            m_epoll = FileDesc(epoll_create1(EPOLL_CLOEXEC));
+        }
+        if ((!m_ring && !m_epoll.IsOpen()) || !m_wakeup.IsOpen() || !m_timerFd.IsOpen())
+        {
+            throw std::system_error(errno, std::generic_category());
+        }
+        Add(m_wakeup.Get(), EPOLLIN, [this](uint32_t) { RunPosted(); });
+        Add(m_timerFd.Get(), EPOLLIN, [this](uint32_t) { RunExpired(); });
+    }
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    ~EventLoop()
+    {
+        if (m_ring)
+        {
+            ShutdownRing();
+        }
+    }
+
+    // false — запрошен io_uring, но ядро его не поддерживает, работает epoll
+    [[nodiscard]] bool UsesIoUring() const noexcept
+    {
+        return m_ring != nullptr;
+    }
+
+    void Add(const int fd, const uint32_t events, Handler handler)
+    {
+        const uint32_t generation = ++m_generation;
+        if (!m_ring)
+        {
+            epoll_event ev{};
+            ev.events = events;
+            ev.data.u64 = (static_cast<uint64_t>(generation) << 32) | static_cast<uint32_t>(fd);
+            if (epoll_ctl(m_epoll.Get(), EPOLL_CTL_ADD, fd, &ev) != 0)
+            {
+                throw std::system_error(errno, std::generic_category());
+            }
+        }
+        Registration& reg = m_handlers[fd] = Registration{};
+        reg.generation = generation;
+        reg.handler = std::make_shared<Handler>(std::move(handler));
+        reg.events = events;
+        reg.applied = m_ring ? 0 : events;
+        Apply(fd, reg);
+    }
+
+    void Modify(const int fd, const uint32_t events)
+    {
+        const auto it = m_handlers.find(fd);
+        if (it == m_handlers.end())
+        {
+            return;
+        }
+        it->second.events = events;
+        Apply(fd, it->second);
+    }
+
+    // Дескриптор нужно снять с регистрации до его закрытия
+    void Remove(const int fd)
+    {
+        const auto it = m_handlers.find(fd);
+        if (it == m_handlers.end())
+        {
+            return;
+        }
+        if (!m_ring)
+        {
+            epoll_ctl(m_epoll.Get(), EPOLL_CTL_DEL, fd, nullptr);
+        }
+        else
+        {
+            // Ядро держит ссылку на файл, пока операция не отменена: отмена уходит с ближайшей пачкой заявок
+            const Registration& reg = it->second;
+            if (reg.pollArmed)
+            {
+                Cancel(IORING_OP_POLL_REMOVE, UserData(fd, Kind::Poll, reg.generation));
+            }
+            if (reg.recvArmed)
+            {
+                Cancel(IORING_OP_ASYNC_CANCEL, UserData(fd, Kind::Recv, reg.generation));
+            }
+            if (reg.acceptArmed)
+            {
+                Cancel(IORING_OP_ASYNC_CANCEL, UserData(fd, Kind::Accept, reg.generation));
+            }
+        }
+        m_handlers.erase(it);
+    }
+
+    // Слушающий сокет: каждое новое подключение (неблокирующее) передаётся обработчику.
+    // С io_uring — один multishot accept на всё время жизни сокета, с epoll — accept4 по готовности
+    void AddAcceptor(const int listenFd, AcceptHandler handler)
+    {
+        auto shared = std::make_shared<AcceptHandler>(std::move(handler));
+        if (!m_ring || !m_acceptMultishot)
+        {
+            Add(listenFd, EPOLLIN, [this, listenFd, shared](uint32_t) { AcceptReady(listenFd, *shared); });
+            return;
+        }
+        Add(listenFd, 0, nullptr);
+        Registration& reg = m_handlers[listenFd];
+        reg.acceptor = std::move(shared);
+        ArmAccept(listenFd, reg);
+    }
+
+    // Данные с сокета, уже добавленного через Add, приходят получателю; EPOLLIN и EPOLLRDHUP обработчику больше не нужны.
+    // После конца потока или ошибки приём нужно остановить (SetReceiving) или снять сокет с регистрации
+    void AddReceiver(const int fd, Receiver receiver)
+    {
+        const auto it = m_handlers.find(fd);
+        if (it == m_handlers.end())
+        {
+            return;
+        }
+        it->second.receiver = std::make_shared<Receiver>(std::move(receiver));
+        it->second.receiving = true;
+        Apply(fd, it->second);
+    }
+
+    // Пауза приёма, пока получателю некуда девать данные. С io_uring данные, уже принятые ядром до отмены,
+    // ещё могут прийти после паузы
+    void SetReceiving(const int fd, const bool receiving)
+    {
+        const auto it = m_handlers.find(fd);
+        if (it == m_handlers.end() || it->second.receiving == receiving)
+        {
+            return;
+        }
+        it->second.receiving = receiving;
+        Apply(fd, it->second);
+    }
+
+    // Потокобезопасно: задача выполнится в потоке цикла
+    void Post(Task task)
+    {
+        {
+            std::lock_guard lock(m_postedMutex);
+            m_posted.push_back(std::move(task));
+        }
+        const uint64_t one = 1;
+        [[maybe_unused]] auto _ = write(m_wakeup.Get(), &one, sizeof(one));
+    }
+
+    // Задача выполнится в потоке цикла не раньше, чем через delay. Только из потока цикла
+    TimerId RunAfter(const std::chrono::milliseconds delay, Task task)
+    {
+        const TimerId id = ++m_lastTimerId;
+        const Clock::time_point deadline = Clock::now() + delay;
+        const auto it = m_timers.emplace(std::make_pair(deadline, id), std::move(task)).first;
+        m_timerDeadlines.emplace(id, deadline);
+        if (it == m_timers.begin())
+        {
+            ArmTimerFd();
+        }
+        return id;
+    }
+
+    // Отмена ещё не сработавшего таймера; для сработавшего или отменённого ничего не делает
+    void CancelTimer(const TimerId id)
+    {
+        const auto it = m_timerDeadlines.find(id);
+        if (it == m_timerDeadlines.end())
+        {
+            return;
+        }
+        m_timers.erase(std::make_pair(it->second, id));
+        m_timerDeadlines.erase(it);
+    }
+
+    void Run()
+    {
+        while (!m_stopped.load(std::memory_order_relaxed))
+        {
+            RunOnce();
+        }
+    }
+
+    // Одно ожидание и обработка всех событий, которые оно вернуло
+    void RunOnce()
+    {
+        if (m_ring)
+        {
+            m_ring->Submit(/*wait*/ true);
+            m_ring->ForEachCqe([this](const io_uring_cqe& cqe) { Complete(cqe); });
+            return;
+        }
+
+        const int count = epoll_wait(m_epoll.Get(), m_events.data(), static_cast<int>(m_events.size()), -1);
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                return;
+            }
+            throw std::system_error(errno, std::generic_category());
+        }
+        for (int i = 0; i < count; ++i)
+        {
+            const int fd = static_cast<int>(m_events[i].data.u64 & 0xFFFFFFFF);
+            Dispatch(fd, static_cast<uint32_t>(m_events[i].data.u64 >> 32), m_events[i].events);
+        }
+    }
+
+    void Stop()
+    {
+        m_stopped = true;
+        Post([] {});
+    }
+
+private:
+    // Вид операции io_uring в user_data: дескриптор в младших 32 битах, вид — в двух следующих, поколение — в старших
+    enum class Kind : uint64_t
+    {
+        Poll,
+        Recv,
+        Accept,
+        Cancel,
+    };
+
+    // У каждого вида операций на дескрипторе не больше одной заявки в ядре: новая взводится
+    // только после последнего завершения старой, поэтому завершение однозначно относится к регистрации
+    struct Registration
+    {
+        uint32_t generation = 0;
+        std::shared_ptr<Handler> handler;
+        uint32_t events = 0;
+        // Маска, с которой дескриптор сейчас ждёт в epoll или в заявке POLL_ADD
+        uint32_t applied = 0;
+        std::shared_ptr<AcceptHandler> acceptor;
+        std::shared_ptr<Receiver> receiver;
+        bool receiving = false;
+        bool pollArmed = false;
+        bool pollCancelled = false;
+        bool recvArmed = false;
+        bool recvCancelled = false;
+        bool acceptArmed = false;
+    };
+
+    static uint64_t UserData(const int fd, const Kind kind, const uint32_t generation)
+    {
+        return (static_cast<uint64_t>(generation & GenerationMask) << 34) | (static_cast<uint64_t>(kind) << 32)
+            | static_cast<uint32_t>(fd);
+    }
+
+    Registration* Find(const int fd, const uint32_t generation)
+    {
+        const auto it = m_handlers.find(fd);
+        // Дескриптор мог быть снят или переиспользован обработчиком из этой же пачки событий
+        if (it == m_handlers.end() || (it->second.generation & GenerationMask) != (generation & GenerationMask))
+        {
+            return nullptr;
+        }
+        return &it->second;
+    }
+
+    // Данные принимает кольцо io_uring, а не чтение по готовности
+    [[nodiscard]] bool RingReceives() const noexcept
+    {
+        return m_buffers && m_recvMultishot;
+    }
+
+    // Приводит ожидание в ядре к текущим events и состоянию приёма
+    void Apply(const int fd, Registration& reg)
+    {
+        const bool pollReceives = reg.receiver && reg.receiving && !RingReceives();
+        const uint32_t mask = reg.events | (pollReceives ? EPOLLIN | EPOLLRDHUP : 0);
+        if (!m_ring)
+        {
+            if (mask != reg.applied)
+            {
+                epoll_event ev{};
+                ev.events = mask;
+                ev.data.u64 = (static_cast<uint64_t>(reg.generation) << 32) | static_cast<uint32_t>(fd);
+                if (epoll_ctl(m_epoll.Get(), EPOLL_CTL_MOD, fd, &ev) != 0)
+                {
+                    throw std::system_error(errno, std::generic_category());
+                }
+                reg.applied = mask;
+            }
+            return;
+        }
+
+        if (reg.receiver && RingReceives())
+        {
+            if (reg.receiving && !reg.recvArmed)
+            {
+                ArmRecv(fd, reg);
+            }
+            else if (!reg.receiving && reg.recvArmed && !reg.recvCancelled)
+            {
+                Cancel(IORING_OP_ASYNC_CANCEL, UserData(fd, Kind::Recv, reg.generation));
+                reg.recvCancelled = true;
+            }
+        }
+        // Заявку с другой маской сначала снимаем; новая взведётся, когда придёт завершение снятой
+        if (reg.pollArmed)
+        {
+            if (mask != reg.applied && !reg.pollCancelled)
+            {
+                Cancel(IORING_OP_POLL_REMOVE, UserData(fd, Kind::Poll, reg.generation));
+                reg.pollCancelled = true;
+            }
+            return;
+        }
+        if (mask != 0)
+        {
+            io_uring_sqe* sqe = m_ring->GetSqe();
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->fd = fd;
+            sqe->poll32_events = mask;
+            sqe->user_data = UserData(fd, Kind::Poll, reg.generation);
+            reg.pollArmed = true;
+            reg.pollCancelled = false;
+        }
+        reg.applied = mask;
+    }
+
+    void ArmRecv(const int fd, Registration& reg)
+    {
+        io_uring_sqe* sqe = m_ring->GetSqe();
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = fd;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = m_buffers->GroupId();
+        sqe->user_data = UserData(fd, Kind::Recv, reg.generation);
+        reg.recvArmed = true;
+        reg.recvCancelled = false;
+    }
+
+    void ArmAccept(const int fd, Registration& reg)
+    {
+        io_uring_sqe* sqe = m_ring->GetSqe();
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = fd;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+        sqe->user_data = UserData(fd, Kind::Accept, reg.generation);
+        reg.acceptArmed = true;
+    }
+
+    // Пока взведены multishot recv, ядро пишет в буферы кольца. Перед освобождением памяти все операции
+    // отменяются, а кольцо буферов снимается с регистрации. Отмена всего сразу — ядро 5.19+, как и кольцо буферов
+    void ShutdownRing() noexcept
+    {
+        try
+        {
+            io_uring_sqe* sqe = m_ring->GetSqe();
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY | IORING_ASYNC_CANCEL_ALL;
+            sqe->user_data = ShutdownUserData;
+            bool cancelled = false;
+            while (!cancelled)
+            {
+                m_ring->Submit(/*wait*/ true);
+                // Завершения отменённых операций обработчикам уже не отдаются
+                m_ring->ForEachCqe([&cancelled](const io_uring_cqe& cqe) {
+                    cancelled = cancelled || cqe.user_data == ShutdownUserData;
+                });
+            }
+            if (m_buffers)
+            {
+                m_buffers->Unregister(*m_ring);
+            }
+        }
+        catch (...)
+        {
+        }
+    }
+
+    void Cancel(const uint8_t opcode, const uint64_t target)
+    {
+        io_uring_sqe* sqe = m_ring->GetSqe();
+        sqe->opcode = opcode;
+        sqe->fd = -1;
+        sqe->addr = target;
+        sqe->user_data = UserData(0, Kind::Cancel, 0);
+    }
+
+    void Complete(const io_uring_cqe& cqe)
+    {
+        const int fd = static_cast<int>(cqe.user_data & 0xFFFFFFFF);
+        const auto kind = static_cast<Kind>((cqe.user_data >> 32) & 3);
+        const auto generation = static_cast<uint32_t>(cqe.user_data >> 34);
+        switch (kind)
+        {
+        case Kind::Poll:
+            CompletePoll(fd, generation, cqe.res);
+            break;
+        case Kind::Recv:
+            CompleteRecv(fd, generation, cqe);
+            break;
+        case Kind::Accept:
+            CompleteAccept(fd, generation, cqe);
+            break;
+        case Kind::Cancel:
+            break;
+        }
+    }
+
+    void CompletePoll(const int fd, const uint32_t generation, const int result)
+    {
+        Registration* reg = Find(fd, generation);
+        if (!reg)
+        {
+            return;
+        }
+        reg->pollArmed = false;
+        if (result != -ECANCELED)
+        {
+            Dispatch(fd, reg->generation, result < 0 ? EPOLLERR : static_cast<uint32_t>(result));
+        }
+        // Одноразовую заявку взводим снова, если обработчик не снял дескриптор и не взвёл её сам через Modify
+        if ((reg = Find(fd, generation)))
+        {
+            Apply(fd, *reg);
+        }
+    }
+
+    void CompleteRecv(const int fd, const uint32_t generation, const io_uring_cqe& cqe)
+    {
+        const bool hasBuffer = cqe.flags & IORING_CQE_F_BUFFER;
+        const auto bufferId = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        if (Registration* reg = Find(fd, generation))
+        {
+            if (!(cqe.flags & IORING_CQE_F_MORE))
+            {
+                reg->recvArmed = false;
+            }
+            if (cqe.res == -EINVAL && !hasBuffer)
+            {
+                // Ядро без multishot recv (до 6.0): дальше читаем по готовности
+                m_recvMultishot = false;
+            }
+            else if (cqe.res != -ECANCELED && cqe.res != -ENOBUFS)
+            {
+                // Данные отдаются и во время паузы: ядро уже забрало их из сокета
+                const auto receiver = reg->receiver;
+                (*receiver)(hasBuffer ? m_buffers->Data(bufferId) : nullptr, cqe.res);
+            }
+        }
+        if (hasBuffer)
+        {
+            m_buffers->Recycle(bufferId);
+        }
+        // Multishot завершился (кончились буферы, отмена, конец потока) — взводим снова, если приём не остановлен
+        if (Registration* reg = Find(fd, generation))
+        {
+            Apply(fd, *reg);
+        }
+    }
+
+    void CompleteAccept(const int fd, const uint32_t generation, const io_uring_cqe& cqe)
+    {
+        // Подключение, принятое для уже снятого сокета, просто закрывается
+        FileDesc client(cqe.res >= 0 ? cqe.res : -1);
+        Registration* reg = Find(fd, generation);
+        if (!reg)
+        {
+            return;
+        }
+        if (!(cqe.flags & IORING_CQE_F_MORE))
+        {
+            reg->acceptArmed = false;
+        }
+        if (cqe.res >= 0)
+        {
+            const auto acceptor = reg->acceptor;
+            (*acceptor)(std::move(client));
+        }
+        else if (cqe.res == -EINVAL && !reg->acceptArmed)
+        {
+            // Ядро без multishot accept (до 5.19): принимаем по готовности
+            m_acceptMultishot = false;
+            auto acceptor = std::move(reg->acceptor);
+            AddAcceptor(fd, std::move(*acceptor));
+            return;
+        }
+        else if ((cqe.res == -EMFILE || cqe.res == -ENFILE) && !reg->acceptArmed)
+        {
+            PauseAccept(fd);
+            return;
+        }
+        if ((reg = Find(fd, generation)) && !reg->acceptArmed)
+        {
+            ArmAccept(fd, *reg);
+        }
+    }
+
+    void Dispatch(const int fd, const uint32_t generation, const uint32_t events)
+    {
+        Registration* reg = Find(fd, generation);
+        if (!reg)
+        {
+            return;
+        }
+        if (reg->receiver && reg->receiving && !RingReceives() && (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)))
+        {
+            ReceiveReady(fd, generation);
+            if (!(reg = Find(fd, generation)))
+            {
+                return;
+            }
+        }
+        // Событие могло прийти по заявке со старой маской: обработчику — только то, что он ждёт сейчас
+        const uint32_t handlerEvents = events & (reg->events | EPOLLERR | EPOLLHUP);
+        if (handlerEvents != 0 && reg->handler && *reg->handler)
+        {
+            // Копия удерживает обработчик живым, даже если он снимет себя с регистрации
+            const auto handler = reg->handler;
+            (*handler)(handlerEvents);
+        }
+    }
+
+    // Чтение по готовности, пока сокет не опустеет или получатель не остановит приём
+    void ReceiveReady(const int fd, const uint32_t generation)
+    {
+        for (;;)
+        {
+            Registration* reg = Find(fd, generation);
+            if (!reg || !reg->receiving)
+            {
+                return;
+            }
+            const ssize_t size = read(fd, m_readBuffer.data(), m_readBuffer.size());
+            if (size < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                return;
+            }
+            const auto receiver = reg->receiver;
+            (*receiver)(m_readBuffer.data(), size < 0 ? -errno : size);
+            if (size <= 0)
+            {
+                return;
+            }
+        }
+    }
+
+    void AcceptReady(const int listenFd, const AcceptHandler& handler)
+    {
+        for (;;)
+        {
+            const int client = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (client == -1)
+            {
+                if (errno == EINTR || errno == ECONNABORTED)
+                {
+                    continue;
+                }
+                if (errno == EMFILE || errno == ENFILE)
+                {
+                    PauseAccept(listenFd);
+                }
+                // EAGAIN — очередь пуста; прочие ошибки повторятся при следующей готовности
+                return;
+            }
+            handler(FileDesc{ client });
+        }
+    }
+
+    // Дескрипторы кончились. Слушающий сокет остаётся готовым, и без паузы цикл крутился бы вхолостую;
+    // подключения тем временем ждут в очереди listen
+    void PauseAccept(const int listenFd)
+    {
+        const auto it = m_handlers.find(listenFd);
+        if (it == m_handlers.end())
+        {
+            return;
+        }
+        const uint32_t generation = it->second.generation;
+        if (!it->second.acceptor)
+        {
+            Modify(listenFd, 0);
+        }
+        RunAfter(AcceptRetryDelay, [this, listenFd, generation] {
+            Registration* reg = Find(listenFd, generation);
+            if (!reg)
+            {
+                return;
+            }
+            if (!reg->acceptor)
+            {
+                Modify(listenFd, EPOLLIN);
+            }
+            else if (!reg->acceptArmed)
+            {
+                ArmAccept(listenFd, *reg);
+            }
+        });
+    }
+
+    // Один timerfd на цикл, взведённый на ближайший срок
+    void ArmTimerFd()
+    {
+        itimerspec spec{};
+        if (!m_timers.empty())
+        {
+            // Нулевое время снимает таймер, поэтому срок не раньше первой наносекунды
+            const int64_t deadline = std::max<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    m_timers.begin()->first.first.time_since_epoch()).count(), 1);
+            spec.it_value.tv_sec = deadline / 1000000000;
+            spec.it_value.tv_nsec = deadline % 1000000000;
+        }
+        timerfd_settime(m_timerFd.Get(), TFD_TIMER_ABSTIME, &spec, nullptr);
+    }
+
+    void RunExpired()
+    {
+        uint64_t expirations;
+        [[maybe_unused]] auto _ = read(m_timerFd.Get(), &expirations, sizeof(expirations));
+
+        const Clock::time_point now = Clock::now();
+        while (!m_timers.empty() && m_timers.begin()->first.first <= now)
+        {
+            auto node = m_timers.extract(m_timers.begin());
+            m_timerDeadlines.erase(node.key().second);
+            // Задача может сама ставить и отменять таймеры
+            node.mapped()();
+        }
+        ArmTimerFd();
+    }
+
+    void RunPosted()
+    {
+        uint64_t value;
+        [[maybe_unused]] auto _ = read(m_wakeup.Get(), &value, sizeof(value));
+
+        std::vector<Task> tasks;
+        {
+            std::lock_guard lock(m_postedMutex);
+            tasks.swap(m_posted);
+        }
+        for (auto& task : tasks)
+        {
+            task();
+        }
+    }
+
+    // CLOCK_MONOTONIC, как и у timerfd
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t MaxEvents = 256;
+    static constexpr std::chrono::milliseconds AcceptRetryDelay{ 100 };
+    static constexpr unsigned RingEntries = 256;
+    static constexpr uint32_t GenerationMask = 0x3FFFFFFF;
+    static constexpr uint16_t ReceiveBufferGroup = 0;
+    static constexpr unsigned ReceiveBuffers = 256;
+    static constexpr size_t ReceiveBufferSize = 16384;
+    // Отмена всех операций при разрушении цикла; поколение 1 не даёт спутать её с обычной отменой
+    static constexpr uint64_t ShutdownUserData = (uint64_t(1) << 34) | (static_cast<uint64_t>(Kind::Cancel) << 32);
+
+    FileDesc m_epoll;
+    // Кольцо объявлено после буферов и разрушается первым: ядро не должно пережить память, в которую пишет
+    std::unique_ptr<ProvidedBuffers> m_buffers;
+    std::unique_ptr<IoUring> m_ring;
+    bool m_recvMultishot = true;
+    bool m_acceptMultishot = true;
+    std::vector<char> m_readBuffer = std::vector<char>(ReceiveBufferSize);
+    std::vector<epoll_event> m_events = std::vector<epoll_event>(MaxEvents);
+    FileDesc m_wakeup;
+    FileDesc m_timerFd;
+    std::map<std::pair<Clock::time_point, TimerId>, Task> m_timers;
+    std::unordered_map<TimerId, Clock::time_point> m_timerDeadlines;
+    TimerId m_lastTimerId = 0;
+    std::unordered_map<int, Registration> m_handlers;
+    uint32_t m_generation = 0;
+    std::atomic<bool> m_stopped = false;
+    std::mutex m_postedMutex;
+    std::vector<Task> m_posted;
+};
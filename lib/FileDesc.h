@@ -1,4 +1,5 @@
 #pragma once
+#include <fcntl.h>
 #include <stdexcept>
 #include <system_error>
 #include <unistd.h>
@@ -74,6 +75,12 @@ public:
         return m_desc;
     }
 
+    // Дескриптор переходит вызывающему, который сам его закроет
+    [[nodiscard]] int Release() noexcept
+    {
+        return std::exchange(m_desc, InvalidDesc);
+    }
+
     size_t Read(void* buffer, const size_t length)
     {
         EnsureOpen();
@@ -84,6 +91,16 @@ public:
         throw std::system_error(errno, std::generic_category());
     }
 
+    void SetNonBlocking()
+    {
+        EnsureOpen();
+        const int flags = fcntl(m_desc, F_GETFL, 0);
+        if (flags == -1 || fcntl(m_desc, F_SETFL, flags | O_NONBLOCK) == -1)
+        {
+            throw std::system_error(errno, std::generic_category());
+        }
+    }
+
 private:
     void EnsureOpen() const
     {
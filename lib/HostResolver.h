@@ -0,0 +1,271 @@
+#pragma once
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Результат разрешения имени: адреса либо текст ошибки
+struct HostAddresses
+{
+    std::vector<in_addr> addresses;
+    std::string error;
+
+    [[nodiscard]] bool Ok() const noexcept
+    {
+        return error.empty();
+    }
+};
+
+// Кэш разрешения имён с учётом TTL и кэшированием отказов (negative caching).
+// Поиск выполняется в собственных потоках резолвера, поэтому поток цикла событий не блокируется;
+// одновременные запросы одного имени объединяются в один поиск.
+// Источник адресов подключаемый: по умолчанию getaddrinfo, можно передать, например, итеративный DnsResolver
+class HostResolver
+{
+public:
+    using Result = std::shared_ptr<const HostAddresses>;
+    using Callback = std::function<void(Result)>;
+
+    // Ответ источника: адреса и сколько их можно хранить. Об ошибке источник сообщает исключением
+    struct Lookup
+    {
+        std::vector<in_addr> addresses;
+        std::chrono::seconds ttl;
+    };
+    using Backend = std::function<Lookup(const std::string& host)>;
+
+    // getaddrinfo не сообщает TTL, поэтому его ответы хранятся фиксированное время
+    static constexpr std::chrono::seconds DefaultTtl{ 30 };
+    static constexpr std::chrono::seconds NegativeTtl{ 5 };
+    // Слишком короткий TTL превратил бы кэш в бесполезный, слишком длинный — помешал бы сменить адрес
+    static constexpr std::chrono::seconds MinTtl{ 1 };
+    static constexpr std::chrono::seconds MaxTtl{ 3600 };
+    static constexpr size_t MaxEntries = 4096;
+
+    explicit HostResolver(Backend backend = GetAddrInfo, const size_t threads = 2)
+            : m_backend(std::move(backend))
+    {
+        for (size_t i = 0; i < std::max<size_t>(1, threads); ++i)
+        {
+            m_threads.emplace_back([this] { Work(); });
+        }
+    }
+
+    HostResolver(const HostResolver&) = delete;
+    HostResolver& operator=(const HostResolver&) = delete;
+
+    ~HostResolver()
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wakeup.notify_all();
+        for (auto& thread : m_threads)
+        {
+            thread.join();
+        }
+    }
+
+    // Общий экземпляр для клиентов, которым не нужен свой источник
+    static HostResolver& Default()
+    {
+        static HostResolver resolver;
+        return resolver;
+    }
+
+    // Если ответ уже в кэше (или host — IP-адрес), callback вызывается сразу в вызывающем потоке,
+    // иначе — из потока резолвера. Переносить результат в свой цикл событий — забота вызывающего
+    void ResolveAsync(const std::string& host, Callback callback)
+    {
+        if (auto literal = ParseLiteral(host))
+        {
+            callback(std::move(literal));
+            return;
+        }
+        const std::string key = ToLower(host);
+        std::unique_lock lock(m_mutex);
+        if (auto cached = FindLocked(key))
+        {
+            lock.unlock();
+            callback(std::move(cached));
+            return;
+        }
+        auto& waiters = m_pending[key];
+        waiters.push_back(std::move(callback));
+        if (waiters.size() == 1)
+        {
+            m_queue.push_back(key);
+            m_wakeup.notify_one();
+        }
+    }
+
+    // Блокирующий вариант для клиентов без цикла событий
+    std::vector<in_addr> Resolve(const std::string& host)
+    {
+        std::mutex mutex;
+        std::condition_variable done;
+        Result result;
+        ResolveAsync(host, [&](Result value) {
+            std::lock_guard lock(mutex);
+            result = std::move(value);
+            done.notify_one();
+        });
+        std::unique_lock lock(mutex);
+        done.wait(lock, [&] { return result != nullptr; });
+        if (!result->Ok())
+        {
+            throw std::runtime_error(result->error);
+        }
+        return result->addresses;
+    }
+
+    static Lookup GetAddrInfo(const std::string& host)
+    {
+        addrinfo hints{};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+
+        addrinfo* result;
+        const int status = getaddrinfo(host.c_str(), nullptr, &hints, &result);
+        if (status != 0)
+        {
+            throw std::runtime_error("DNS resolution failed for " + host + ": " + gai_strerror(status));
+        }
+        Lookup lookup{ {}, DefaultTtl };
+        for (addrinfo* rp = result; rp != nullptr; rp = rp->ai_next)
+        {
+            lookup.addresses.push_back(reinterpret_cast<const sockaddr_in*>(rp->ai_addr)->sin_addr);
+        }
+        freeaddrinfo(result);
+        return lookup;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry
+    {
+        Result result;
+        Clock::time_point expiresAt;
+    };
+
+    static Result ParseLiteral(const std::string& host)
+    {
+        in_addr addr{};
+        if (inet_pton(AF_INET, host.c_str(), &addr) != 1)
+        {
+            return nullptr;
+        }
+        return std::make_shared<HostAddresses>(HostAddresses{ { addr }, {} });
+    }
+
+    static std::string ToLower(std::string value)
+    {
+        std::transform(value.begin(), value.end(), value.begin(), [](const unsigned char c) {
+            return static_cast<char>(std::tolower(c));
+        });
+        return value;
+    }
+
+    Result FindLocked(const std::string& key)
+    {
+        const auto it = m_cache.find(key);
+        if (it == m_cache.end())
+        {
+            return nullptr;
+        }
+        if (it->second.expiresAt <= Clock::now())
+        {
+            m_cache.erase(it);
+            return nullptr;
+        }
+        return it->second.result;
+    }
+
+    void StoreLocked(const std::string& key, Result result, const std::chrono::seconds ttl)
+    {
+        const auto now = Clock::now();
+        if (m_cache.size() >= MaxEntries)
+        {
+            // Сначала выбрасываем просроченные; если не помогло — кэш просто начинается заново
+            for (auto it = m_cache.begin(); it != m_cache.end();)
+            {
+                it = it->second.expiresAt <= now ? m_cache.erase(it) : std::next(it);
+            }
+            if (m_cache.size() >= MaxEntries)
+            {
+                m_cache.clear();
+            }
+        }
+        m_cache[key] = Entry{ std::move(result), now + std::clamp(ttl, MinTtl, MaxTtl) };
+    }
+
+    void Work()
+    {
+        while (true)
+        {
+            std::string key;
+            {
+                std::unique_lock lock(m_mutex);
+                m_wakeup.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+                if (m_stopping)
+                {
+                    return;
+                }
+                key = std::move(m_queue.front());
+                m_queue.pop_front();
+            }
+
+            auto result = std::make_shared<HostAddresses>();
+            std::chrono::seconds ttl = NegativeTtl;
+            try
+            {
+                Lookup lookup = m_backend(key);
+                if (lookup.addresses.empty())
+                {
+                    throw std::runtime_error("No addresses found for " + key);
+                }
+                result->addresses = std::move(lookup.addresses);
+                ttl = lookup.ttl;
+            }
+            catch (const std::exception& e)
+            {
+                result->error = e.what();
+            }
+
+            std::vector<Callback> waiters;
+            {
+                std::lock_guard lock(m_mutex);
+                StoreLocked(key, result, ttl);
+                waiters = std::move(m_pending[key]);
+                m_pending.erase(key);
+            }
+            for (auto& waiter : waiters)
+            {
+                waiter(result);
+            }
+        }
+    }
+
+    Backend m_backend;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::deque<std::string> m_queue;
+    std::unordered_map<std::string, std::vector<Callback>> m_pending;
+    std::unordered_map<std::string, Entry> m_cache;
+    bool m_stopping = false;
+    std::vector<std::thread> m_threads;
+};
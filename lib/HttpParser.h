@@ -0,0 +1,297 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+struct HttpHeader
+{
+    std::string_view name;
+    std::string_view value;
+};
+
+// Разобранный запрос. Все поля — представления в буфер приёма, копий не делается:
+// они действительны, пока буфер не изменён
+struct HttpRequestView
+{
+    static constexpr size_t MaxHeaders = 64;
+
+    std::string_view method;
+    std::string_view target;
+    std::string_view version;
+    std::array<HttpHeader, MaxHeaders> headers{};
+    size_t headerCount = 0;
+
+    // Имя заголовка сравнивается без учёта регистра; пустой view, если заголовка нет
+    [[nodiscard]] std::string_view Header(std::string_view name) const
+    {
+        for (size_t i = 0; i < headerCount; ++i)
+        {
+            if (EqualsIgnoreCase(headers[i].name, name))
+            {
+                return headers[i].value;
+            }
+        }
+        return {};
+    }
+
+    static bool EqualsIgnoreCase(std::string_view a, std::string_view b)
+    {
+        if (a.size() != b.size())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); ++i)
+        {
+            if (ToLower(a[i]) != ToLower(b[i]))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static char ToLower(const char c)
+    {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+};
+
+// Инкрементальный разбор заголовка HTTP-запроса без выделений памяти.
+// Parse можно вызывать повторно по мере дочитывания: уже просмотренные строки не сканируются заново.
+// Буфер может переаллоцироваться между вызовами — парсер хранит смещения, а не указатели.
+// После Complete запрос занимает Consumed() байт; остаток буфера — следующий (конвейерный) запрос
+class HttpRequestParser
+{
+public:
+    enum class Result
+    {
+        Complete,
+        Incomplete,
+        Error
+    };
+
+    static constexpr size_t MaxHeadSize = 16 * 1024;
+
+    Result Parse(std::string_view buffer)
+    {
+        if (m_complete)
+        {
+            return Result::Complete;
+        }
+        while (m_scanned < buffer.size())
+        {
+            const size_t newline = buffer.find('\n', m_scanned);
+            if (newline == std::string_view::npos)
+            {
+                m_scanned = buffer.size();
+                break;
+            }
+            // Предел один и тот же, пришёл ли заголовок одним чтением или частями
+            if (newline >= MaxHeadSize)
+            {
+                return Result::Error;
+            }
+            size_t lineEnd = newline;
+            if (lineEnd > m_lineStart && buffer[lineEnd - 1] == '\r')
+            {
+                --lineEnd;
+            }
+            const size_t lineStart = m_lineStart;
+            m_scanned = m_lineStart = newline + 1;
+
+            if (lineEnd == lineStart)
+            {
+                // Пустые строки перед строкой запроса допускаются (RFC 9112, 2.2)
+                if (!m_hasRequestLine)
+                {
+                    continue;
+                }
+                m_complete = true;
+                Materialize(buffer);
+                return Result::Complete;
+            }
+            if (!(m_hasRequestLine ? OnHeaderLine(buffer, lineStart, lineEnd) : OnRequestLine(buffer, lineStart, lineEnd)))
+            {
+                return Result::Error;
+            }
+        }
+        return m_scanned > MaxHeadSize ? Result::Error : Result::Incomplete;
+    }
+
+    [[nodiscard]] const HttpRequestView& Request() const noexcept
+    {
+        return m_request;
+    }
+
+    // Размер заголовка запроса вместе с завершающей пустой строкой
+    [[nodiscard]] size_t Consumed() const noexcept
+    {
+        return m_lineStart;
+    }
+
+    void Reset()
+    {
+        *this = HttpRequestParser{};
+    }
+
+private:
+    struct Span
+    {
+        uint32_t offset = 0;
+        uint32_t length = 0;
+
+        [[nodiscard]] std::string_view In(std::string_view buffer) const
+        {
+            return buffer.substr(offset, length);
+        }
+    };
+
+    struct HeaderSpan
+    {
+        Span name;
+        Span value;
+    };
+
+    static Span MakeSpan(const size_t begin, const size_t end)
+    {
+        return Span{ static_cast<uint32_t>(begin), static_cast<uint32_t>(end - begin) };
+    }
+
+    bool OnRequestLine(std::string_view buffer, const size_t begin, const size_t end)
+    {
+        const std::string_view line = buffer.substr(begin, end - begin);
+        const size_t firstSpace = line.find(' ');
+        const size_t lastSpace = line.rfind(' ');
+        if (firstSpace == std::string_view::npos || firstSpace == 0 || lastSpace == firstSpace)
+        {
+            return false;
+        }
+        if (line.substr(lastSpace + 1).substr(0, 5) != "HTTP/")
+        {
+            return false;
+        }
+        m_method = MakeSpan(begin, begin + firstSpace);
+        m_target = MakeSpan(begin + firstSpace + 1, begin + lastSpace);
+        m_version = MakeSpan(begin + lastSpace + 1, end);
+        m_hasRequestLine = m_target.length > 0;
+        return m_hasRequestLine;
+    }
+
+    bool OnHeaderLine(std::string_view buffer, const size_t begin, const size_t end)
+    {
+        if (m_headerCount == HttpRequestView::MaxHeaders)
+        {
+            return false;
+        }
+        // Строка с пробелом в начале — obs-fold; её, как и пробел перед двоеточием, отклоняем (RFC 9112, 5.1 и 5.2)
+        const std::string_view line = buffer.substr(begin, end - begin);
+        const size_t colon = line.find(':');
+        if (colon == std::string_view::npos || colon == 0
+            || line.substr(0, colon).find_first_of(" \t") != std::string_view::npos)
+        {
+            return false;
+        }
+        // Повторный Host или Content-Length разные звенья цепочки могут понять по-разному (RFC 9112, 3.2 и 6.3)
+        const std::string_view name = line.substr(0, colon);
+        if (HttpRequestView::EqualsIgnoreCase(name, "Host") || HttpRequestView::EqualsIgnoreCase(name, "Content-Length"))
+        {
+            for (size_t i = 0; i < m_headerCount; ++i)
+            {
+                if (HttpRequestView::EqualsIgnoreCase(m_headers[i].name.In(buffer), name))
+                {
+                    return false;
+                }
+            }
+        }
+        size_t valueBegin = begin + colon + 1;
+        size_t valueEnd = end;
+        while (valueBegin < valueEnd && (buffer[valueBegin] == ' ' || buffer[valueBegin] == '\t'))
+        {
+            ++valueBegin;
+        }
+        while (valueEnd > valueBegin && (buffer[valueEnd - 1] == ' ' || buffer[valueEnd - 1] == '\t'))
+        {
+            --valueEnd;
+        }
+        m_headers[m_headerCount++] = HeaderSpan{ MakeSpan(begin, begin + colon), MakeSpan(valueBegin, valueEnd) };
+        return true;
+    }
+
+    void Materialize(std::string_view buffer)
+    {
+        m_request.method = m_method.In(buffer);
+        m_request.target = m_target.In(buffer);
+        m_request.version = m_version.In(buffer);
+        m_request.headerCount = m_headerCount;
+        for (size_t i = 0; i < m_headerCount; ++i)
+        {
+            m_request.headers[i] = HttpHeader{ m_headers[i].name.In(buffer), m_headers[i].value.In(buffer) };
+        }
+    }
+
+    size_t m_scanned = 0;
+    size_t m_lineStart = 0;
+    bool m_hasRequestLine = false;
+    bool m_complete = false;
+    Span m_method;
+    Span m_target;
+    Span m_version;
+    std::array<HeaderSpan, HttpRequestView::MaxHeaders> m_headers{};
+    size_t m_headerCount = 0;
+    HttpRequestView m_request;
+};
+
+// Абсолютная форма цели запроса к прокси: http://host[:port][/path]
+struct HttpUrlView
+{
+    std::string_view host;
+    uint16_t port = 80;
+    std::string_view path;
+};
+
+inline std::optional<HttpUrlView> ParseHttpUrl(std::string_view url)
+{
+    constexpr std::string_view scheme = "http://";
+    if (url.substr(0, scheme.size()) != scheme)
+    {
+        return std::nullopt;
+    }
+    url.remove_prefix(scheme.size());
+
+    const size_t pathStart = url.find('/');
+    std::string_view authority = url.substr(0, pathStart);
+    HttpUrlView result;
+    result.path = pathStart == std::string_view::npos ? std::string_view("/") : url.substr(pathStart);
+
+    const size_t colon = authority.find(':');
+    if (colon != std::string_view::npos)
+    {
+        const std::string_view portStr = authority.substr(colon + 1);
+        if (portStr.empty() || portStr.size() > 5)
+        {
+            return std::nullopt;
+        }
+        uint32_t port = 0;
+        for (const char c : portStr)
+        {
+            if (c < '0' || c > '9')
+            {
+                return std::nullopt;
+            }
+            port = port * 10 + static_cast<uint32_t>(c - '0');
+        }
+        if (port == 0 || port > 65535)
+        {
+            return std::nullopt;
+        }
+        result.port = static_cast<uint16_t>(port);
+        authority = authority.substr(0, colon);
+    }
+    if (authority.empty())
+    {
+        return std::nullopt;
+    }
+    result.host = authority;
+    return result;
+}
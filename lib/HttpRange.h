@@ -0,0 +1,313 @@
+#pragma once
+#include "HttpParser.h"
+#include <algorithm>
+#include <cstdint>
+#include <ctime>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Диапазон байт тела, границы включительно, как в заголовке Range
+struct ByteRange
+{
+    uint64_t first = 0;
+    uint64_t last = 0;
+};
+
+// Часть ответа на запрос диапазонов: заголовок части и кусок тела [offset, end)
+struct RangePart
+{
+    std::string head;
+    uint64_t offset = 0;
+    uint64_t end = 0;
+};
+
+// Условные запросы и запросы диапазонов (RFC 9110, 13 и 14) — общее для веб-сервера и кэша прокси.
+// Валидаторы ответа передаются как есть: ETag в кавычках, Last-Modified в формате IMF-fixdate
+class HttpRange
+{
+public:
+    // Больше диапазонов в одном запросе не обслуживаем: ответ отдаётся целиком (защита от тысяч мелких кусков)
+    static constexpr size_t MaxRanges = 16;
+
+    // If-None-Match и If-Modified-Since: true — у клиента актуальная копия, нужен ответ 304.
+    // If-Modified-Since учитывается, только если If-None-Match нет
+    static bool IsNotModified(const HttpRequestView& request, std::string_view etag, std::string_view lastModified)
+    {
+        const std::string_view ifNoneMatch = request.Header("If-None-Match");
+        if (!ifNoneMatch.empty())
+        {
+            return !etag.empty() && EtagListContains(ifNoneMatch, etag, false);
+        }
+        const std::string_view ifModifiedSince = request.Header("If-Modified-Since");
+        if (ifModifiedSince.empty() || lastModified.empty())
+        {
+            return false;
+        }
+        const auto since = ParseHttpDate(ifModifiedSince);
+        const auto modified = ParseHttpDate(lastModified);
+        return since && modified && *modified <= *since;
+    }
+
+    // Диапазоны из заголовка Range для тела размером size.
+    // std::nullopt — заголовка нет, он не разобран или не прошёл If-Range: отдаётся всё тело (200).
+    // Пустой список — ни один диапазон не попал в тело (416)
+    static std::optional<std::vector<ByteRange>> Parse(const HttpRequestView& request, uint64_t size,
+                                                       std::string_view etag, std::string_view lastModified)
+    {
+        const std::string_view header = request.Header("Range");
+        if (header.empty() || !IfRangeHolds(request.Header("If-Range"), etag, lastModified))
+        {
+            return std::nullopt;
+        }
+        return Parse(header, size);
+    }
+
+    static std::optional<std::vector<ByteRange>> Parse(std::string_view header, uint64_t size)
+    {
+        constexpr std::string_view unit = "bytes=";
+        if (header.size() < unit.size() || !HttpRequestView::EqualsIgnoreCase(header.substr(0, unit.size()), unit))
+        {
+            return std::nullopt;
+        }
+        header.remove_prefix(unit.size());
+
+        std::vector<ByteRange> ranges;
+        size_t count = 0;
+        while (!header.empty())
+        {
+            const size_t comma = header.find(',');
+            const std::string_view item = Trim(header.substr(0, comma));
+            header = comma == std::string_view::npos ? std::string_view() : header.substr(comma + 1);
+            if (item.empty())
+            {
+                continue;
+            }
+            if (++count > MaxRanges)
+            {
+                return std::nullopt;
+            }
+
+            const size_t dash = item.find('-');
+            if (dash == std::string_view::npos)
+            {
+                return std::nullopt;
+            }
+            const auto first = ParseNumber(item.substr(0, dash));
+            const auto last = ParseNumber(item.substr(dash + 1));
+            if (dash == 0)
+            {
+                // "-N": последние N байт
+                if (!last)
+                {
+                    return std::nullopt;
+                }
+                if (*last > 0 && size > 0)
+                {
+                    ranges.push_back({ size - std::min(*last, size), size - 1 });
+                }
+                continue;
+            }
+            if (!first || (dash + 1 < item.size() && (!last || *last < *first)))
+            {
+                return std::nullopt;
+            }
+            if (*first < size)
+            {
+                ranges.push_back({ *first, last ? std::min(*last, size - 1) : size - 1 });
+            }
+        }
+        if (count == 0)
+        {
+            return std::nullopt;
+        }
+        Coalesce(ranges);
+        return ranges;
+    }
+
+    static std::string ContentRange(const ByteRange& range, uint64_t size)
+    {
+        return "bytes " + std::to_string(range.first) + "-" + std::to_string(range.last) + "/" + std::to_string(size);
+    }
+
+    // Тело multipart/byteranges: части с заголовками и завершающий разделитель (часть без данных).
+    // contentLength — полная длина такого тела
+    static std::vector<RangePart> Multipart(const std::vector<ByteRange>& ranges, uint64_t size,
+                                            std::string_view contentType, std::string_view boundary,
+                                            uint64_t& contentLength)
+    {
+        std::vector<RangePart> parts;
+        parts.reserve(ranges.size() + 1);
+        contentLength = 0;
+        for (const ByteRange& range : ranges)
+        {
+            RangePart part;
+            part.head = parts.empty() ? "--" : "\r\n--";
+            part.head += std::string(boundary) + "\r\n";
+            if (!contentType.empty())
+            {
+                part.head += "Content-Type: " + std::string(contentType) + "\r\n";
+            }
+            part.head += "Content-Range: " + ContentRange(range, size) + "\r\n\r\n";
+            part.offset = range.first;
+            part.end = range.last + 1;
+            contentLength += part.head.size() + (part.end - part.offset);
+            parts.push_back(std::move(part));
+        }
+        RangePart closing;
+        closing.head = "\r\n--" + std::string(boundary) + "--\r\n";
+        contentLength += closing.head.size();
+        parts.push_back(std::move(closing));
+        return parts;
+    }
+
+    // Случайный разделитель частей: совпасть с содержимым файла он практически не может
+    static std::string MakeBoundary()
+    {
+        thread_local std::mt19937_64 random{ std::random_device{}() };
+        static constexpr char digits[] = "0123456789abcdef";
+        std::string boundary = "range_";
+        for (uint64_t value = random(), i = 0; i < 16; ++i, value >>= 4)
+        {
+            boundary += digits[value & 0xF];
+        }
+        return boundary;
+    }
+
+    // IMF-fixdate: "Sun, 06 Nov 1994 08:49:37 GMT"
+    static std::optional<int64_t> ParseHttpDate(std::string_view value)
+    {
+        if (value.empty())
+        {
+            return std::nullopt;
+        }
+        const std::string text(value);
+        std::tm tm{};
+        const char* end = strptime(text.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+        if (end == nullptr)
+        {
+            return std::nullopt;
+        }
+        return static_cast<int64_t>(timegm(&tm));
+    }
+
+    static std::string FormatHttpDate(int64_t time)
+    {
+        const auto value = static_cast<time_t>(time);
+        std::tm tm{};
+        gmtime_r(&value, &tm);
+        char buffer[64];
+        const size_t size = strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+        return std::string(buffer, size);
+    }
+
+private:
+    // Пересекающиеся диапазоны сливаются (RFC 9110, 14.2), иначе "bytes=0-,0-,0-" умножил бы ответ.
+    // Без пересечений части идут в том порядке, в каком их запросил клиент
+    static void Coalesce(std::vector<ByteRange>& ranges)
+    {
+        std::vector<ByteRange> sorted = ranges;
+        std::sort(sorted.begin(), sorted.end(), [](const ByteRange& a, const ByteRange& b) {
+            return a.first < b.first;
+        });
+        std::vector<ByteRange> merged;
+        for (const ByteRange& range : sorted)
+        {
+            if (!merged.empty() && range.first <= merged.back().last)
+            {
+                merged.back().last = std::max(merged.back().last, range.last);
+            }
+            else
+            {
+                merged.push_back(range);
+            }
+        }
+        if (merged.size() < ranges.size())
+        {
+            ranges = std::move(merged);
+        }
+    }
+
+    // If-Range с ETag требует строгого совпадения, с датой — точного совпадения с Last-Modified
+    static bool IfRangeHolds(std::string_view ifRange, std::string_view etag, std::string_view lastModified)
+    {
+        ifRange = Trim(ifRange);
+        if (ifRange.empty())
+        {
+            return true;
+        }
+        if (ifRange.front() == '"' || ifRange.substr(0, 2) == "W/")
+        {
+            return !etag.empty() && EtagListContains(ifRange, etag, true);
+        }
+        return !lastModified.empty() && ifRange == lastModified;
+    }
+
+    // Слабое сравнение игнорирует префикс W/; при строгом слабые ETag не совпадают ни с чем
+    static bool EtagListContains(std::string_view list, std::string_view etag, bool strong)
+    {
+        if (Trim(list) == "*")
+        {
+            return true;
+        }
+        const bool etagWeak = etag.substr(0, 2) == "W/";
+        if (strong && etagWeak)
+        {
+            return false;
+        }
+        const std::string_view opaque = etagWeak ? etag.substr(2) : etag;
+        while (!list.empty())
+        {
+            const size_t comma = list.find(',');
+            std::string_view item = Trim(list.substr(0, comma));
+            list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+            const bool itemWeak = item.substr(0, 2) == "W/";
+            if (itemWeak)
+            {
+                if (strong)
+                {
+                    continue;
+                }
+                item.remove_prefix(2);
+            }
+            if (item == opaque)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static std::optional<uint64_t> ParseNumber(std::string_view value)
+    {
+        if (value.empty() || value.size() > 19)
+        {
+            return std::nullopt;
+        }
+        uint64_t result = 0;
+        for (const char c : value)
+        {
+            if (c < '0' || c > '9')
+            {
+                return std::nullopt;
+            }
+            result = result * 10 + static_cast<uint64_t>(c - '0');
+        }
+        return result;
+    }
+
+    static std::string_view Trim(std::string_view value)
+    {
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+        {
+            value.remove_prefix(1);
+        }
+        while (!value.empty() && (value.back() == ' ' || value.back() == '\t'))
+        {
+            value.remove_suffix(1);
+        }
+        return value;
+    }
+};
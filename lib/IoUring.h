@@ -0,0 +1,324 @@
+#pragma once
+#include "FileDesc.h"
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <system_error>
+#include <vector>
+
+// Головы и хвосты колец общие с ядром: порядок памяти как в liburing (io_uring_smp_load_acquire/store_release)
+template <typename T>
+T LoadAcquire(const T* value)
+{
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+template <typename T>
+void StoreRelease(T* target, const T value)
+{
+    __atomic_store_n(target, value, __ATOMIC_RELEASE);
+}
+
+// Минимальная обёртка над io_uring на системных вызовах, без liburing.
+// Заявки (SQE) копятся в кольце и уходят в ядро пачкой одним io_uring_enter — вместе с ожиданием завершений
+// https://man7.org/linux/man-pages/man7/io_uring.7.html
+class IoUring
+{
+public:
+    // nullptr, если ядро не поддерживает io_uring или он запрещён (io_uring_disabled, seccomp)
+    static std::unique_ptr<IoUring> TryCreate(const unsigned entries)
+    {
+        io_uring_params params{};
+        // Сначала с флагами, которые уменьшают число прерываний, затем без них для старых ядер
+        for (const unsigned flags : { IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN, 0u })
+        {
+            params = io_uring_params{};
+            params.flags = flags;
+            FileDesc fd(static_cast<int>(syscall(__NR_io_uring_setup, entries, &params)));
+            if (!fd.IsOpen())
+            {
+                if (errno == EINVAL)
+                {
+                    continue;
+                }
+                return nullptr;
+            }
+            // Без NODROP переполненная очередь завершений теряет события; без SINGLE_MMAP нужен второй mmap
+            if (!(params.features & IORING_FEAT_NODROP) || !(params.features & IORING_FEAT_SINGLE_MMAP))
+            {
+                return nullptr;
+            }
+            return std::unique_ptr<IoUring>(new IoUring(std::move(fd), params));
+        }
+        return nullptr;
+    }
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    ~IoUring()
+    {
+        munmap(m_sqes, m_sqesSize);
+        munmap(m_ring, m_ringSize);
+    }
+
+    // Свободная заявка, обнулённая. Если кольцо заявок заполнено, накопленное отправляется без ожидания.
+    // Ядро не примет заявки (EBUSY), пока очередь завершений полна: тогда завершения переносятся в отложенные,
+    // их обработчикам отдаст ForEachCqe. Обрабатывать их прямо здесь нельзя — GetSqe зовут и из обработчиков
+    io_uring_sqe* GetSqe()
+    {
+        while (m_sqTail - LoadAcquire(m_sqHead) >= m_sqEntries)
+        {
+            if (!Submit(false))
+            {
+                DeferCqes();
+            }
+        }
+        io_uring_sqe* sqe = &m_sqes[m_sqTail & m_sqMask];
+        std::memset(sqe, 0, sizeof(*sqe));
+        ++m_sqTail;
+        return sqe;
+    }
+
+    // Отправляет накопленные заявки; с wait ещё и ждёт хотя бы одно завершение.
+    // EINTR не ошибка. false — ядро придержало заявки до разбора очереди завершений (EBUSY) или ему не хватило памяти (EAGAIN)
+    bool Submit(bool wait)
+    {
+        // Отложенные завершения уже готовы к разбору: ждать новых незачем
+        wait = wait && m_deferred.empty();
+        StoreRelease(m_sqTailShared, m_sqTail);
+        const unsigned pending = m_sqTail - m_submitted;
+        if (pending == 0 && !wait)
+        {
+            return true;
+        }
+        const long result = syscall(__NR_io_uring_enter, m_fd.Get(), pending, wait ? 1 : 0,
+                                    wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+        if (result < 0)
+        {
+            if (errno == EINTR)
+            {
+                return true;
+            }
+            if (errno == EBUSY || errno == EAGAIN)
+            {
+                return false;
+            }
+            throw std::system_error(errno, std::generic_category());
+        }
+        m_submitted += static_cast<unsigned>(result);
+        return true;
+    }
+
+    // Разбирает все готовые завершения, сначала отложенные. Обработчик может тут же добавлять новые заявки
+    template <typename F>
+    void ForEachCqe(F&& handler)
+    {
+        for (;;)
+        {
+            io_uring_cqe cqe;
+            if (m_deferred.empty())
+            {
+                const unsigned head = *m_cqHead;
+                if (head == LoadAcquire(m_cqTail))
+                {
+                    return;
+                }
+                cqe = m_cqes[head & m_cqMask];
+                // Ячейка скопирована — её можно сразу вернуть ядру
+                StoreRelease(m_cqHead, head + 1);
+            }
+            else
+            {
+                cqe = m_deferred.front();
+                m_deferred.pop_front();
+            }
+            handler(cqe);
+        }
+    }
+
+    [[nodiscard]] int Get() const noexcept
+    {
+        return m_fd.Get();
+    }
+
+private:
+    // Освобождает очередь завершений, не вызывая обработчиков: ядро сможет перенести в неё придержанные
+    void DeferCqes()
+    {
+        unsigned head = *m_cqHead;
+        const unsigned tail = LoadAcquire(m_cqTail);
+        while (head != tail)
+        {
+            m_deferred.push_back(m_cqes[head & m_cqMask]);
+            ++head;
+        }
+        StoreRelease(m_cqHead, head);
+    }
+
+    IoUring(FileDesc fd, const io_uring_params& params)
+        : m_fd(std::move(fd))
+        , m_sqEntries(params.sq_entries)
+    {
+        const size_t sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        const size_t cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        m_ringSize = std::max(sqSize, cqSize);
+        m_ring = mmap(nullptr, m_ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd.Get(),
+                      IORING_OFF_SQ_RING);
+        if (m_ring == MAP_FAILED)
+        {
+            throw std::system_error(errno, std::generic_category());
+        }
+        m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd.Get(),
+                          IORING_OFF_SQES);
+        if (sqes == MAP_FAILED)
+        {
+            const int error = errno;
+            munmap(m_ring, m_ringSize);
+            throw std::system_error(error, std::generic_category());
+        }
+        m_sqes = static_cast<io_uring_sqe*>(sqes);
+
+        auto* base = static_cast<char*>(m_ring);
+        m_sqHead = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+        m_sqTailShared = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+        m_sqMask = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+        m_cqHead = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+        m_cqTail = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+        m_cqMask = *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+        m_cqes = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+
+        // Заявки всегда берутся по порядку, поэтому массив индексов заполняется один раз
+        auto* array = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+        for (unsigned i = 0; i < params.sq_entries; ++i)
+        {
+            array[i] = i;
+        }
+        m_sqTail = *m_sqTailShared;
+        m_submitted = m_sqTail;
+    }
+
+    FileDesc m_fd;
+    void* m_ring = nullptr;
+    size_t m_ringSize = 0;
+    io_uring_sqe* m_sqes = nullptr;
+    size_t m_sqesSize = 0;
+
+    unsigned m_sqEntries;
+    unsigned* m_sqHead = nullptr;
+    unsigned* m_sqTailShared = nullptr;
+    unsigned m_sqMask = 0;
+    unsigned m_sqTail = 0;
+    unsigned m_submitted = 0;
+
+    unsigned* m_cqHead = nullptr;
+    unsigned* m_cqTail = nullptr;
+    unsigned m_cqMask = 0;
+    io_uring_cqe* m_cqes = nullptr;
+    std::deque<io_uring_cqe> m_deferred;
+};
+
+// Кольцо буферов, из которых ядро само выбирает буфер под каждый принятый пакет (IORING_REGISTER_PBUF_RING, ядро 5.19+).
+// Приём не держит буфер на каждое соединение: буфер занят только между завершением и возвратом в кольцо
+class ProvidedBuffers
+{
+public:
+    // nullptr, если ядро не умеет регистрировать кольцо буферов
+    static std::unique_ptr<ProvidedBuffers> TryCreate(IoUring& ring, const uint16_t groupId, const unsigned count,
+                                                      const size_t bufferSize)
+    {
+        auto buffers = std::unique_ptr<ProvidedBuffers>(new ProvidedBuffers(groupId, count, bufferSize));
+        io_uring_buf_reg reg{};
+        reg.ring_addr = reinterpret_cast<uint64_t>(buffers->m_ring);
+        reg.ring_entries = count;
+        reg.bgid = groupId;
+        if (syscall(__NR_io_uring_register, ring.Get(), IORING_REGISTER_PBUF_RING, &reg, 1) != 0)
+        {
+            return nullptr;
+        }
+        for (uint16_t id = 0; id < count; ++id)
+        {
+            buffers->Add(id);
+        }
+        buffers->Publish();
+        return buffers;
+    }
+
+    ProvidedBuffers(const ProvidedBuffers&) = delete;
+    ProvidedBuffers& operator=(const ProvidedBuffers&) = delete;
+
+    ~ProvidedBuffers()
+    {
+        std::free(m_ring);
+    }
+
+    // Ядро перестаёт брать буферы из кольца; вызывается, когда ни одной операции с ним не осталось
+    void Unregister(IoUring& ring)
+    {
+        io_uring_buf_reg reg{};
+        reg.bgid = m_groupId;
+        syscall(__NR_io_uring_register, ring.Get(), IORING_UNREGISTER_PBUF_RING, &reg, 1);
+    }
+
+    [[nodiscard]] const char* Data(const uint16_t id) const
+    {
+        return m_memory.data() + id * m_bufferSize;
+    }
+
+    // Возвращает буфер ядру после того, как данные из него забраны
+    void Recycle(const uint16_t id)
+    {
+        Add(id);
+        Publish();
+    }
+
+    [[nodiscard]] uint16_t GroupId() const noexcept
+    {
+        return m_groupId;
+    }
+
+private:
+    ProvidedBuffers(const uint16_t groupId, const unsigned count, const size_t bufferSize)
+        : m_groupId(groupId)
+        , m_mask(count - 1)
+        , m_bufferSize(bufferSize)
+        , m_memory(count * bufferSize)
+    {
+        // Кольцо должно быть выровнено по странице; count — степень двойки
+        m_ring = static_cast<io_uring_buf_ring*>(std::aligned_alloc(4096, std::max<size_t>(4096, count * sizeof(io_uring_buf))));
+        if (!m_ring)
+        {
+            throw std::bad_alloc();
+        }
+        std::memset(m_ring, 0, count * sizeof(io_uring_buf));
+    }
+
+    void Add(const uint16_t id)
+    {
+        // Не m_ring->bufs: в C++ макрос __DECLARE_FLEX_ARRAY сдвигает массив на 8 байт, а ядро ждёт его с начала кольца
+        io_uring_buf& buf = reinterpret_cast<io_uring_buf*>(m_ring)[m_tail & m_mask];
+        buf.addr = reinterpret_cast<uint64_t>(m_memory.data() + id * m_bufferSize);
+        buf.len = static_cast<uint32_t>(m_bufferSize);
+        buf.bid = id;
+        ++m_tail;
+    }
+
+    void Publish()
+    {
+        StoreRelease(&m_ring->tail, m_tail);
+    }
+
+    uint16_t m_groupId;
+    uint16_t m_mask;
+    uint16_t m_tail = 0;
+    size_t m_bufferSize;
+    std::vector<char> m_memory;
+    io_uring_buf_ring* m_ring = nullptr;
+};
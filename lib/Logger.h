@@ -0,0 +1,269 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+enum class LogLevel
+{
+    Debug,
+    Info,
+    Warning,
+    Error,
+    Off,
+};
+
+// Сообщения ниже этого уровня вырезаются при компиляции вместе с вычислением их аргументов:
+// -DLOG_MIN_LEVEL=0 включает отладочные, -DLOG_MIN_LEVEL=4 выключает журнал целиком
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 1
+#endif
+
+// Ограничение частоты для одного места вызова: не больше limit сообщений в секунду.
+// Лишние отбрасываются, а их число дописывается к следующему пропущенному сообщению
+class LogRateLimiter
+{
+public:
+    explicit LogRateLimiter(const uint32_t limit)
+            : m_limit(limit)
+    {
+    }
+
+    bool Allow(uint64_t& suppressed)
+    {
+        const auto second = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        uint64_t window = m_window.load(std::memory_order_relaxed);
+        if (window != second && m_window.compare_exchange_strong(window, second, std::memory_order_relaxed))
+        {
+            m_count.store(0, std::memory_order_relaxed);
+        }
+        if (m_count.fetch_add(1, std::memory_order_relaxed) >= m_limit)
+        {
+            m_suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        suppressed = m_suppressed.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+
+private:
+    const uint32_t m_limit;
+    std::atomic<uint64_t> m_window{ 0 };
+    std::atomic<uint32_t> m_count{ 0 };
+    std::atomic<uint64_t> m_suppressed{ 0 };
+};
+
+// Общий асинхронный журнал. Потоки кладут сообщения в кольцевой буфер без блокировок
+// (ограниченная MPSC-очередь Вьюкова), а фоновый поток выводит их пачками: один write и один flush на пачку.
+// Переполненный буфер не задерживает вызывающего — сообщение отбрасывается и учитывается в счётчике потерь
+class Logger
+{
+public:
+    static constexpr size_t Capacity = 4096;
+    // Длинные сообщения обрезаются до размера ячейки
+    static constexpr size_t MaxMessageSize = 480;
+    static constexpr uint32_t DefaultRateLimit = 10000;
+
+    static constexpr bool IsEnabled(const LogLevel level)
+    {
+        return level != LogLevel::Off && static_cast<int>(level) >= LOG_MIN_LEVEL;
+    }
+
+    static Logger& Instance()
+    {
+        static Logger logger;
+        return logger;
+    }
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    ~Logger()
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wakeup.notify_one();
+        m_thread.join();
+    }
+
+    void Write(const LogLevel level, const std::string_view tag, const std::string_view message,
+            const uint64_t suppressed = 0)
+    {
+        uint64_t pos = m_tail.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true)
+        {
+            slot = &m_slots[pos % Capacity];
+            const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<int64_t>(sequence - pos);
+            if (diff == 0)
+            {
+                if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            else
+            {
+                pos = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->level = level;
+        slot->suppressed = suppressed;
+        slot->tagSize = std::min(tag.size(), sizeof(slot->tag));
+        std::memcpy(slot->tag, tag.data(), slot->tagSize);
+        slot->size = std::min(message.size(), sizeof(slot->text));
+        std::memcpy(slot->text, message.data(), slot->size);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+
+        if (m_sleeping.load(std::memory_order_relaxed))
+        {
+            m_wakeup.notify_one();
+        }
+    }
+
+private:
+    // Сколько фоновый поток спит, если буфер пуст. Пробуждение от Write может потеряться — тогда он проснётся сам
+    static constexpr std::chrono::milliseconds IdleInterval{ 50 };
+
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence;
+        LogLevel level;
+        uint32_t tagSize;
+        uint32_t size;
+        uint64_t suppressed;
+        char tag[16];
+        char text[MaxMessageSize];
+    };
+
+    Logger()
+            : m_slots(std::make_unique<Slot[]>(Capacity))
+    {
+        for (size_t i = 0; i < Capacity; ++i)
+        {
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        m_thread = std::thread([this] { Work(); });
+    }
+
+    void Work()
+    {
+        std::string out;
+        std::string err;
+        while (true)
+        {
+            while (Drain(out, err))
+            {
+            }
+            Flush(out, stdout);
+            Flush(err, stderr);
+
+            std::unique_lock lock(m_mutex);
+            if (m_stopping)
+            {
+                lock.unlock();
+                Drain(out, err);
+                Flush(out, stdout);
+                Flush(err, stderr);
+                return;
+            }
+            m_sleeping.store(true, std::memory_order_relaxed);
+            m_wakeup.wait_for(lock, IdleInterval);
+            m_sleeping.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    // Забирает все готовые сообщения; false, если буфер был пуст
+    bool Drain(std::string& out, std::string& err)
+    {
+        bool any = false;
+        while (true)
+        {
+            Slot& slot = m_slots[m_head % Capacity];
+            if (slot.sequence.load(std::memory_order_acquire) != m_head + 1)
+            {
+                break;
+            }
+            std::string& target = slot.level >= LogLevel::Warning ? err : out;
+            if (slot.tagSize > 0)
+            {
+                target += '[';
+                target.append(slot.tag, slot.tagSize);
+                target += "] ";
+            }
+            target.append(slot.text, slot.size);
+            if (slot.suppressed > 0)
+            {
+                target += " (" + std::to_string(slot.suppressed) + " similar messages suppressed)";
+            }
+            target += '\n';
+            slot.sequence.store(m_head + Capacity, std::memory_order_release);
+            ++m_head;
+            any = true;
+        }
+        if (const uint64_t dropped = m_dropped.exchange(0, std::memory_order_relaxed); dropped > 0)
+        {
+            err += "[Logger] " + std::to_string(dropped) + " messages dropped: buffer full\n";
+        }
+        return any;
+    }
+
+    static void Flush(std::string& batch, std::FILE* stream)
+    {
+        if (batch.empty())
+        {
+            return;
+        }
+        std::fwrite(batch.data(), 1, batch.size(), stream);
+        std::fflush(stream);
+        batch.clear();
+    }
+
+    std::unique_ptr<Slot[]> m_slots;
+    alignas(64) std::atomic<uint64_t> m_tail{ 0 };
+    alignas(64) uint64_t m_head = 0;
+    std::atomic<uint64_t> m_dropped{ 0 };
+    std::atomic<bool> m_sleeping{ false };
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    bool m_stopping = false;
+    std::thread m_thread;
+};
+
+// Аргументы отключённого уровня не вычисляются, а сам вызов исчезает при компиляции
+#define LOG_AT(level, tag, message)                                                          \
+    do                                                                                       \
+    {                                                                                        \
+        if constexpr (Logger::IsEnabled(level))                                              \
+        {                                                                                    \
+            static LogRateLimiter logRateLimiter_{ Logger::DefaultRateLimit };               \
+            uint64_t logSuppressed_ = 0;                                                     \
+            if (logRateLimiter_.Allow(logSuppressed_))                                       \
+            {                                                                                \
+                Logger::Instance().Write(level, tag, message, logSuppressed_);               \
+            }                                                                                \
+        }                                                                                    \
+    } while (false)
+
+#define LOG_DEBUG(tag, message) LOG_AT(LogLevel::Debug, tag, message)
+#define LOG_INFO(tag, message) LOG_AT(LogLevel::Info, tag, message)
+#define LOG_WARNING(tag, message) LOG_AT(LogLevel::Warning, tag, message)
+#define LOG_ERROR(tag, message) LOG_AT(LogLevel::Error, tag, message)
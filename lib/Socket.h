@@ -1,6 +1,11 @@
 #pragma once
 #include "FileDesc.h"
+#include "Logger.h"
+#include <sys/sendfile.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <linux/errqueue.h>
+#include <optional>
 #include <string>
 
 class Socket
@@ -9,7 +14,7 @@ public:
 	explicit Socket(FileDesc fd)
 		: m_fd{ std::move(fd) }
 	{
-        std::cout << "Socket created" << std::endl;
+		LOG_DEBUG("Socket", "Socket created");
 	}
 
 	size_t Read(void* buffer, const size_t length)
@@ -19,21 +24,231 @@ public:
 		return bytesRead;
 	}
 
+	// Отправляет всё: короткие записи дописываются, прерывание сигналом повторяется
 	size_t Send(const void* buffer, const size_t len, const int flags)
 	{
-		const auto result = send(m_fd.Get(), buffer, len, flags);
+		size_t total = 0;
+		while (total < len)
+		{
+			const auto result = send(m_fd.Get(), static_cast<const char*>(buffer) + total, len - total, flags);
+			if (result == -1)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				throw std::system_error(errno, std::generic_category());
+			}
+			total += static_cast<size_t>(result);
+		}
+
+		return total;
+	}
+
+	// Несколько буферов одним sendmsg, например заголовок и тело ответа. Отправляет всё;
+	// после короткой записи продолжает с места остановки, поэтому массив iov изменяется
+	void SendV(iovec* iov, size_t count)
+	{
+		while (count > 0)
+		{
+			msghdr msg{};
+			msg.msg_iov = iov;
+			msg.msg_iovlen = count;
+			const auto result = sendmsg(m_fd.Get(), &msg, MSG_NOSIGNAL);
+			if (result == -1)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				throw std::system_error(errno, std::generic_category());
+			}
+			auto sent = static_cast<size_t>(result);
+			while (count > 0 && sent >= iov->iov_len)
+			{
+				sent -= iov->iov_len;
+				++iov;
+				--count;
+			}
+			if (count > 0)
+			{
+				iov->iov_base = static_cast<char*>(iov->iov_base) + sent;
+				iov->iov_len -= sent;
+			}
+		}
+	}
+
+	// Неблокирующие варианты: std::nullopt означает EAGAIN
+	std::optional<size_t> TryRead(void* buffer, const size_t length)
+	{
+		const auto result = recv(m_fd.Get(), buffer, length, 0);
+		if (result == -1)
+		{
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			{
+				return std::nullopt;
+			}
+			throw std::system_error(errno, std::generic_category());
+		}
+		return static_cast<size_t>(result);
+	}
+
+	std::optional<size_t> TrySend(const void* buffer, const size_t len)
+	{
+		const auto result = send(m_fd.Get(), buffer, len, MSG_NOSIGNAL);
+		if (result == -1)
+		{
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			{
+				return std::nullopt;
+			}
+			throw std::system_error(errno, std::generic_category());
+		}
+		return static_cast<size_t>(result);
+	}
+
+	// Несколько буферов одним системным вызовом (аналог writev, но с MSG_NOSIGNAL).
+	// Может отправить только часть данных; std::nullopt означает EAGAIN
+	std::optional<size_t> TrySendV(const iovec* iov, const size_t count)
+	{
+		msghdr msg{};
+		msg.msg_iov = const_cast<iovec*>(iov);
+		msg.msg_iovlen = count;
+		const auto result = sendmsg(m_fd.Get(), &msg, MSG_NOSIGNAL);
 		if (result == -1)
 		{
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			{
+				return std::nullopt;
+			}
 			throw std::system_error(errno, std::generic_category());
 		}
+		return static_cast<size_t>(result);
+	}
+
+	// Отправка файла без копирования через пользовательское пространство
+	// https://man7.org/linux/man-pages/man2/sendfile.2.html
+	void SendFile(const int fileFd, off_t offset, size_t count)
+	{
+		while (count > 0)
+		{
+			const auto sent = sendfile(m_fd.Get(), fileFd, &offset, count);
+			if (sent == -1)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				throw std::system_error(errno, std::generic_category());
+			}
+			if (sent == 0)
+			{
+				break;
+			}
+			count -= static_cast<size_t>(sent);
+		}
+	}
 
-		return result;
+	// Неблокирующий вариант: сдвигает offset на число отправленных байт, std::nullopt означает EAGAIN
+	std::optional<size_t> TrySendFile(const int fileFd, off_t& offset, const size_t count)
+	{
+		const auto sent = sendfile(m_fd.Get(), fileFd, &offset, count);
+		if (sent == -1)
+		{
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			{
+				return std::nullopt;
+			}
+			throw std::system_error(errno, std::generic_category());
+		}
+		return static_cast<size_t>(sent);
+	}
+
+	// После включения отправки с MSG_ZEROCOPY ядро не копирует буфер, а закрепляет его страницы.
+	// Буфер нельзя изменять, пока ReapZeroCopy() не сообщит о завершении отправки
+	// https://docs.kernel.org/networking/msg_zerocopy.html
+	bool EnableZeroCopy()
+	{
+		const int enable = 1;
+		return setsockopt(m_fd.Get(), SOL_SOCKET, SO_ZEROCOPY, &enable, sizeof(enable)) == 0;
+	}
+
+	// TrySend с MSG_ZEROCOPY. Если ядру не хватает памяти для закрепления страниц (ENOBUFS),
+	// отправляет обычной копией; zeroCopied сообщает, каким способом ушли данные
+	std::optional<size_t> TrySendZeroCopy(const void* buffer, const size_t len, bool& zeroCopied)
+	{
+		const auto result = send(m_fd.Get(), buffer, len, MSG_ZEROCOPY | MSG_NOSIGNAL);
+		if (result == -1 && errno == ENOBUFS)
+		{
+			zeroCopied = false;
+			return TrySend(buffer, len);
+		}
+		if (result == -1)
+		{
+			zeroCopied = false;
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			{
+				return std::nullopt;
+			}
+			throw std::system_error(errno, std::generic_category());
+		}
+		zeroCopied = true;
+		return static_cast<size_t>(result);
+	}
+
+	// Ошибка сокета из SO_ERROR (0 — ошибки нет)
+	[[nodiscard]] int GetError() const
+	{
+		int error = 0;
+		socklen_t len = sizeof(error);
+		if (getsockopt(m_fd.Get(), SOL_SOCKET, SO_ERROR, &error, &len) == -1)
+		{
+			return errno;
+		}
+		return error;
+	}
+
+	// Забирает уведомления о завершённых zerocopy-отправках из очереди ошибок сокета.
+	// Возвращает число завершённых вызовов send
+	size_t ReapZeroCopy()
+	{
+		size_t completed = 0;
+		while (true)
+		{
+			char control[CMSG_SPACE(sizeof(sock_extended_err))];
+			msghdr msg{};
+			msg.msg_control = control;
+			msg.msg_controllen = sizeof(control);
+			if (recvmsg(m_fd.Get(), &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1)
+			{
+				return completed;
+			}
+			for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm))
+			{
+				const auto* err = reinterpret_cast<const sock_extended_err*>(CMSG_DATA(cm));
+				if (err->ee_origin == SO_EE_ORIGIN_ZEROCOPY && err->ee_errno == 0)
+				{
+					// Диапазон [ee_info, ee_data] — номера завершённых вызовов send
+					completed += err->ee_data - err->ee_info + 1;
+				}
+			}
+		}
+	}
+
+	void SetNonBlocking()
+	{
+		m_fd.SetNonBlocking();
+	}
+
+	[[nodiscard]] int Get() const noexcept
+	{
+		return m_fd.Get();
 	}
 
 private:
     static void Log(std::string const& prefix, const void* buffer, const size_t length)
     {
-        std::cout << prefix << std::string((char*)buffer, length) << std::endl;
+        LOG_DEBUG("Socket", prefix + std::string(static_cast<const char*>(buffer), length));
     }
 
 private:
@@ -1,11 +1,13 @@
 #pragma once
 #include "FileDesc.h"
+#include "Logger.h"
 #include <sys/socket.h>
 #include <arpa/inet.h>
+#include <optional>
 #include <string>
 #include <stdexcept>
-#include <iostream>
 #include <cstring>
+#include <vector>
 
 class UdpSocket
 {
@@ -30,7 +32,7 @@ public:
         {
             throw std::system_error(errno, std::generic_category());
         }
-        std::cout << "UDP Socket bound to port " << port << std::endl;
+        LOG_INFO("UDP", "UDP Socket bound to port " + std::to_string(port));
     }
 
     void SetRecvTimeout(int seconds)
@@ -54,6 +56,36 @@ public:
         }
     }
 
+    // Пачка датаграмм одному адресату одним вызовом sendmmsg; ядро может принять не все, тогда остаток досылается
+    // https://man7.org/linux/man-pages/man2/sendmmsg.2.html
+    void SendMany(const std::vector<std::string>& messages, const sockaddr_in& destAddr)
+    {
+        std::vector<iovec> iov(messages.size());
+        std::vector<mmsghdr> headers(messages.size());
+        for (size_t i = 0; i < messages.size(); ++i)
+        {
+            iov[i] = { const_cast<char*>(messages[i].data()), messages[i].size() };
+            headers[i].msg_hdr.msg_iov = &iov[i];
+            headers[i].msg_hdr.msg_iovlen = 1;
+            headers[i].msg_hdr.msg_name = const_cast<sockaddr_in*>(&destAddr);
+            headers[i].msg_hdr.msg_namelen = sizeof(destAddr);
+        }
+        size_t sent = 0;
+        while (sent < headers.size())
+        {
+            const int result = sendmmsg(m_fd.Get(), headers.data() + sent, static_cast<unsigned>(headers.size() - sent), 0);
+            if (result < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                throw std::system_error(errno, std::generic_category());
+            }
+            sent += static_cast<size_t>(result);
+        }
+    }
+
     std::string RecvFrom(sockaddr_in& srcAddr)
     {
         char buffer[1024];
@@ -75,6 +107,35 @@ public:
         return std::string(buffer);
     }
 
+    // Неблокирующий вариант: std::nullopt, когда датаграмм в очереди нет
+    std::optional<std::string> TryRecvFrom(sockaddr_in& srcAddr)
+    {
+        char buffer[1024];
+        socklen_t addrLen = sizeof(srcAddr);
+
+        const ssize_t len = recvfrom(m_fd.Get(), buffer, sizeof(buffer), MSG_DONTWAIT,
+                                     reinterpret_cast<sockaddr*>(&srcAddr), &addrLen);
+        if (len < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            {
+                return std::nullopt;
+            }
+            throw std::system_error(errno, std::generic_category());
+        }
+        return std::string(buffer, static_cast<size_t>(len));
+    }
+
+    void SetNonBlocking()
+    {
+        m_fd.SetNonBlocking();
+    }
+
+    [[nodiscard]] int Get() const noexcept
+    {
+        return m_fd.Get();
+    }
+
 private:
     FileDesc m_fd;
 };
\ No newline at end of file
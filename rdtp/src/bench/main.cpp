@@ -0,0 +1,124 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../common/Checksum.h"
+#include "../common/Packet.h"
+
+// Сравнение ядер контрольной суммы на пакетах максимального размера. Перед замером каждое ядро
+// сверяется с прямолинейной реализацией RFC 1071 на всех длинах и смещениях
+
+namespace {
+
+constexpr size_t PACKET_SIZE = HEADER_SIZE + MAX_PAYLOAD_SIZE;
+
+// Прежняя реализация: побайтовая сумма с переносом на каждом байте. Считает другое значение,
+// здесь — только как точка отсчёта по скорости
+uint32_t ByteSumChecksum(const uint8_t* data, size_t size) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < size; ++i) {
+        sum += data[i];
+        if (sum & 0xFFFF0000) {
+            sum &= 0xFFFF;
+            sum++;
+        }
+    }
+    return sum;
+}
+
+// RFC 1071 дословно: 16-битные слова в сетевом порядке
+uint16_t ReferenceChecksum(const uint8_t* data, size_t size) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i + 1 < size; i += 2) {
+        sum += (data[i] << 8) | data[i + 1];
+    }
+    if (size % 2) sum += data[size - 1] << 8;
+    while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+    return static_cast<uint16_t>(~sum);
+}
+
+struct Kernel {
+    std::string name;
+    ChecksumKernel function;
+};
+
+std::vector<Kernel> AvailableKernels() {
+    std::vector<Kernel> kernels{{"scalar64", ChecksumScalar}};
+#ifdef RDT_CHECKSUM_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) kernels.push_back({"sse2", ChecksumSse2});
+    if (__builtin_cpu_supports("avx2")) kernels.push_back({"avx2", ChecksumAvx2});
+#endif
+    return kernels;
+}
+
+bool Verify(const std::vector<Kernel>& kernels, const std::vector<uint8_t>& data) {
+    for (const auto& kernel : kernels) {
+        for (size_t offset = 0; offset < 8; ++offset) {
+            for (size_t size = 0; offset + size <= data.size(); ++size) {
+                const uint8_t* p = data.data() + offset;
+                if (FinishChecksum(FoldChecksum(kernel.function(p, size))) != ReferenceChecksum(p, size)) {
+                    std::cerr << kernel.name << ": mismatch at offset " << offset << ", size " << size << std::endl;
+                    return false;
+                }
+            }
+        }
+    }
+
+    // Заголовок меняется, payload — нет: пересчёт по RFC 1624 совпадает с полным
+    std::vector<uint8_t> packet(data.begin(), data.begin() + PACKET_SIZE);
+    const uint16_t before = ReferenceChecksum(packet.data(), packet.size());
+    const uint16_t oldWord = static_cast<uint16_t>((packet[2] << 8) | packet[3]);
+    const uint16_t newWord = static_cast<uint16_t>(oldWord + 1);
+    packet[2] = static_cast<uint8_t>(newWord >> 8);
+    packet[3] = static_cast<uint8_t>(newWord);
+    if (UpdateChecksum(before, oldWord, newWord) != ReferenceChecksum(packet.data(), packet.size())) {
+        std::cerr << "incremental update mismatch" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+template <typename F>
+void Measure(const std::string& name, size_t iterations, const std::vector<uint8_t>& data, F&& checksum) {
+    const size_t packets = data.size() / PACKET_SIZE;
+    volatile uint32_t sink = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        sink = sink + checksum(data.data() + (i % packets) * PACKET_SIZE, PACKET_SIZE);
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << seconds * 1e9 / iterations << " ns/packet"
+              << std::setw(10) << std::setprecision(2) << iterations * PACKET_SIZE / seconds / 1e9 << " GB/s"
+              << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    const size_t iterations = argc > 1 ? std::stoul(argv[1]) : 2'000'000;
+
+    // Несколько сотен пакетов: данные лежат в кэше, замеряется само ядро
+    std::vector<uint8_t> data(256 * PACKET_SIZE);
+    std::mt19937 random(42);
+    for (auto& byte : data) byte = static_cast<uint8_t>(random());
+
+    const auto kernels = AvailableKernels();
+    std::vector<uint8_t> sample(data.begin(), data.begin() + 2 * PACKET_SIZE);
+    if (!Verify(kernels, sample)) return 1;
+
+    std::cout << iterations << " packets of " << PACKET_SIZE << " bytes" << std::endl;
+    Measure("bytesum", iterations, data, ByteSumChecksum);
+    for (const auto& kernel : kernels) {
+        Measure(kernel.name, iterations, data, [&kernel](const uint8_t* p, size_t size) {
+            return FoldChecksum(kernel.function(p, size));
+        });
+    }
+    Measure("dispatch", iterations, data, [](const uint8_t* p, size_t size) {
+        return AddToChecksum(0, p, size);
+    });
+    return 0;
+}
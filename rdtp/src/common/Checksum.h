@@ -0,0 +1,113 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <arpa/inet.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RDT_CHECKSUM_X86 1
+#endif
+
+// Internet Checksum (RFC 1071): дополнение до единицы суммы 16-битных слов в дополнительном коде.
+// Сумма не зависит от порядка байт, если слова читать в порядке машины и так же записать результат,
+// поэтому ядра суммируют данные кусками по 8, 16 и 32 байта без перестановки байт.
+// Ядро возвращает частичную сумму в 64 битах: переносы накапливаются в старших разрядах и сворачиваются в конце
+
+// Сумма 64-битного слова с циклическим переносом
+inline uint64_t AddWithCarry(uint64_t sum, uint64_t value) {
+    sum += value;
+    return sum + (sum < value);
+}
+
+// Частичная сумма, свёрнутая до 16 бит (порядок байт машины)
+inline uint32_t FoldChecksum(uint64_t sum) {
+    sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+    sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    return static_cast<uint32_t>((sum & 0xFFFF) + (sum >> 16));
+}
+
+// Хвост короче 8 байт. Нечётный последний байт — старшая половина слова в сетевом порядке, как в RFC 1071
+inline uint64_t ChecksumTail(uint64_t sum, const uint8_t* data, size_t size) {
+    uint64_t word = 0;
+    std::memcpy(&word, data, size);
+    return AddWithCarry(sum, word);
+}
+
+inline uint64_t ChecksumScalar(const uint8_t* data, size_t size) {
+    uint64_t sum = 0;
+    for (; size >= 8; data += 8, size -= 8) {
+        uint64_t word;
+        std::memcpy(&word, data, 8);
+        sum = AddWithCarry(sum, word);
+    }
+    return ChecksumTail(sum, data, size);
+}
+
+#ifdef RDT_CHECKSUM_X86
+// Векторные ядра раскладывают 32-битные слова по 64-битным дорожкам: переполнение дорожки
+// невозможно раньше 2^32 сложений, так что переносы в цикле не обрабатываются
+__attribute__((target("sse2"))) inline uint64_t ChecksumSse2(const uint8_t* data, size_t size) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = _mm_setzero_si128();
+    for (; size >= 16; data += 16, size -= 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(v, zero));
+        acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(v, zero));
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    return AddWithCarry(AddWithCarry(ChecksumScalar(data, size), lanes[0]), lanes[1]);
+}
+
+__attribute__((target("avx2"))) inline uint64_t ChecksumAvx2(const uint8_t* data, size_t size) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc = _mm256_setzero_si256();
+    for (; size >= 32; data += 32, size -= 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+        acc = _mm256_add_epi64(acc, _mm256_unpacklo_epi32(v, zero));
+        acc = _mm256_add_epi64(acc, _mm256_unpackhi_epi32(v, zero));
+    }
+    uint64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    uint64_t sum = ChecksumScalar(data, size);
+    for (uint64_t lane : lanes) {
+        sum = AddWithCarry(sum, lane);
+    }
+    return sum;
+}
+#endif
+
+using ChecksumKernel = uint64_t (*)(const uint8_t*, size_t);
+
+// Лучшее ядро для процессора выбирается один раз, при первом вызове
+inline ChecksumKernel SelectChecksumKernel() {
+#ifdef RDT_CHECKSUM_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return ChecksumAvx2;
+    if (__builtin_cpu_supports("sse2")) return ChecksumSse2;
+#endif
+    return ChecksumScalar;
+}
+
+// Сумма продолжается с sum: так поле контрольной суммы пропускается, а заголовок и payload,
+// лежащие в разных буферах, суммируются без склейки. Все куски, кроме последнего, должны быть чётной длины
+inline uint32_t AddToChecksum(uint32_t sum, const uint8_t* data, size_t size) {
+    static const ChecksumKernel kernel = SelectChecksumKernel();
+    return FoldChecksum(AddWithCarry(sum, kernel(data, size)));
+}
+
+// Значение поля Checksum в порядке хоста: записывается через htons, как остальные поля заголовка
+inline uint16_t FinishChecksum(uint32_t sum) {
+    return ntohs(static_cast<uint16_t>(~sum));
+}
+
+// Пересчёт после замены 16-битного слова заголовка без повторного суммирования payload (RFC 1624, eqn. 3):
+// HC' = ~(~HC + ~m + m'). Контрольная сумма и слова — в порядке хоста
+inline uint16_t UpdateChecksum(uint16_t checksum, uint16_t oldWord, uint16_t newWord) {
+    uint32_t sum = static_cast<uint16_t>(~checksum) + static_cast<uint16_t>(~oldWord) + newWord;
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    return static_cast<uint16_t>(~sum);
+}
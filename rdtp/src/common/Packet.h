@@ -1,95 +1,165 @@
 #pragma once
+#include "Checksum.h"
+#include "../../../lib/BufferPool.h"
+#include <algorithm>
+#include <array>
 #include <cstdint>
-#include <vector>
 #include <cstring>
-#include <numeric>
+#include <span>
 #include <arpa/inet.h>
 
 constexpr uint16_t MAGIC_NUMBER = 0xC0DE;
 constexpr size_t MAX_PAYLOAD_SIZE = 1400;
 constexpr size_t HEADER_SIZE = 12;
+// За заголовком ACK могут идти окно получателя (флаг WINDOW) и SACK-блоки, их число — в бывшем поле Reserved
+constexpr size_t WINDOW_SIZE = 4;
+constexpr size_t MAX_SACK_BLOCKS = 4;
+constexpr size_t SACK_BLOCK_SIZE = 8;
+// Заголовок вместе с самыми длинными опциями
+constexpr size_t MAX_HEADER_SIZE = HEADER_SIZE + WINDOW_SIZE + MAX_SACK_BLOCKS * SACK_BLOCK_SIZE;
+// Смещение поля Checksum в заголовке
+constexpr size_t CHECKSUM_OFFSET = 8;
 
 enum class PacketType : uint8_t {
     SYN = 0x01,
     ACK = 0x02,
     FIN = 0x04,
-    DATA = 0x08
+    DATA = 0x08,
+    // В SYN: отправитель работает в режиме Selective Repeat и ждёт SACK в подтверждениях
+    SACK = 0x10,
+    // За заголовком — окно получателя: сколько пакетов сверх кумулятивного ACK он готов принять
+    WINDOW = 0x20
+};
+
+// Диапазон номеров [first, last], принятых получателем сверх кумулятивного ACK
+struct SackBlock {
+    uint32_t first;
+    uint32_t last;
 };
 
 struct Header {
     uint32_t seqNum;
     uint8_t flags;
-    uint8_t reserved{0};
+    uint8_t sackCount{0};
     uint16_t dataLen;
     uint16_t checksum;
     uint16_t magic;
 };
 
+// Размер окна и SACK-блоков между заголовком и payload
+inline size_t OptionsSize(uint8_t flags, uint8_t sackCount) {
+    const size_t windowSize = flags & static_cast<uint8_t>(PacketType::WINDOW) ? WINDOW_SIZE : 0;
+    return windowSize + sackCount * SACK_BLOCK_SIZE;
+}
+
+// Исходящий пакет. Payload не копируется: сокет отправляет заголовок и payload двумя iovec,
+// и данные попадают в ядро прямо из источника, например из отображения файла
 struct Packet {
     Header header{};
-    std::vector<uint8_t> payload;
-
-    static uint16_t CalculateChecksum(const std::vector<uint8_t>& data) {
-        uint32_t sum = 0;
-        for (size_t i = 0; i < data.size(); ++i) {
-            sum += data[i];
-            if (sum & 0xFFFF0000) {
-                sum &= 0xFFFF;
-                sum++;
-            }
-        }
-        return static_cast<uint16_t>(~(sum & 0xFFFF));
-    }
+    uint32_t window = 0;
+    std::array<SackBlock, MAX_SACK_BLOCKS> sack{};
+    std::span<const uint8_t> payload;
 
-    std::vector<uint8_t> Serialize() {
+    // Пишет в out (не меньше MAX_HEADER_SIZE байт) заголовок с опциями и контрольной суммой
+    // по ним и по payload. Возвращает число записанных байт
+    size_t SerializeHeader(uint8_t* out) {
         header.dataLen = static_cast<uint16_t>(payload.size());
         header.magic = MAGIC_NUMBER;
         header.checksum = 0;
+        // Больше блоков не помещается ни в sack, ни в буфер out
+        header.sackCount = std::min<uint8_t>(header.sackCount, MAX_SACK_BLOCKS);
 
-        std::vector<uint8_t> buffer(HEADER_SIZE + payload.size());
+        const size_t windowSize = header.flags & static_cast<uint8_t>(PacketType::WINDOW) ? WINDOW_SIZE : 0;
+        const size_t size = HEADER_SIZE + OptionsSize(header.flags, header.sackCount);
 
         Header netHeader = header;
         netHeader.seqNum = htonl(header.seqNum);
         netHeader.dataLen = htons(header.dataLen);
         netHeader.magic = htons(header.magic);
 
-        std::memcpy(buffer.data(), &netHeader, HEADER_SIZE);
-        std::memcpy(buffer.data() + HEADER_SIZE, payload.data(), payload.size());
+        std::memcpy(out, &netHeader, HEADER_SIZE);
+        if (windowSize) {
+            const uint32_t netWindow = htonl(window);
+            std::memcpy(out + HEADER_SIZE, &netWindow, WINDOW_SIZE);
+        }
+        for (size_t i = 0; i < header.sackCount; ++i) {
+            const uint32_t range[2] = {htonl(sack[i].first), htonl(sack[i].last)};
+            std::memcpy(out + HEADER_SIZE + windowSize + i * SACK_BLOCK_SIZE, range, SACK_BLOCK_SIZE);
+        }
 
-        header.checksum = CalculateChecksum(buffer);
+        header.checksum = FinishChecksum(AddToChecksum(AddToChecksum(0, out, size), payload.data(), payload.size()));
         netHeader.checksum = htons(header.checksum);
-        std::memcpy(buffer.data() + 8, &netHeader.checksum, 2); // offset 8 is checksum
-
-        return buffer;
+        std::memcpy(out + CHECKSUM_OFFSET, &netHeader.checksum, 2);
+        return size;
     }
+};
 
-    static bool Deserialize(const std::vector<uint8_t>& buffer, Packet& outPacket) {
-        if (buffer.size() < HEADER_SIZE) return false;
+// Принятый пакет. Поля читаются прямо из буфера датаграммы, payload — срез того же блока пула
+class PacketView {
+public:
+    // Проверяет магическое число, длины и контрольную сумму; при ошибке out не меняется
+    static bool Parse(const BufferSlice& buffer, PacketView& out) {
+        if (buffer.Size() < HEADER_SIZE) return false;
+        const uint8_t* data = buffer.Data();
+
+        if (ReadU16(data + 10) != MAGIC_NUMBER) return false;
+        const uint8_t flags = data[4];
+        const uint8_t sackCount = data[5];
+        if (sackCount > MAX_SACK_BLOCKS) return false;
+        const size_t headerSize = HEADER_SIZE + OptionsSize(flags, sackCount);
+        const uint16_t dataLen = ReadU16(data + 6);
+        if (buffer.Size() < headerSize + dataLen) return false;
+
+        // Поле контрольной суммы считается нулевым: нули сумму не меняют, поэтому его просто пропускаем
+        uint32_t sum = AddToChecksum(0, data, CHECKSUM_OFFSET);
+        sum = AddToChecksum(sum, data + CHECKSUM_OFFSET + 2, buffer.Size() - CHECKSUM_OFFSET - 2);
+        if (FinishChecksum(sum) != ReadU16(data + CHECKSUM_OFFSET)) return false;
+
+        out.m_buffer = buffer.Sub(0, headerSize + dataLen);
+        out.m_headerSize = headerSize;
+        return true;
+    }
 
-        Header netHeader;
-        std::memcpy(&netHeader, buffer.data(), HEADER_SIZE);
+    uint32_t SeqNum() const {
+        return ReadU32(m_buffer.Data());
+    }
 
-        if (ntohs(netHeader.magic) != MAGIC_NUMBER) return false;
+    uint8_t Flags() const {
+        return m_buffer.Data()[4];
+    }
 
-        uint16_t receivedChecksum = ntohs(netHeader.checksum);
-        std::vector<uint8_t> checkBuf = buffer;
-        std::memset(checkBuf.data() + 8, 0, 2);
+    uint8_t SackCount() const {
+        return m_buffer.Data()[5];
+    }
 
-        if (CalculateChecksum(checkBuf) != receivedChecksum) return false;
+    // Окно получателя; 0, если флаг WINDOW не стоит
+    uint32_t Window() const {
+        return Flags() & static_cast<uint8_t>(PacketType::WINDOW) ? ReadU32(m_buffer.Data() + HEADER_SIZE) : 0;
+    }
 
-        outPacket.header.seqNum = ntohl(netHeader.seqNum);
-        outPacket.header.flags = netHeader.flags;
-        outPacket.header.dataLen = ntohs(netHeader.dataLen);
-        outPacket.header.checksum = receivedChecksum;
-        outPacket.header.magic = ntohs(netHeader.magic);
+    SackBlock Sack(size_t i) const {
+        const size_t windowSize = Flags() & static_cast<uint8_t>(PacketType::WINDOW) ? WINDOW_SIZE : 0;
+        const uint8_t* block = m_buffer.Data() + HEADER_SIZE + windowSize + i * SACK_BLOCK_SIZE;
+        return {ReadU32(block), ReadU32(block + 4)};
+    }
 
-        if (buffer.size() < HEADER_SIZE + outPacket.header.dataLen) return false;
+    BufferSlice Payload() const {
+        return m_buffer.Sub(m_headerSize, m_buffer.Size() - m_headerSize);
+    }
 
-        outPacket.payload.assign(
-                buffer.begin() + HEADER_SIZE,
-                buffer.begin() + HEADER_SIZE + outPacket.header.dataLen
-        );
+private:
+    static uint16_t ReadU16(const uint8_t* data) {
+        uint16_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return ntohs(value);
+    }
 
-        return true;
+    static uint32_t ReadU32(const uint8_t* data) {
+        uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return ntohl(value);
     }
-};
\ No newline at end of file
+
+    BufferSlice m_buffer;
+    size_t m_headerSize = 0;
+};
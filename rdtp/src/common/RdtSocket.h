@@ -1,10 +1,24 @@
 #pragma once
+#include "../../../lib/AsyncSocket.h"
 #include "../../../lib/FileDesc.h"
 #include "Packet.h"
+#include <fcntl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <algorithm>
 #include <iostream>
+#include <memory>
+#include <vector>
+
+enum class RecvStatus {
+    Received,
+    // Истёк таймаут SO_RCVTIMEO или таймаут ожидания в цикле событий
+    Timeout,
+    // Пришло не то: битая контрольная сумма, чужая датаграмма или прерванный вызов. Это не таймаут
+    Invalid
+};
 
 class RdtSocket {
 public:
@@ -23,6 +37,12 @@ public:
         }
     }
 
+    // Приём через цикл событий: сокет становится неблокирующим, ждать датаграмм — через co_await RecvFrom
+    void Attach(EventLoop& loop) {
+        fcntl(m_fd.Get(), F_SETFL, fcntl(m_fd.Get(), F_GETFL) | O_NONBLOCK);
+        m_async = std::make_unique<AsyncFd>(loop, m_fd.Get());
+    }
+
     void SetTimeout(int ms) {
         struct timeval tv;
         tv.tv_sec = ms / 1000;
@@ -30,30 +50,93 @@ public:
         setsockopt(m_fd.Get(), SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
     }
 
+    // Ядро может урезать размер до net.core.rmem_max
+    void SetReceiveBuffer(int bytes) {
+        setsockopt(m_fd.Get(), SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes));
+    }
+
+    // Сколько полных пакетов поместится в буфер приёма сокета. Ядро учитывает датаграмму вместе со служебными
+    // структурами, поэтому на пакет закладывается вдвое больше его размера
+    uint32_t ReceiveBufferPackets() const {
+        int bytes = 0;
+        socklen_t len = sizeof(bytes);
+        if (getsockopt(m_fd.Get(), SOL_SOCKET, SO_RCVBUF, &bytes, &len) < 0) return 1;
+        return std::max<uint32_t>(1, bytes / (2 * (MAX_PAYLOAD_SIZE + HEADER_SIZE)));
+    }
+
     void SendTo(Packet& packet, const sockaddr_in& dest) {
-        auto data = packet.Serialize();
-        sendto(m_fd.Get(), data.data(), data.size(), 0, (struct sockaddr*)&dest, sizeof(dest));
+        uint8_t header[MAX_HEADER_SIZE];
+        iovec iov[2];
+        msghdr msg{};
+        FillMessage(packet, header, iov, dest, msg);
+        sendmsg(m_fd.Get(), &msg, 0);
     }
 
-    bool RecvFrom(Packet& packet, sockaddr_in* sender = nullptr) {
-        std::vector<uint8_t> buffer(MAX_PAYLOAD_SIZE + HEADER_SIZE);
+    // Всё окно одним sendmmsg вместо sendto на каждый пакет. Остаток, который ядро не взяло, досылается.
+    // Заголовки пишутся в буферы сокета, которые переиспользуются от окна к окну
+    void SendMany(std::vector<Packet>& packets, const sockaddr_in& dest) {
+        m_sendHeaders.resize(packets.size() * MAX_HEADER_SIZE);
+        m_sendIov.resize(packets.size() * 2);
+        m_sendMessages.assign(packets.size(), mmsghdr{});
+        for (size_t i = 0; i < packets.size(); ++i) {
+            FillMessage(packets[i], m_sendHeaders.data() + i * MAX_HEADER_SIZE, m_sendIov.data() + i * 2, dest,
+                        m_sendMessages[i].msg_hdr);
+        }
+        size_t sent = 0;
+        while (sent < m_sendMessages.size()) {
+            int result = sendmmsg(m_fd.Get(), m_sendMessages.data() + sent, m_sendMessages.size() - sent, 0);
+            if (result < 0) {
+                if (errno == EINTR) continue;
+                // Как и SendTo: потеря датаграммы — обычное дело для протокола, окно уйдёт повторно по таймауту
+                return;
+            }
+            sent += result;
+        }
+    }
+
+    RecvStatus RecvFrom(PacketView& packet, sockaddr_in* sender = nullptr) {
+        // Блок пула больше MAX_PAYLOAD_SIZE + MAX_HEADER_SIZE и переиспользуется, как только пакет отпущен
+        BufferSlice buffer = BufferPool::Local().Acquire();
         sockaddr_in tempSender{};
         socklen_t len = sizeof(tempSender);
 
-        ssize_t received = recvfrom(m_fd.Get(), buffer.data(), buffer.size(), 0, (struct sockaddr*)&tempSender, &len);
+        ssize_t received = recvfrom(m_fd.Get(), buffer.Data(), buffer.Size(), 0, (struct sockaddr*)&tempSender, &len);
 
         if (received < 0) {
-            return false;
+            return errno == EAGAIN || errno == EWOULDBLOCK ? RecvStatus::Timeout : RecvStatus::Invalid;
         }
 
-        buffer.resize(received);
-        if (Packet::Deserialize(buffer, packet)) {
-            if (sender) *sender = tempSender;
-            return true;
+        buffer.Resize(received);
+        if (!PacketView::Parse(buffer, packet)) return RecvStatus::Invalid;
+        if (sender) *sender = tempSender;
+        return RecvStatus::Received;
+    }
+
+    // Ожидание датаграммы без блокировки потока, только после Attach. Timeout — за timeout ничего не пришло
+    Async<RecvStatus> RecvFrom(PacketView& packet, sockaddr_in* sender, const AsyncTimeout timeout) {
+        while (true) {
+            const RecvStatus status = RecvFrom(packet, sender);
+            if (status != RecvStatus::Timeout) co_return status;
+            const bool readable = co_await m_async->Readable(timeout);
+            if (!readable) co_return RecvStatus::Timeout;
         }
-        return false;
     }
 
 private:
+    // Датаграмма из двух частей: заголовок в header, payload — прямо из памяти, на которую указывает пакет
+    static void FillMessage(Packet& packet, uint8_t* header, iovec* iov, const sockaddr_in& dest, msghdr& msg) {
+        iov[0] = {header, packet.SerializeHeader(header)};
+        iov[1] = {const_cast<uint8_t*>(packet.payload.data()), packet.payload.size()};
+        msg.msg_name = const_cast<sockaddr_in*>(&dest);
+        msg.msg_namelen = sizeof(dest);
+        msg.msg_iov = iov;
+        msg.msg_iovlen = packet.payload.empty() ? 1 : 2;
+    }
+
     FileDesc m_fd;
+    // Регистрация в цикле событий после Attach; снимается раньше, чем закрывается дескриптор
+    std::unique_ptr<AsyncFd> m_async;
+    std::vector<uint8_t> m_sendHeaders;
+    std::vector<iovec> m_sendIov;
+    std::vector<mmsghdr> m_sendMessages;
 };
\ No newline at end of file
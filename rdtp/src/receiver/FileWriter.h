@@ -0,0 +1,72 @@
+#pragma once
+#include "../../../lib/BufferPool.h"
+#include "../../../lib/FileDesc.h"
+#include <sys/uio.h>
+#include <algorithm>
+#include <string>
+#include <system_error>
+#include <vector>
+
+// Запись принятых данных пачками: payload пакетов не копируется, а держится в очереди как BufferSlice
+// и уходит в файл одним pwritev. В памяти — не больше одной пачки, сколько бы ни весил файл
+class FileWriter {
+public:
+    void Open(const std::string& path) {
+        m_pending.clear();
+        m_pendingBytes = 0;
+        m_offset = 0;
+        m_fd = FileDesc(open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+        if (!m_fd.IsOpen()) throw std::system_error(errno, std::generic_category(), "Cannot open file: " + path);
+    }
+
+    void Append(const BufferSlice& data) {
+        if (data.Empty()) return;
+        m_pending.push_back(data);
+        m_pendingBytes += data.Size();
+        if (m_pending.size() >= MAX_BATCH_PACKETS || m_pendingBytes >= MAX_BATCH_BYTES) {
+            Flush();
+        }
+    }
+
+    void Flush() {
+        std::vector<iovec> iov(m_pending.size());
+        for (size_t i = 0; i < m_pending.size(); ++i) {
+            iov[i] = {const_cast<uint8_t*>(m_pending[i].Data()), m_pending[i].Size()};
+        }
+        size_t first = 0;
+        while (first < iov.size()) {
+            const ssize_t written = pwritev(m_fd.Get(), iov.data() + first, static_cast<int>(iov.size() - first), m_offset);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                throw std::system_error(errno, std::generic_category(), "pwritev failed");
+            }
+            m_offset += written;
+            // Короткая запись: пропускаем записанные целиком буферы и сдвигаем начало недописанного
+            for (size_t left = static_cast<size_t>(written); left > 0;) {
+                const size_t step = std::min(left, iov[first].iov_len);
+                iov[first].iov_base = static_cast<uint8_t*>(iov[first].iov_base) + step;
+                iov[first].iov_len -= step;
+                left -= step;
+                if (iov[first].iov_len == 0) first++;
+            }
+        }
+        m_pending.clear();
+        m_pendingBytes = 0;
+    }
+
+    void Close() {
+        if (!m_fd.IsOpen()) return;
+        Flush();
+        m_fd.Close();
+    }
+
+private:
+    // Пачка — около 256 КиБ: блоки возвращаются в пул после записи, а не копятся до конца передачи
+    static constexpr size_t MAX_BATCH_PACKETS = 192;
+    static constexpr size_t MAX_BATCH_BYTES = 256 * 1024;
+
+    FileDesc m_fd;
+    std::vector<BufferSlice> m_pending;
+    size_t m_pendingBytes = 0;
+    off_t m_offset = 0;
+};
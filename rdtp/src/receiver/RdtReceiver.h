@@ -0,0 +1,168 @@
+#pragma once
+#include "FileWriter.h"
+#include "../common/RdtSocket.h"
+#include "../../../lib/Logger.h"
+#include <algorithm>
+#include <map>
+
+// Трасса в режиме -d. Макрос, а не функция: без -d сообщение даже не собирается
+#define RECEIVER_LOG(message)                       \
+    do {                                            \
+        if (m_debug) LOG_INFO("RECEIVER", message); \
+    } while (false)
+
+// Получатель для обоих режимов. Режим выбирает отправитель флагом SACK в SYN:
+// без него — Go-Back-N (пакеты не по порядку отбрасываются), с ним — Selective Repeat с буфером переупорядочивания
+class RdtReceiver {
+public:
+    // Пакеты ждёт сопрограмма Run в цикле loop; цикл должен пережить получателя
+    RdtReceiver(EventLoop& loop, uint16_t port, const std::string& outfile, bool debug)
+            : m_port(port), m_outfile(outfile), m_debug(debug) {
+        m_socket.Attach(loop);
+    }
+
+    Async<void> Run() {
+        m_socket.Bind(m_port);
+        m_socket.SetReceiveBuffer(RECEIVE_BUFFER_BYTES);
+        LOG_INFO("", "Receiver started on port " + std::to_string(m_port) + ". Writing to " + m_outfile);
+
+        while (!m_finished) {
+            PacketView p;
+            sockaddr_in senderAddr;
+            const RecvStatus status = co_await m_socket.RecvFrom(p, &senderAddr, std::nullopt);
+            if (status == RecvStatus::Received) {
+                HandlePacket(p, senderAddr);
+            }
+        }
+    }
+
+private:
+    // Сколько пакетов вперёд от ожидаемого держит буфер переупорядочивания
+    static constexpr uint32_t MAX_REORDER_PACKETS = 1024;
+    // Больший буфер сокета — большее окно, которое можно объявить отправителю
+    static constexpr int RECEIVE_BUFFER_BYTES = 4 * 1024 * 1024;
+
+    uint16_t m_port;
+    std::string m_outfile;
+    bool m_debug;
+    RdtSocket m_socket;
+
+    uint32_t m_expectedSeq = 0;
+    bool m_handshakeDone = false;
+    bool m_finished = false;
+    bool m_selectiveRepeat = false;
+    FileWriter m_file;
+    // Принятые не по порядку пакеты (только в режиме Selective Repeat)
+    std::map<uint32_t, BufferSlice> m_reorder;
+
+    void SendAck(uint32_t seq, uint8_t flags, const sockaddr_in& dest) {
+        Packet ack;
+        ack.header.seqNum = seq;
+        ack.header.flags = static_cast<uint8_t>(PacketType::ACK) | static_cast<uint8_t>(PacketType::WINDOW) | flags;
+        ack.window = AdvertisedWindow();
+
+        m_socket.SendTo(ack, dest);
+        RECEIVER_LOG("Sent ACK #" + std::to_string(seq));
+    }
+
+    void HandlePacket(const PacketView& p, const sockaddr_in& sender) {
+        if (p.Flags() & static_cast<uint8_t>(PacketType::SYN)) {
+            m_selectiveRepeat = p.Flags() & static_cast<uint8_t>(PacketType::SACK);
+            RECEIVER_LOG(std::string("Received SYN, mode ") + (m_selectiveRepeat ? "Selective Repeat" : "Go-Back-N"));
+            m_expectedSeq = 1;
+            m_handshakeDone = true;
+            m_reorder.clear();
+            m_file.Open(m_outfile);
+            SendAck(0, static_cast<uint8_t>(PacketType::SYN), sender);
+            return;
+        }
+
+        if (p.Flags() & static_cast<uint8_t>(PacketType::FIN)) {
+            RECEIVER_LOG("Received FIN");
+            SendAck(p.SeqNum(), static_cast<uint8_t>(PacketType::FIN), sender);
+            m_file.Close();
+            m_finished = true;
+            return;
+        }
+
+        if (p.Flags() & static_cast<uint8_t>(PacketType::DATA)) {
+            RECEIVER_LOG("Received DATA #" + std::to_string(p.SeqNum()));
+
+            if (!m_handshakeDone) {
+                return;
+            }
+
+            if (m_selectiveRepeat) {
+                HandleSelectiveRepeat(p, sender);
+                return;
+            }
+
+            if (p.SeqNum() == m_expectedSeq) {
+                m_file.Append(p.Payload());
+                SendAck(m_expectedSeq, 0, sender);
+                m_expectedSeq++;
+            } else {
+                RECEIVER_LOG("Unexpected SeqNum: " + std::to_string(p.SeqNum()) + " Expected: " + std::to_string(m_expectedSeq));
+                if (m_expectedSeq > 0) {
+                    SendAck(m_expectedSeq - 1, 0, sender);
+                } else {
+                    SendAck(0, static_cast<uint8_t>(PacketType::SYN), sender);
+                }
+            }
+        }
+    }
+
+    // Пакет по порядку пишется сразу вместе со всеми, что за ним уже накоплены; пакет из будущего
+    // сохраняется в буфере. В ответ — кумулятивный ACK и SACK-блоки по содержимому буфера
+    void HandleSelectiveRepeat(const PacketView& p, const sockaddr_in& sender) {
+        const uint32_t seq = p.SeqNum();
+        if (seq == m_expectedSeq) {
+            m_file.Append(p.Payload());
+            m_expectedSeq++;
+            for (auto it = m_reorder.begin(); it != m_reorder.end() && it->first == m_expectedSeq;
+                 it = m_reorder.erase(it)) {
+                m_file.Append(it->second);
+                m_expectedSeq++;
+            }
+        } else if (seq > m_expectedSeq && seq - m_expectedSeq < MAX_REORDER_PACKETS) {
+            m_reorder.emplace(seq, p.Payload());
+        }
+
+        Packet ack;
+        ack.header.seqNum = m_expectedSeq - 1;
+        ack.header.flags = static_cast<uint8_t>(PacketType::ACK) | static_cast<uint8_t>(PacketType::WINDOW);
+        ack.window = AdvertisedWindow();
+        FillSack(ack, seq);
+        m_socket.SendTo(ack, sender);
+        RECEIVER_LOG("Sent ACK #" + std::to_string(ack.header.seqNum) + " with "
+            + std::to_string(ack.header.sackCount) + " SACK blocks");
+    }
+
+    // Сколько пакетов сверх кумулятивного ACK можно слать, не переполняя буфер сокета,
+    // а в режиме Selective Repeat — и буфер переупорядочивания
+    uint32_t AdvertisedWindow() const {
+        const uint32_t socketWindow = m_socket.ReceiveBufferPackets();
+        return m_selectiveRepeat ? std::min(socketWindow, MAX_REORDER_PACKETS) : socketWindow;
+    }
+
+    // Непрерывные диапазоны буфера. Как в TCP (RFC 2018), первым идёт блок с только что принятым пакетом,
+    // чтобы отправитель узнал о нём, даже если все блоки не помещаются
+    void FillSack(Packet& ack, uint32_t latest) {
+        std::vector<SackBlock> blocks;
+        for (const auto& [seq, payload] : m_reorder) {
+            if (!blocks.empty() && blocks.back().last + 1 == seq) {
+                blocks.back().last = seq;
+            } else {
+                blocks.push_back({seq, seq});
+            }
+        }
+        auto first = std::find_if(blocks.begin(), blocks.end(), [latest](const SackBlock& block) {
+            return block.first <= latest && latest <= block.last;
+        });
+        if (first != blocks.end()) {
+            std::rotate(blocks.begin(), first, first + 1);
+        }
+        ack.header.sackCount = static_cast<uint8_t>(std::min(blocks.size(), MAX_SACK_BLOCKS));
+        std::copy_n(blocks.begin(), ack.header.sackCount, ack.sack.begin());
+    }
+};
@@ -1,5 +1,5 @@
 #include <iostream>
-#include "GbnReceiver.h"
+#include "RdtReceiver.h"
 
 int main(int argc, char* argv[]) {
     if (argc < 3) {
@@ -12,8 +12,9 @@ int main(int argc, char* argv[]) {
     bool debug = (argc > 3 && std::string(argv[3]) == "-d");
 
     try {
-        GbnReceiver receiver(port, file, debug);
-        receiver.Run();
+        EventLoop loop;
+        RdtReceiver receiver(loop, port, file, debug);
+        RunSync(loop, receiver.Run());
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
         return 1;
@@ -0,0 +1,230 @@
+#pragma once
+#include "RttEstimator.h"
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+// Окно перегрузки отправителя в пакетах. Отправитель держит в полёте не больше min(Window(), окно получателя)
+class CongestionControl {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Начальное окно, как у TCP (RFC 6928)
+    static constexpr double INITIAL_WINDOW = 10;
+
+    virtual ~CongestionControl() = default;
+
+    // acked — сколько пакетов впервые подтверждено этим ACK
+    virtual void OnAck(uint32_t acked, const RttEstimator& rtt) = 0;
+    // Потеря замечена по повторным ACK или по SACK: передача продолжается, окно сокращается
+    virtual void OnLoss() = 0;
+    // Истёк таймер повтора
+    virtual void OnTimeout() = 0;
+
+    virtual uint32_t Window() const = 0;
+    virtual std::string Name() const = 0;
+};
+
+// Reno (RFC 5681): медленный старт до ssthresh, затем +1 пакет за RTT; при потере окно делится пополам,
+// при таймауте — медленный старт с одного пакета
+class RenoControl : public CongestionControl {
+public:
+    void OnAck(uint32_t acked, const RttEstimator&) override {
+        if (m_cwnd < m_ssthresh) {
+            m_cwnd += acked;
+        } else {
+            m_cwnd += acked / m_cwnd;
+        }
+    }
+
+    void OnLoss() override {
+        m_ssthresh = std::max(m_cwnd / 2, 2.0);
+        m_cwnd = m_ssthresh;
+    }
+
+    void OnTimeout() override {
+        m_ssthresh = std::max(m_cwnd / 2, 2.0);
+        m_cwnd = 1;
+    }
+
+    uint32_t Window() const override {
+        return std::max<uint32_t>(1, static_cast<uint32_t>(m_cwnd));
+    }
+
+    std::string Name() const override {
+        return "reno";
+    }
+
+private:
+    double m_cwnd = INITIAL_WINDOW;
+    double m_ssthresh = std::numeric_limits<double>::max();
+};
+
+// CUBIC (RFC 9438): после потери окно растёт по кубической кривой от времени, быстро возвращаясь к окну
+// перед потерей W_max и осторожно проходя его. На коротких RTT не отстаёт от Reno (TCP-friendly region)
+class CubicControl : public CongestionControl {
+public:
+    void OnAck(uint32_t acked, const RttEstimator& rtt) override {
+        if (m_cwnd < m_ssthresh) {
+            m_cwnd += acked;
+            return;
+        }
+        const auto now = Clock::now();
+        if (!m_epochStart) {
+            m_epochStart = now;
+            if (m_cwnd < m_wMax) {
+                m_k = std::cbrt((m_wMax - m_cwnd) / C);
+            } else {
+                m_k = 0;
+                m_wMax = m_cwnd;
+            }
+            m_wEst = m_cwnd;
+        }
+        const double t = std::chrono::duration<double>(now - *m_epochStart + rtt.Srtt()).count();
+        const double target = std::clamp(C * std::pow(t - m_k, 3) + m_wMax, m_cwnd, 1.5 * m_cwnd);
+        m_cwnd += (target - m_cwnd) / m_cwnd * acked;
+
+        m_wEst += ALPHA * acked / m_cwnd;
+        m_cwnd = std::max(m_cwnd, m_wEst);
+    }
+
+    void OnLoss() override {
+        Reduce();
+        m_cwnd = m_ssthresh;
+    }
+
+    void OnTimeout() override {
+        Reduce();
+        m_cwnd = 1;
+    }
+
+    uint32_t Window() const override {
+        return std::max<uint32_t>(1, static_cast<uint32_t>(m_cwnd));
+    }
+
+    std::string Name() const override {
+        return "cubic";
+    }
+
+private:
+    static constexpr double C = 0.4;
+    static constexpr double BETA = 0.7;
+    static constexpr double ALPHA = 3 * (1 - BETA) / (1 + BETA);
+
+    void Reduce() {
+        m_epochStart.reset();
+        // Быстрая сходимость: если потеря случилась раньше прежнего W_max, канал, видимо, делят с новым потоком
+        m_wMax = m_cwnd < m_wMax ? m_cwnd * (1 + BETA) / 2 : m_cwnd;
+        m_ssthresh = std::max(m_cwnd * BETA, 2.0);
+    }
+
+    double m_cwnd = INITIAL_WINDOW;
+    double m_ssthresh = std::numeric_limits<double>::max();
+    double m_wMax = 0;
+    double m_wEst = 0;
+    double m_k = 0;
+    std::optional<Clock::time_point> m_epochStart;
+};
+
+// Упрощённый BBR: окно считается не от потерь, а от модели канала — максимальной скорости доставки
+// за последние раунды и минимального RTT (BDP = скорость × RTT). Startup растит окно, пока скорость растёт,
+// затем окно держится на 2 × BDP. Пейсинга нет: окно уходит пачкой
+class BbrLikeControl : public CongestionControl {
+public:
+    void OnAck(uint32_t acked, const RttEstimator& rtt) override {
+        const auto now = Clock::now();
+        if (!m_roundStart) {
+            m_roundStart = now;
+        }
+        m_roundDelivered += acked;
+
+        const auto elapsed = now - *m_roundStart;
+        if (rtt.HasSample() && elapsed >= rtt.MinRtt()) {
+            const double bandwidth = m_roundDelivered / std::chrono::duration<double>(elapsed).count();
+            m_bandwidth.push_back(bandwidth);
+            if (m_bandwidth.size() > BANDWIDTH_WINDOW_ROUNDS) {
+                m_bandwidth.pop_front();
+            }
+            m_roundStart = now;
+            m_roundDelivered = 0;
+            OnRoundEnd(rtt);
+        }
+
+        if (m_state == State::Startup) {
+            // Как медленный старт: окно удваивается за раунд
+            m_cwnd += acked;
+        }
+    }
+
+    // Одиночные потери не меняют модель канала
+    void OnLoss() override {}
+
+    void OnTimeout() override {
+        m_cwnd = MIN_WINDOW;
+    }
+
+    uint32_t Window() const override {
+        return std::max<uint32_t>(MIN_WINDOW, static_cast<uint32_t>(m_cwnd));
+    }
+
+    std::string Name() const override {
+        return "bbr";
+    }
+
+private:
+    enum class State { Startup, Drain, ProbeBandwidth };
+
+    static constexpr size_t BANDWIDTH_WINDOW_ROUNDS = 10;
+    static constexpr uint32_t MIN_WINDOW = 4;
+    static constexpr double STARTUP_GROWTH = 1.25;
+    static constexpr int STARTUP_FULL_ROUNDS = 3;
+    static constexpr double CWND_GAIN = 2;
+
+    double MaxBandwidth() const {
+        return m_bandwidth.empty() ? 0 : *std::max_element(m_bandwidth.begin(), m_bandwidth.end());
+    }
+
+    void OnRoundEnd(const RttEstimator& rtt) {
+        const double bdp = MaxBandwidth() * std::chrono::duration<double>(rtt.MinRtt()).count();
+        switch (m_state) {
+        case State::Startup:
+            // Канал заполнен, когда за три раунда подряд скорость выросла меньше чем на 25%
+            if (MaxBandwidth() >= m_fullBandwidth * STARTUP_GROWTH) {
+                m_fullBandwidth = MaxBandwidth();
+                m_fullRounds = 0;
+            } else if (++m_fullRounds >= STARTUP_FULL_ROUNDS) {
+                m_state = State::Drain;
+                // Очередь, набранная в Startup, рассасывается за раунд с окном в один BDP
+                m_cwnd = bdp;
+            }
+            break;
+        case State::Drain:
+            m_state = State::ProbeBandwidth;
+            m_cwnd = CWND_GAIN * bdp;
+            break;
+        case State::ProbeBandwidth:
+            m_cwnd = CWND_GAIN * bdp;
+            break;
+        }
+    }
+
+    State m_state = State::Startup;
+    double m_cwnd = INITIAL_WINDOW;
+    std::deque<double> m_bandwidth;
+    double m_fullBandwidth = 0;
+    int m_fullRounds = 0;
+    std::optional<Clock::time_point> m_roundStart;
+    uint32_t m_roundDelivered = 0;
+};
+
+inline std::unique_ptr<CongestionControl> MakeCongestionControl(const std::string& name) {
+    if (name == "reno") return std::make_unique<RenoControl>();
+    if (name == "cubic") return std::make_unique<CubicControl>();
+    if (name == "bbr") return std::make_unique<BbrLikeControl>();
+    throw std::invalid_argument("Unknown congestion control: " + name + " (expected reno, cubic or bbr)");
+}
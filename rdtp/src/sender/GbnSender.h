@@ -1,154 +1,96 @@
 #pragma once
-#include "../common/RdtSocket.h"
-#include <fstream>
-#include <chrono>
-#include <deque>
+#include "SenderBase.h"
+#include <map>
 
-class GbnSender {
+class GbnSender : public SenderBase {
 public:
-    GbnSender(const std::string& host, uint16_t port, const std::string& filename, bool debug)
-            : m_targetHost(host), m_targetPort(port), m_filename(filename), m_debug(debug)
-    {
-        if (inet_pton(AF_INET, host.c_str(), &m_targetAddr.sin_addr) <= 0) {
-            throw std::runtime_error("Invalid IP address");
-        }
-        m_targetAddr.sin_family = AF_INET;
-        m_targetAddr.sin_port = htons(port);
-    }
-
-    void Run() {
-        LoadFile();
-        Handshake();
-        TransferLoop();
-        Teardown();
-    }
+    using SenderBase::SenderBase;
 
 private:
-    std::string m_targetHost;
-    uint16_t m_targetPort;
-    sockaddr_in m_targetAddr{};
-    std::string m_filename;
-    bool m_debug;
+    // Повтор после трёх одинаковых ACK, не дожидаясь таймаута (fast retransmit, RFC 5681)
+    static constexpr uint32_t DUP_ACK_THRESHOLD = 3;
 
-    RdtSocket m_socket;
-    std::vector<uint8_t> m_fileData;
+    struct Sent {
+        Clock::time_point sentAt;
+        bool retransmitted = false;
+    };
 
-    uint32_t m_base = 0;
-    uint32_t m_nextSeqNum = 0;
-    uint32_t m_windowSize = 10;
-    int m_timeoutMs = 100;
-
-    void Log(const std::string& msg) {
-        if (m_debug) std::cout << "[SENDER] " << msg << std::endl;
-    }
-
-    void LoadFile() {
-        std::ifstream file(m_filename, std::ios::binary);
-        if (!file) throw std::runtime_error("Cannot open file: " + m_filename);
-        m_fileData = std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-        Log("File loaded. Size: " + std::to_string(m_fileData.size()) + " bytes");
-    }
-
-    void Handshake() {
-        Packet syn;
-        syn.header.flags = static_cast<uint8_t>(PacketType::SYN);
-        syn.header.seqNum = 0;
-
-        Log("Sending SYN...");
-        while (true) {
-            m_socket.SendTo(syn, m_targetAddr);
-            m_socket.SetTimeout(m_timeoutMs);
-
-            Packet ack;
-            if (m_socket.RecvFrom(ack)) {
-                if (ack.header.flags & static_cast<uint8_t>(PacketType::ACK) &&
-                    ack.header.flags & static_cast<uint8_t>(PacketType::SYN)) {
-                    Log("Received SYN-ACK");
-                    m_base = 1;
-                    m_nextSeqNum = 1;
-                    return;
-                }
-            }
-            Log("Timeout SYN. Retrying...");
-        }
-    }
+    // Неподтверждённые пакеты окна: время отправки для замера RTT
+    std::map<uint32_t, Sent> m_sent;
+    uint32_t m_dupAcks = 0;
 
-    Packet CreateDataPacket(uint32_t seq) {
-        Packet p;
-        p.header.seqNum = seq;
-        p.header.flags = static_cast<uint8_t>(PacketType::DATA);
-
-        size_t offset = (seq - 1) * MAX_PAYLOAD_SIZE;
-        size_t remaining = m_fileData.size() - offset;
-        size_t size = std::min(remaining, MAX_PAYLOAD_SIZE);
-
-        p.payload.assign(m_fileData.begin() + offset, m_fileData.begin() + offset + size);
-        return p;
-    }
-
-    void TransferLoop() {
-        uint32_t totalPackets = (m_fileData.size() + MAX_PAYLOAD_SIZE - 1) / MAX_PAYLOAD_SIZE;
-        if (m_fileData.empty()) totalPackets = 0;
-
-        auto startTime = std::chrono::high_resolution_clock::now();
+    void TransferLoop() override {
+        uint32_t totalPackets = TotalPackets();
+        // Таймер окна перезапускается при сдвиге базы и после таймаута, но не от битых датаграмм
+        auto deadline = Clock::now() + m_rtt.Rto();
 
         while (m_base <= totalPackets) {
-            while (m_nextSeqNum < m_base + m_windowSize && m_nextSeqNum <= totalPackets) {
-                Packet p = CreateDataPacket(m_nextSeqNum);
-                m_socket.SendTo(p, m_targetAddr);
-                Log("Sent Packet #" + std::to_string(m_nextSeqNum));
+            const auto now = Clock::now();
+            if (m_nextSeqNum == m_base) {
+                deadline = now + m_rtt.Rto();
+            }
+            std::vector<Packet> burst;
+            while (m_nextSeqNum < m_base + Window() && m_nextSeqNum <= totalPackets) {
+                burst.push_back(CreateDataPacket(m_nextSeqNum));
+                auto [it, inserted] = m_sent.try_emplace(m_nextSeqNum, Sent{now});
+                if (!inserted) it->second = Sent{now, true};
+                SENDER_LOG("Sent Packet #" + std::to_string(m_nextSeqNum));
                 m_nextSeqNum++;
             }
+            if (!burst.empty()) {
+                m_socket.SendMany(burst, m_targetAddr);
+            }
 
-            m_socket.SetTimeout(m_timeoutMs);
-            Packet ack;
-            if (m_socket.RecvFrom(ack)) {
-                if (ack.header.flags & static_cast<uint8_t>(PacketType::ACK)) {
-                    uint32_t ackNum = ack.header.seqNum;
-                    Log("Received ACK #" + std::to_string(ackNum));
-
-                    if (ackNum >= m_base) {
-                        m_base = ackNum + 1;
-
-                        if (!m_debug) {
-                            float progress = (float)(m_base-1) / totalPackets * 100.0f;
-                            std::cout << "\rProgress: " << (int)progress << "%" << std::flush;
-                        }
-                    }
+            const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+            m_socket.SetTimeout(std::max<int>(1, static_cast<int>(wait)));
+            PacketView ack;
+            const RecvStatus status = m_socket.RecvFrom(ack);
+            if (status == RecvStatus::Received) {
+                const uint32_t oldBase = m_base;
+                if (ack.Flags() & static_cast<uint8_t>(PacketType::ACK)) {
+                    HandleAck(ack);
                 }
-            } else {
-                Log("Timeout! Resending window from " + std::to_string(m_base));
-                m_nextSeqNum = m_base;
+                if (m_base != oldBase) {
+                    deadline = Clock::now() + m_rtt.Rto();
+                }
+            } else if (status == RecvStatus::Timeout) {
+                SENDER_LOG("Timeout! Resending window from " + std::to_string(m_base));
+                m_congestion->OnTimeout();
+                m_rtt.Backoff();
+                GoBack();
+                deadline = Clock::now() + m_rtt.Rto();
             }
         }
-        if (!m_debug) std::cout << std::endl;
-
-        auto endTime = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
-        std::cout << "Transfer complete in " << duration << " ms." << std::endl;
     }
 
-    void Teardown() {
-        Packet fin;
-        fin.header.flags = static_cast<uint8_t>(PacketType::FIN);
-        fin.header.seqNum = m_nextSeqNum;
+    void HandleAck(const PacketView& ack) {
+        UpdatePeerWindow(ack);
+        uint32_t ackNum = ack.SeqNum();
+        SENDER_LOG("Received ACK #" + std::to_string(ackNum));
 
-        Log("Sending FIN...");
-        int retries = 0;
-        while (retries < 5) {
-            m_socket.SendTo(fin, m_targetAddr);
-            m_socket.SetTimeout(m_timeoutMs);
-            Packet ack;
-            if (m_socket.RecvFrom(ack)) {
-                if (ack.header.flags & static_cast<uint8_t>(PacketType::ACK) &&
-                    ack.header.flags & static_cast<uint8_t>(PacketType::FIN)) {
-                    Log("Received FIN-ACK. Goodbye.");
-                    return;
-                }
+        if (ackNum >= m_base && ackNum < m_nextSeqNum) {
+            // Правило Карна: ACK на повторно отправленный пакет для замера не годится
+            auto it = m_sent.find(ackNum);
+            if (it != m_sent.end() && !it->second.retransmitted) {
+                m_rtt.AddSample(std::chrono::duration_cast<RttEstimator::Duration>(Clock::now() - it->second.sentAt));
             }
-            retries++;
-            Log("Timeout FIN. Retry " + std::to_string(retries));
+            m_sent.erase(m_sent.begin(), m_sent.upper_bound(ackNum));
+
+            const uint32_t acked = ackNum + 1 - m_base;
+            m_base = ackNum + 1;
+            m_dupAcks = 0;
+            m_congestion->OnAck(acked, m_rtt);
+            OnBaseAdvanced();
+        } else if (ackNum + 1 == m_base && ++m_dupAcks == DUP_ACK_THRESHOLD && m_base > m_recoverSeq) {
+            SENDER_LOG("Triple duplicate ACK #" + std::to_string(ackNum) + ". Resending window from " + std::to_string(m_base));
+            m_congestion->OnLoss();
+            GoBack();
         }
-        Log("Forced shutdown.");
     }
-};
\ No newline at end of file
+
+    void GoBack() {
+        m_recoverSeq = m_nextSeqNum - 1;
+        m_nextSeqNum = m_base;
+        m_dupAcks = 0;
+    }
+};
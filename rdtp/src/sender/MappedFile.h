@@ -0,0 +1,77 @@
+#pragma once
+#include "../../../lib/FileDesc.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <system_error>
+#include <utility>
+
+// Файл, отображённый в память только для чтения. Пакеты нарезаются прямо из отображения, а страницы
+// подтверждённой части отдаются ядру, поэтому расход памяти не зависит от размера файла
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    explicit MappedFile(const std::string& path) {
+        FileDesc fd(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+        if (!fd.IsOpen()) throw std::system_error(errno, std::generic_category(), "Cannot open file: " + path);
+
+        struct stat st{};
+        if (fstat(fd.Get(), &st) == -1) throw std::system_error(errno, std::generic_category(), path);
+        m_size = static_cast<size_t>(st.st_size);
+        // Пустой файл отобразить нельзя: mmap нулевой длины — ошибка
+        if (m_size == 0) return;
+
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd.Get(), 0);
+        if (data == MAP_FAILED) throw std::system_error(errno, std::generic_category(), path);
+        m_data = static_cast<const uint8_t*>(data);
+        // Файл читается один раз подряд: ядро читает вперёд агрессивнее
+        madvise(data, m_size, MADV_SEQUENTIAL);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept
+            : m_data(std::exchange(other.m_data, nullptr)), m_size(std::exchange(other.m_size, 0)),
+              m_released(std::exchange(other.m_released, 0)) {}
+
+    MappedFile& operator=(MappedFile&& rhs) noexcept {
+        std::swap(m_data, rhs.m_data);
+        std::swap(m_size, rhs.m_size);
+        std::swap(m_released, rhs.m_released);
+        return *this;
+    }
+
+    ~MappedFile() {
+        if (m_data) munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+
+    const uint8_t* Data() const {
+        return m_data;
+    }
+
+    size_t Size() const {
+        return m_size;
+    }
+
+    // Страницы до offset больше не нужны. Отдаются ядру порциями, а не на каждый ACK
+    void Release(size_t offset) {
+        if (!m_data) return;
+        const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const size_t end = std::min(offset, m_size) / page * page;
+        if (end < m_released + RELEASE_CHUNK) return;
+        madvise(const_cast<uint8_t*>(m_data) + m_released, end - m_released, MADV_DONTNEED);
+        m_released = end;
+    }
+
+private:
+    static constexpr size_t RELEASE_CHUNK = 4 * 1024 * 1024;
+
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    // Граница уже отданной ядру части, кратная размеру страницы
+    size_t m_released = 0;
+};
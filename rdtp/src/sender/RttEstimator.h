@@ -0,0 +1,65 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+
+// Таймаут повтора по замерам RTT, как в TCP (RFC 6298): SRTT и RTTVAR сглаживают замеры,
+// RTO = SRTT + 4 * RTTVAR, после каждого таймаута RTO удваивается до следующего замера.
+// Замеры берутся только с пакетов, отправленных один раз (правило Карна): ACK на повтор неоднозначен
+class RttEstimator {
+public:
+    using Duration = std::chrono::microseconds;
+
+    // RFC советует начинать с 1 с и не опускаться ниже 1 с; для передачи по локальной сети границы ниже
+    static constexpr Duration INITIAL_RTO = std::chrono::milliseconds(100);
+    static constexpr Duration MIN_RTO = std::chrono::milliseconds(10);
+    static constexpr Duration MAX_RTO = std::chrono::seconds(10);
+    // Гранулярность таймера: SO_RCVTIMEO задаётся в миллисекундах
+    static constexpr Duration GRANULARITY = std::chrono::milliseconds(1);
+
+    void AddSample(Duration rtt) {
+        if (!m_hasSample) {
+            m_srtt = rtt;
+            m_rttvar = rtt / 2;
+            m_minRtt = rtt;
+            m_hasSample = true;
+        } else {
+            const Duration delta = m_srtt > rtt ? m_srtt - rtt : rtt - m_srtt;
+            m_rttvar = (3 * m_rttvar + delta) / 4;
+            m_srtt = (7 * m_srtt + rtt) / 8;
+            m_minRtt = std::min(m_minRtt, rtt);
+        }
+        m_rto = std::clamp(m_srtt + std::max(GRANULARITY, 4 * m_rttvar), MIN_RTO, MAX_RTO);
+    }
+
+    void Backoff() {
+        m_rto = std::min(m_rto * 2, MAX_RTO);
+    }
+
+    Duration Rto() const {
+        return m_rto;
+    }
+
+    int RtoMs() const {
+        return static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(m_rto).count());
+    }
+
+    bool HasSample() const {
+        return m_hasSample;
+    }
+
+    // До первого замера — начальный RTO
+    Duration Srtt() const {
+        return m_hasSample ? m_srtt : INITIAL_RTO;
+    }
+
+    Duration MinRtt() const {
+        return m_hasSample ? m_minRtt : INITIAL_RTO;
+    }
+
+private:
+    bool m_hasSample = false;
+    Duration m_srtt{0};
+    Duration m_rttvar{0};
+    Duration m_minRtt{0};
+    Duration m_rto = INITIAL_RTO;
+};
@@ -0,0 +1,179 @@
+#pragma once
+#include "CongestionControl.h"
+#include "MappedFile.h"
+#include "RttEstimator.h"
+#include "../common/RdtSocket.h"
+#include "../../../lib/Logger.h"
+#include <chrono>
+
+// Трасса в режиме -d. Макрос, а не функция: без -d сообщение даже не собирается
+#define SENDER_LOG(message)                       \
+    do {                                          \
+        if (m_debug) LOG_INFO("SENDER", message); \
+    } while (false)
+
+// Общее у отправителей GBN и Selective Repeat: файл, рукопожатие, нарезка на пакеты, завершение,
+// окно (меньшее из окна перегрузки и окна получателя) и таймаут повтора. Наследник реализует только передачу окна
+class SenderBase {
+public:
+    SenderBase(const std::string& host, uint16_t port, const std::string& filename, bool debug,
+               std::unique_ptr<CongestionControl> congestion)
+            : m_targetHost(host), m_targetPort(port), m_filename(filename), m_debug(debug),
+              m_congestion(std::move(congestion))
+    {
+        if (inet_pton(AF_INET, host.c_str(), &m_targetAddr.sin_addr) <= 0) {
+            throw std::runtime_error("Invalid IP address");
+        }
+        m_targetAddr.sin_family = AF_INET;
+        m_targetAddr.sin_port = htons(port);
+    }
+
+    virtual ~SenderBase() = default;
+
+    void Run() {
+        m_file = MappedFile(m_filename);
+        SENDER_LOG("File mapped. Size: " + std::to_string(m_file.Size()) + " bytes");
+        Handshake();
+
+        auto startTime = std::chrono::high_resolution_clock::now();
+        TransferLoop();
+        if (!m_debug) std::cout << std::endl;
+        auto endTime = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
+        LOG_INFO("", "Transfer complete in " + std::to_string(duration) + " ms (" + m_congestion->Name()
+            + ", SRTT " + std::to_string(m_rtt.Srtt().count()) + " us, RTO " + std::to_string(m_rtt.RtoMs()) + " ms).");
+
+        Teardown();
+    }
+
+protected:
+    std::string m_targetHost;
+    uint16_t m_targetPort;
+    sockaddr_in m_targetAddr{};
+    std::string m_filename;
+    bool m_debug;
+
+    RdtSocket m_socket;
+    MappedFile m_file;
+
+    using Clock = std::chrono::steady_clock;
+
+    uint32_t m_base = 0;
+    uint32_t m_nextSeqNum = 0;
+    // Пока реакция на потерю не подтверждена целиком (m_base <= m_recoverSeq), новые потери окно не сокращают
+    uint32_t m_recoverSeq = 0;
+
+    std::unique_ptr<CongestionControl> m_congestion;
+    RttEstimator m_rtt;
+    // До первого ACK получатель своё окно не сообщал
+    uint32_t m_peerWindow = static_cast<uint32_t>(CongestionControl::INITIAL_WINDOW);
+
+    virtual void TransferLoop() = 0;
+
+    // Дополнительные флаги SYN: так получатель узнаёт режим отправителя
+    virtual uint8_t SynFlags() const {
+        return 0;
+    }
+
+    uint32_t Window() const {
+        return std::max<uint32_t>(1, std::min(m_congestion->Window(), m_peerWindow));
+    }
+
+    void UpdatePeerWindow(const PacketView& ack) {
+        if (ack.Flags() & static_cast<uint8_t>(PacketType::WINDOW)) {
+            m_peerWindow = ack.Window();
+        }
+    }
+
+    uint32_t TotalPackets() const {
+        return (m_file.Size() + MAX_PAYLOAD_SIZE - 1) / MAX_PAYLOAD_SIZE;
+    }
+
+    // Окно сдвинулось: подтверждённая часть файла больше не понадобится
+    void OnBaseAdvanced() {
+        const uint32_t acked = m_base - 1;
+        m_file.Release(static_cast<size_t>(acked) * MAX_PAYLOAD_SIZE);
+        if (!m_debug && TotalPackets() > 0) {
+            float progress = (float)acked / TotalPackets() * 100.0f;
+            std::cout << "\rProgress: " << (int)progress << "%" << std::flush;
+        }
+    }
+
+    Packet CreateDataPacket(uint32_t seq) {
+        Packet p;
+        p.header.seqNum = seq;
+        p.header.flags = static_cast<uint8_t>(PacketType::DATA);
+
+        size_t offset = (seq - 1) * MAX_PAYLOAD_SIZE;
+        size_t remaining = m_file.Size() - offset;
+        size_t size = std::min(remaining, MAX_PAYLOAD_SIZE);
+
+        // Payload — прямо кусок отображения: в ядро он копируется при отправке, и это единственная копия
+        p.payload = std::span<const uint8_t>(m_file.Data() + offset, size);
+        return p;
+    }
+
+private:
+    void Handshake() {
+        Packet syn;
+        syn.header.flags = static_cast<uint8_t>(PacketType::SYN) | SynFlags();
+        syn.header.seqNum = 0;
+
+        SENDER_LOG("Sending SYN...");
+        bool retransmitted = false;
+        while (true) {
+            const auto sentAt = Clock::now();
+            m_socket.SendTo(syn, m_targetAddr);
+            m_socket.SetTimeout(m_rtt.RtoMs());
+
+            // Битые и посторонние датаграммы пропускаются, SYN повторяется только по таймауту
+            PacketView ack;
+            RecvStatus status;
+            while ((status = m_socket.RecvFrom(ack)) != RecvStatus::Timeout) {
+                if (status == RecvStatus::Received &&
+                    ack.Flags() & static_cast<uint8_t>(PacketType::ACK) &&
+                    ack.Flags() & static_cast<uint8_t>(PacketType::SYN)) {
+                    SENDER_LOG("Received SYN-ACK");
+                    if (!retransmitted) {
+                        m_rtt.AddSample(std::chrono::duration_cast<RttEstimator::Duration>(Clock::now() - sentAt));
+                    }
+                    UpdatePeerWindow(ack);
+                    m_base = 1;
+                    m_nextSeqNum = 1;
+                    return;
+                }
+            }
+            SENDER_LOG("Timeout SYN. Retrying...");
+            m_rtt.Backoff();
+            retransmitted = true;
+        }
+    }
+
+    void Teardown() {
+        Packet fin;
+        fin.header.flags = static_cast<uint8_t>(PacketType::FIN);
+        fin.header.seqNum = m_nextSeqNum;
+
+        SENDER_LOG("Sending FIN...");
+        int retries = 0;
+        while (retries < 5) {
+            m_socket.SendTo(fin, m_targetAddr);
+            m_socket.SetTimeout(m_rtt.RtoMs());
+            // Запоздавшие ACK данных из большого окна и битые датаграммы пропускаются, попыткой считается только таймаут
+            PacketView ack;
+            RecvStatus status;
+            while ((status = m_socket.RecvFrom(ack)) != RecvStatus::Timeout) {
+                if (status == RecvStatus::Received &&
+                    ack.Flags() & static_cast<uint8_t>(PacketType::ACK) &&
+                    ack.Flags() & static_cast<uint8_t>(PacketType::FIN)) {
+                    SENDER_LOG("Received FIN-ACK. Goodbye.");
+                    return;
+                }
+            }
+            retries++;
+            m_rtt.Backoff();
+            SENDER_LOG("Timeout FIN. Retry " + std::to_string(retries));
+        }
+        SENDER_LOG("Forced shutdown.");
+    }
+};
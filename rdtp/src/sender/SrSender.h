@@ -0,0 +1,170 @@
+#pragma once
+#include "SenderBase.h"
+#include <algorithm>
+#include <map>
+#include <optional>
+
+// Selective Repeat: у каждого пакета окна свой таймер, повторно уходят только пакеты с истёкшим таймером
+// или потерянные по SACK.
+// Получатель подтверждает кумулятивно и сообщает SACK-блоками, что уже принято сверх того
+class SrSender : public SenderBase {
+public:
+    using SenderBase::SenderBase;
+
+private:
+    // Пакет считается потерянным, когда подтверждено столько пакетов после него (DupThresh, RFC 6675)
+    static constexpr uint32_t DUP_THRESHOLD = 3;
+
+    struct InFlight {
+        Clock::time_point sentAt;
+        bool acked = false;
+        bool retransmitted = false;
+        // Потерю заметили по SACK или по таймеру: пакет не в сети и ждёт повтора
+        bool lost = false;
+    };
+
+    // Пакеты окна [m_base, m_nextSeqNum)
+    std::map<uint32_t, InFlight> m_inFlight;
+
+    uint8_t SynFlags() const override {
+        return static_cast<uint8_t>(PacketType::SACK);
+    }
+
+    void TransferLoop() override {
+        uint32_t totalPackets = TotalPackets();
+
+        while (m_base <= totalPackets) {
+            const auto now = Clock::now();
+            const auto timeout = m_rtt.Rto();
+            // Пакет с истёкшим таймером считается покинувшим сеть. Таймеры пакетов одного окна истекают
+            // почти разом: окно сбрасывается один раз на эпизод потерь, а RTO ещё удваивается,
+            // если истёк таймер уже повторённого пакета
+            bool newTimeout = false;
+            bool repeatedTimeout = false;
+            for (auto& [seq, packet] : m_inFlight) {
+                if (packet.acked || packet.lost || now - packet.sentAt < timeout) continue;
+                SENDER_LOG("Timeout! Packet #" + std::to_string(seq));
+                newTimeout = newTimeout || seq > m_recoverSeq;
+                repeatedTimeout = repeatedTimeout || packet.retransmitted;
+                packet.lost = true;
+            }
+            if (newTimeout) {
+                m_congestion->OnTimeout();
+                m_recoverSeq = m_nextSeqNum - 1;
+            }
+            if (newTimeout || repeatedTimeout) {
+                m_rtt.Backoff();
+            }
+
+            // pipe (RFC 6675) — пакеты в сети: не подтверждённые и не признанные потерянными.
+            // Повторы, а за ними новые пакеты уходят, пока pipe меньше окна; остальные потерянные
+            // ждут, пока окно раскроется. Размах окна по номерам ограничен буфером получателя
+            uint32_t pipe = 0;
+            for (const auto& [seq, packet] : m_inFlight) {
+                if (!packet.acked && !packet.lost) pipe++;
+            }
+            const uint32_t window = Window();
+            std::vector<Packet> burst;
+            for (auto it = m_inFlight.begin(); it != m_inFlight.end() && pipe < window; ++it) {
+                InFlight& packet = it->second;
+                if (packet.acked || !packet.lost) continue;
+                SENDER_LOG("Resending #" + std::to_string(it->first));
+                burst.push_back(CreateDataPacket(it->first));
+                packet = InFlight{now, false, true, false};
+                pipe++;
+            }
+            const uint32_t span = std::max<uint32_t>(1, m_peerWindow);
+            while (pipe < window && m_nextSeqNum < m_base + span && m_nextSeqNum <= totalPackets) {
+                burst.push_back(CreateDataPacket(m_nextSeqNum));
+                m_inFlight[m_nextSeqNum] = InFlight{now};
+                SENDER_LOG("Sent Packet #" + std::to_string(m_nextSeqNum));
+                m_nextSeqNum++;
+                pipe++;
+            }
+            if (!burst.empty()) {
+                m_socket.SendMany(burst, m_targetAddr);
+            }
+
+            // Ждём ACK не дольше, чем до ближайшего истекающего таймера
+            auto deadline = now + m_rtt.Rto();
+            for (const auto& [seq, packet] : m_inFlight) {
+                if (!packet.acked && !packet.lost) deadline = std::min(deadline, packet.sentAt + m_rtt.Rto());
+            }
+            const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+            m_socket.SetTimeout(std::max<int>(1, static_cast<int>(wait)));
+
+            PacketView ack;
+            const RecvStatus status = m_socket.RecvFrom(ack);
+            if (status == RecvStatus::Received && (ack.Flags() & static_cast<uint8_t>(PacketType::ACK))) {
+                HandleAck(ack);
+            }
+        }
+    }
+
+    void HandleAck(const PacketView& ack) {
+        UpdatePeerWindow(ack);
+        SENDER_LOG("Received ACK #" + std::to_string(ack.SeqNum()) + " with "
+            + std::to_string(ack.SackCount()) + " SACK blocks");
+
+        const auto now = Clock::now();
+        uint32_t newlyAcked = 0;
+        // Замер RTT — по последнему отправленному из впервые подтверждённых пакетов, если он уходил один раз
+        std::optional<Clock::time_point> sampleSentAt;
+        auto markAcked = [&](InFlight& packet) {
+            if (packet.acked) return;
+            packet.acked = true;
+            newlyAcked++;
+            if (!packet.retransmitted && (!sampleSentAt || packet.sentAt > *sampleSentAt)) {
+                sampleSentAt = packet.sentAt;
+            }
+        };
+
+        for (auto it = m_inFlight.begin(); it != m_inFlight.end() && it->first <= ack.SeqNum(); ++it) {
+            markAcked(it->second);
+        }
+        for (size_t i = 0; i < ack.SackCount(); ++i) {
+            const SackBlock block = ack.Sack(i);
+            for (auto it = m_inFlight.lower_bound(block.first); it != m_inFlight.end() && it->first <= block.last; ++it) {
+                markAcked(it->second);
+            }
+        }
+        if (sampleSentAt) {
+            m_rtt.AddSample(std::chrono::duration_cast<RttEstimator::Duration>(now - *sampleSentAt));
+        }
+
+        DetectLosses();
+        if (newlyAcked > 0) {
+            m_congestion->OnAck(newlyAcked, m_rtt);
+        }
+
+        const uint32_t oldBase = m_base;
+        while (!m_inFlight.empty() && m_inFlight.begin()->second.acked) {
+            m_inFlight.erase(m_inFlight.begin());
+            m_base++;
+        }
+        if (m_base != oldBase) {
+            OnBaseAdvanced();
+        }
+    }
+
+    // Неподтверждённый пакет, после которого подтверждено не меньше DUP_THRESHOLD пакетов, считается потерянным.
+    // Быстрый повтор делается один раз, повтор повтора — уже по таймеру
+    void DetectLosses() {
+        uint32_t ackedAfter = 0;
+        bool lossFound = false;
+        for (auto it = m_inFlight.rbegin(); it != m_inFlight.rend(); ++it) {
+            InFlight& packet = it->second;
+            if (packet.acked) {
+                ackedAfter++;
+            } else if (ackedAfter >= DUP_THRESHOLD && !packet.retransmitted && !packet.lost) {
+                packet.lost = true;
+                lossFound = lossFound || it->first > m_recoverSeq;
+            }
+        }
+        // Окно сокращается один раз на окно потерь
+        if (lossFound) {
+            m_congestion->OnLoss();
+            m_recoverSeq = m_nextSeqNum - 1;
+        }
+    }
+};
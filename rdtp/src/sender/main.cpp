@@ -1,23 +1,38 @@
 #include <iostream>
+#include <memory>
 #include "GbnSender.h"
+#include "SrSender.h"
 
 int main(int argc, char* argv[]) {
     if (argc < 4) {
-        std::cerr << "Usage: " << argv[0] << " <host> <port> <file> [-d]" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " <host> <port> <file> [-d] [--sr] [--cc=reno|cubic|bbr]" << std::endl;
         return 1;
     }
 
     std::string host = argv[1];
     uint16_t port = std::stoi(argv[2]);
     std::string file = argv[3];
-    bool debug = (argc > 4 && std::string(argv[4]) == "-d");
+    bool debug = false;
+    bool selectiveRepeat = false;
+    std::string congestion = "reno";
+    for (int i = 4; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "-d") debug = true;
+        else if (arg == "--sr") selectiveRepeat = true;
+        else if (arg.rfind("--cc=", 0) == 0) congestion = arg.substr(5);
+    }
 
     try {
-        GbnSender sender(host, port, file, debug);
-        sender.Run();
+        std::unique_ptr<SenderBase> sender;
+        if (selectiveRepeat) {
+            sender = std::make_unique<SrSender>(host, port, file, debug, MakeCongestionControl(congestion));
+        } else {
+            sender = std::make_unique<GbnSender>(host, port, file, debug, MakeCongestionControl(congestion));
+        }
+        sender->Run();
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
         return 1;
     }
     return 0;
-}
\ No newline at end of file
+}
@@ -1,48 +1,60 @@
 #pragma once
-#include "../../lib/Connection.h"
+#include "../../lib/AsyncSocket.h"
+#include <chrono>
 #include <string>
 #include <vector>
 #include <stdexcept>
 #include <iostream>
 
+// Клиент SMTP на сопрограммах: каждая команда ждёт ответа сервера в цикле событий, не блокируя поток,
+// поэтому один поток может вести сразу несколько сессий
 class SmtpClient
 {
 public:
-    SmtpClient(const std::string& serverAddress, uint16_t port = 25)
-            : m_connection(port, serverAddress)
+    static Async<SmtpClient> Connect(EventLoop& loop, const std::string& serverAddress, uint16_t port = 25)
     {
-        ReceiveWelcomeMessage();
+        SmtpClient client(co_await AsyncSocket::Connect(loop, serverAddress, port, ReplyTimeout));
+        co_await client.ReceiveWelcomeMessage();
+        co_return client;
     }
 
-    void SendEmail(
+    Async<void> SendEmail(
             const std::string& from,
             const std::string& to,
             const std::string& subject,
             const std::string& body)
     {
-        SendGreeting();
-        SendMailFrom(from);
-        SendRcptTo(to);
-        SendData();
-        SendEmailContent(from, to, subject, body);
-        SendQuit();
+        co_await SendGreeting();
+        co_await SendMailFrom(from);
+        co_await SendRcptTo(to);
+        co_await SendData();
+        co_await SendEmailContent(from, to, subject, body);
+        co_await SendQuit();
     }
 
 private:
-    Connection m_connection;
+    explicit SmtpClient(AsyncSocket connection)
+            : m_connection(std::move(connection))
+    {
+    }
+
+    // Сервер, который молчит дольше, считается зависшим (RFC 5321, 4.5.3.2 — от 2 до 10 минут на ответ)
+    static constexpr std::chrono::minutes ReplyTimeout{ 5 };
+
+    AsyncSocket m_connection;
     static constexpr int SUCCESS_CODE = 250;
     static constexpr int SERVICE_READY_CODE = 220;
     static constexpr int START_DATA_CODE = 354;
     static constexpr int GOODBYE_CODE = 221;
 
-    std::string ReadSmtpResponse()
+    Async<std::string> ReadSmtpResponse()
     {
         std::string fullResponse;
         std::string line;
 
         do
         {
-            line = m_connection.ReadLine();
+            line = co_await m_connection.ReadLine();
             fullResponse += line;
 
             if (line.size() < 4) break;
@@ -53,79 +65,79 @@ private:
             }
         } while (true);
 
-        return fullResponse;
+        co_return fullResponse;
     }
 
-    void ReceiveWelcomeMessage()
+    Async<void> ReceiveWelcomeMessage()
     {
-        const auto response = ReadSmtpResponse();
+        const auto response = co_await ReadSmtpResponse();
         if (!response.starts_with(std::to_string(SERVICE_READY_CODE)))
         {
             throw std::runtime_error("SMTP server did not respond with 220: " + response);
         }
     }
 
-    void SendGreeting()
+    Async<void> SendGreeting()
     {
         const std::string ehloCommand = "EHLO client.example.com\r\n";
-        m_connection.Send(ehloCommand);
+        co_await m_connection.Write(ehloCommand);
 
-        auto response = ReadSmtpResponse();
+        auto response = co_await ReadSmtpResponse();
 
         if (response.starts_with(std::to_string(SUCCESS_CODE)))
         {
-            return;
+            co_return;
         }
 
         std::cout << "EHLO failed. Falling back to HELO..." << std::endl;
-        SendHelo();
+        co_await SendHelo();
     }
 
-    void SendHelo()
+    Async<void> SendHelo()
     {
         const std::string heloCommand = "HELO client.example.com\r\n";
-        m_connection.Send(heloCommand);
-        const auto response = ReadSmtpResponse();
+        co_await m_connection.Write(heloCommand);
+        const auto response = co_await ReadSmtpResponse();
         if (!response.starts_with(std::to_string(SUCCESS_CODE)))
         {
             throw std::runtime_error("HELO failed: " + response);
         }
     }
 
-    void SendMailFrom(const std::string& from)
+    Async<void> SendMailFrom(const std::string& from)
     {
         const std::string mailFromCommand = "MAIL FROM: <" + from + ">\r\n";
-        m_connection.Send(mailFromCommand);
-        const auto response = ReadSmtpResponse();
+        co_await m_connection.Write(mailFromCommand);
+        const auto response = co_await ReadSmtpResponse();
         if (!response.starts_with(std::to_string(SUCCESS_CODE)))
         {
             throw std::runtime_error("MAIL FROM failed: " + response);
         }
     }
 
-    void SendRcptTo(const std::string& to)
+    Async<void> SendRcptTo(const std::string& to)
     {
         const std::string rcptToCommand = "RCPT TO: <" + to + ">\r\n";
-        m_connection.Send(rcptToCommand);
-        const auto response = ReadSmtpResponse();
+        co_await m_connection.Write(rcptToCommand);
+        const auto response = co_await ReadSmtpResponse();
         if (!response.starts_with(std::to_string(SUCCESS_CODE)))
         {
             throw std::runtime_error("RCPT TO failed: " + response);
         }
     }
 
-    void SendData()
+    Async<void> SendData()
     {
         const std::string dataCommand = "DATA\r\n";
-        m_connection.Send(dataCommand);
-        const auto response = ReadSmtpResponse();
+        co_await m_connection.Write(dataCommand);
+        const auto response = co_await ReadSmtpResponse();
         if (!response.starts_with(std::to_string(START_DATA_CODE)))
         {
             throw std::runtime_error("DATA command failed: " + response);
         }
     }
 
-    void SendEmailContent(
+    Async<void> SendEmailContent(
             const std::string& from,
             const std::string& to,
             const std::string& subject,
@@ -139,19 +151,19 @@ private:
         emailContent += body + "\r\n";
         emailContent += ".\r\n";
 
-        m_connection.Send(emailContent);
-        const auto response = ReadSmtpResponse();
+        co_await m_connection.Write(emailContent);
+        const auto response = co_await ReadSmtpResponse();
         if (!response.starts_with(std::to_string(SUCCESS_CODE)))
         {
             throw std::runtime_error("Failed to send email content: " + response);
         }
     }
 
-    void SendQuit()
+    Async<void> SendQuit()
     {
         const std::string quitCommand = "QUIT\r\n";
-        m_connection.Send(quitCommand);
-        const auto response = ReadSmtpResponse();
+        co_await m_connection.Write(quitCommand);
+        const auto response = co_await ReadSmtpResponse();
         if (!response.starts_with(std::to_string(GOODBYE_CODE)))
         {
             throw std::runtime_error("QUIT failed: " + response);
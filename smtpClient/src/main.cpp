@@ -38,15 +38,15 @@ SmtpMode ParseCommandLine(int argc, char* argv[])
     return mode;
 }
 
-void Run(const SmtpMode& mode)
+Async<void> Run(EventLoop& loop, const SmtpMode& mode)
 {
     std::cout << "Connecting to SMTP server " << mode.serverAddress << ":" << mode.port << "..." << std::endl;
     
-    SmtpClient client(mode.serverAddress, mode.port);
+    SmtpClient client = co_await SmtpClient::Connect(loop, mode.serverAddress, mode.port);
     
     std::cout << "Sending email from " << mode.from << " to " << mode.to << "..." << std::endl;
     
-    client.SendEmail(mode.from, mode.to, mode.subject, mode.body);
+    co_await client.SendEmail(mode.from, mode.to, mode.subject, mode.body);
     
     std::cout << "Email sent successfully!" << std::endl;
 }
@@ -56,7 +56,8 @@ int main(int argc, char* argv[])
     try
     {
         auto mode = ParseCommandLine(argc, argv);
-        Run(mode);
+        EventLoop loop;
+        RunSync(loop, Run(loop, mode));
         return EXIT_SUCCESS;
     }
     catch (const std::exception& e)
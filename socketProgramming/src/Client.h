@@ -5,6 +5,7 @@
 #include <iostream>
 #include <netinet/in.h>
 #include <string>
+#include <string_view>
 #include <cassert>
 
 struct ClientMode
@@ -18,12 +19,12 @@ namespace
     const std::string clientName = "Client of Bogdan";
 }
 
-void HandleResponse(std::string const& response, std::string const& clientNumberStr)
+void HandleResponse(std::string_view response, std::string const& clientNumberStr)
 {
     const auto delPos = response.find(DELIMITER);
-    assert((delPos != std::string::npos));
+    assert((delPos != std::string_view::npos));
     const auto serverName = response.substr(0, delPos);
-    int serverNumber = std::stoi(response.substr(delPos + 1));
+    int serverNumber = std::stoi(std::string(response.substr(delPos + 1)));
     int clientNumber = std::stoi(clientNumberStr);
 
     std::cout << "Client Name: " << clientName << std::endl;
@@ -46,14 +47,14 @@ inline void Run(const ClientMode& mode)
     std::string message = clientName + DELIMITER += number;
     connection.Send(message);
     const auto response = connection.Receive();
-    if (response.empty())
+    if (response.Empty())
     {
         return;
     }
 
     try
     {
-        HandleResponse(response, number);
+        HandleResponse(response.View(), number);
     }
     catch (std::exception const& e)
     {
@@ -64,6 +64,7 @@ inline void Run(const ServerMode& mode)
 		.sin_family = AF_INET,
 		.sin_port = htons(mode.port),
 		.sin_addr = { .s_addr = INADDR_ANY },
+		.sin_zero = {},
 	};
 
 	const Acceptor acceptor{ serverAddr, QUEUE_SIZE };
@@ -0,0 +1,125 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <zlib.h>
+#include "../../lib/HttpParser.h"
+
+// Кодировки тела в порядке предпочтения сервера: br сжимает текст лучше gzip
+enum class ContentEncoding
+{
+    Brotli,
+    Gzip,
+    Identity,
+};
+
+constexpr size_t ContentEncodingCount = 3;
+
+struct ContentEncodingInfo
+{
+    std::string_view name;
+    // Расширение заранее сжатого файла рядом с исходным
+    std::string_view suffix;
+};
+
+constexpr std::array<ContentEncodingInfo, ContentEncodingCount> ContentEncodings{ {
+    { "br", ".br" },
+    { "gzip", ".gz" },
+    { "identity", "" },
+} };
+
+constexpr const ContentEncodingInfo& GetEncodingInfo(ContentEncoding encoding)
+{
+    return ContentEncodings[static_cast<size_t>(encoding)];
+}
+
+constexpr uint32_t EncodingBit(ContentEncoding encoding)
+{
+    return 1u << static_cast<size_t>(encoding);
+}
+
+// Какие кодировки принимает клиент, по заголовку Accept-Encoding (RFC 9110, 12.5.3).
+// Вес учитывается только как запрет (q=0): из допустимых выбирает сервер. identity допустима всегда
+inline uint32_t ParseAcceptEncoding(std::string_view header)
+{
+    uint32_t accepted = EncodingBit(ContentEncoding::Identity);
+    uint32_t rejected = 0;
+    bool wildcard = false;
+    while (!header.empty()) {
+        const size_t comma = header.find(',');
+        std::string_view item = header.substr(0, comma);
+        header = comma == std::string_view::npos ? std::string_view() : header.substr(comma + 1);
+
+        std::string_view params;
+        if (const size_t semicolon = item.find(';'); semicolon != std::string_view::npos) {
+            params = item.substr(semicolon + 1);
+            item = item.substr(0, semicolon);
+        }
+        const auto trim = [](std::string_view value) {
+            while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+                value.remove_prefix(1);
+            }
+            while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+                value.remove_suffix(1);
+            }
+            return value;
+        };
+        item = trim(item);
+        params = trim(params);
+
+        // q=0, q=0.0, q=0.000 — кодировка запрещена
+        bool zero = false;
+        if (params.size() >= 2 && (params[0] == 'q' || params[0] == 'Q') && params[1] == '=') {
+            const std::string_view value = params.substr(2);
+            zero = !value.empty() && value.find_first_not_of("0.") == std::string_view::npos;
+        }
+
+        if (item == "*") {
+            wildcard = !zero;
+            continue;
+        }
+        for (size_t i = 0; i < ContentEncodingCount; ++i) {
+            if (HttpRequestView::EqualsIgnoreCase(item, ContentEncodings[i].name)
+                || (i == static_cast<size_t>(ContentEncoding::Gzip) && HttpRequestView::EqualsIgnoreCase(item, "x-gzip"))) {
+                (zero ? rejected : accepted) |= 1u << i;
+            }
+        }
+    }
+    if (wildcard) {
+        accepted |= ~rejected & ((1u << ContentEncodingCount) - 1);
+    }
+    return (accepted & ~rejected) | EncodingBit(ContentEncoding::Identity);
+}
+
+// Сжимать на лету имеет смысл только текст: картинки и архивы уже сжаты
+inline bool IsCompressible(std::string_view mimeType)
+{
+    return mimeType.starts_with("text/") || mimeType == "application/javascript" || mimeType == "application/json"
+        || mimeType == "image/svg+xml";
+}
+
+// Сжатие в формат gzip с максимальной степенью: результат кэшируется, поэтому время сжатия не важно.
+// std::nullopt — сжатие не удалось или не уменьшило размер
+inline std::optional<std::string> GzipCompress(std::string_view data)
+{
+    z_stream stream{};
+    // 15 + 16: окно 32 КиБ и обёртка gzip вместо zlib
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return std::nullopt;
+    }
+    std::string out(deflateBound(&stream, static_cast<uLong>(data.size())), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(out.data());
+    stream.avail_out = static_cast<uInt>(out.size());
+    const int result = deflate(&stream, Z_FINISH);
+    const size_t size = stream.total_out;
+    deflateEnd(&stream);
+    if (result != Z_STREAM_END || size >= data.size()) {
+        return std::nullopt;
+    }
+    out.resize(size);
+    return out;
+}
@@ -0,0 +1,457 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <poll.h>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "../../lib/FileDesc.h"
+#include "../../lib/HttpRange.h"
+#include "../../lib/Logger.h"
+#include "ContentEncoding.h"
+
+// Представление файла в одной кодировке: из этих сведений строятся заголовки ответов 200, 206 и 304
+struct FileRepresentation
+{
+    std::string_view mimeType;
+    std::string_view encoding;
+    std::string etag;
+    std::string lastModified;
+    uint64_t size = 0;
+
+    // ETag из времени изменения и размера, как у nginx, плюс кодировка: у сжатого тела свой ETag
+    FileRepresentation(std::string_view mimeType, ContentEncoding encoding, const struct stat& st)
+        : mimeType(mimeType)
+        , size(static_cast<uint64_t>(st.st_size))
+    {
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "%llx.%lx-%llx", static_cast<unsigned long long>(st.st_mtim.tv_sec),
+                 static_cast<unsigned long>(st.st_mtim.tv_nsec), static_cast<unsigned long long>(st.st_size));
+        etag = "\"" + std::string(buffer);
+        if (encoding != ContentEncoding::Identity) {
+            this->encoding = GetEncodingInfo(encoding).name;
+            etag += "-" + std::string(this->encoding);
+        }
+        etag += "\"";
+        lastModified = HttpRange::FormatHttpDate(st.st_mtim.tv_sec);
+    }
+
+    // headers — строки Content-Type, Content-Length и Content-Range, остальные заголовки общие
+    std::string Head(std::string_view status, std::string_view headers, bool keepAlive) const
+    {
+        std::string head = "HTTP/1.1 " + std::string(status) + "\r\n";
+        head += headers;
+        if (!encoding.empty()) {
+            head += "Content-Encoding: " + std::string(encoding) + "\r\n";
+        }
+        head += "ETag: " + etag + "\r\n";
+        head += "Last-Modified: " + lastModified + "\r\n";
+        head += "Accept-Ranges: bytes\r\n";
+        head += "Vary: Accept-Encoding\r\n";
+        head += keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+        return head;
+    }
+
+    std::string FullHead(bool keepAlive) const
+    {
+        return Head("200 OK", "Content-Type: " + std::string(mimeType) + "\r\nContent-Length: " + std::to_string(size) + "\r\n",
+                    keepAlive);
+    }
+};
+
+// Тело в одной кодировке вместе с готовыми заголовками ответа 200 для обоих вариантов Connection
+struct CachedVariant
+{
+    std::optional<FileRepresentation> info;
+    std::string keepAliveHead;
+    std::string closeHead;
+    std::string body;
+
+    bool Available() const
+    {
+        return info.has_value();
+    }
+
+    const std::string& Head(bool keepAlive) const
+    {
+        return keepAlive ? keepAliveHead : closeHead;
+    }
+};
+
+// Файл в памяти во всех кодировках, какие удалось получить: из соседних .br/.gz или сжатием на лету
+struct CachedFile
+{
+    std::array<CachedVariant, ContentEncodingCount> variants;
+    size_t bytes = 0;
+
+    // Лучшая из кодировок, которые принимает клиент; identity есть всегда
+    const CachedVariant& Select(uint32_t accepted) const
+    {
+        for (size_t i = 0; i < ContentEncodingCount; ++i) {
+            if ((accepted & (1u << i)) && variants[i].Available()) {
+                return variants[i];
+            }
+        }
+        return variants[static_cast<size_t>(ContentEncoding::Identity)];
+    }
+};
+
+// Кэш небольших файлов каталога root в памяти, общий для всех потоков.
+// Попадание — поиск в таблице под разделяемой блокировкой, без выделений памяти и системных вызовов.
+// Изменённые, удалённые и переименованные файлы выбрасываются по событиям inotify,
+// а при нехватке бюджета — давно не запрашивавшиеся (LRU)
+class FileCache
+{
+public:
+    using Entry = std::shared_ptr<const CachedFile>;
+
+    static constexpr size_t DefaultBudget = 64 * 1024 * 1024;
+    // Крупные файлы выгоднее отдавать через sendfile из страничного кэша ядра
+    static constexpr size_t MaxFileSize = 1024 * 1024;
+
+    explicit FileCache(std::string root, size_t budget = DefaultBudget)
+        : m_root(std::move(root))
+        , m_budget(budget)
+        , m_inotify(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+        , m_stop(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+    {
+        if (!m_inotify.IsOpen() || !m_stop.IsOpen()) {
+            throw std::system_error(errno, std::generic_category());
+        }
+        Watch("");
+        m_watcher = std::thread([this] { WatchLoop(); });
+    }
+
+    FileCache(const FileCache&) = delete;
+    FileCache& operator=(const FileCache&) = delete;
+
+    ~FileCache()
+    {
+        const uint64_t one = 1;
+        [[maybe_unused]] auto _ = write(m_stop.Get(), &one, sizeof(one));
+        m_watcher.join();
+    }
+
+    Entry Find(std::string_view path) const
+    {
+        std::shared_lock lock(m_mutex);
+        const auto it = m_entries.find(path);
+        if (it == m_entries.end()) {
+            return nullptr;
+        }
+        Touch(it->second);
+        return it->second.file;
+    }
+
+    // Читает уже открытый файл и запоминает его вместе со сжатыми вариантами, вытесняя давно не использованные.
+    // Если файл поменялся, пока читался, запись не сохраняется, но результат всё равно годится для текущего ответа.
+    // nullptr — файл в кэш не попадёт: слишком велик, не прочитался или его уже загружает другой поток.
+    // Тогда ответ идёт с диска через sendfile, и файл не сжимается на каждый такой запрос
+    Entry Load(const std::string& path, const FileDesc& fd, const struct stat& st, std::string_view mimeType)
+    {
+        const auto size = static_cast<size_t>(st.st_size);
+        if (size > MaxFileSize || size > m_budget) {
+            return nullptr;
+        }
+
+        uint64_t generation;
+        {
+            std::unique_lock lock(m_mutex);
+            if (const auto it = m_entries.find(path); it != m_entries.end()) {
+                return it->second.file;
+            }
+            if (!m_loading.insert(path).second) {
+                return nullptr;
+            }
+            generation = m_generation.load(std::memory_order_relaxed);
+        }
+
+        Entry file;
+        try
+        {
+            file = Read(path, fd, st, mimeType);
+        }
+        catch (...)
+        {
+            std::unique_lock lock(m_mutex);
+            m_loading.erase(path);
+            throw;
+        }
+
+        std::unique_lock lock(m_mutex);
+        m_loading.erase(path);
+        // Событие inotify могло прийти между чтением и вставкой — тогда прочитанное уже может быть устаревшим
+        if (file && m_generation.load(std::memory_order_relaxed) == generation && file->bytes <= m_budget
+            && m_entries.find(path) == m_entries.end()) {
+            Evict(file->bytes);
+            m_entries.try_emplace(path, file, Now());
+            m_size += file->bytes;
+        }
+        return file;
+    }
+
+private:
+    // Время последнего попадания хранится с точностью до секунды и пишется не чаще раза в секунду:
+    // иначе популярный файл гонял бы строку кэша процессора между потоками на каждом запросе
+    static constexpr int64_t TouchGranularityMs = 1000;
+
+    struct Slot
+    {
+        Slot(Entry file, int64_t lastUsed)
+            : file(std::move(file))
+            , lastUsed(lastUsed)
+        {
+        }
+
+        Entry file;
+        // Обновляется под разделяемой блокировкой
+        mutable std::atomic<int64_t> lastUsed;
+    };
+
+    struct StringHash
+    {
+        using is_transparent = void;
+
+        size_t operator()(std::string_view value) const
+        {
+            return std::hash<std::string_view>{}(value);
+        }
+    };
+
+    static int64_t Now()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    static void Touch(const Slot& slot)
+    {
+        const int64_t now = Now();
+        if (now - slot.lastUsed.load(std::memory_order_relaxed) >= TouchGranularityMs) {
+            slot.lastUsed.store(now, std::memory_order_relaxed);
+        }
+    }
+
+    // Освобождает место под needed байт, начиная с давно не использованных файлов. Вызывается под m_mutex.
+    // Освобождается с запасом в восьмую часть бюджета, чтобы сортировка не повторялась на каждой вставке
+    void Evict(size_t needed)
+    {
+        if (m_size + needed <= m_budget) {
+            return;
+        }
+        const size_t target = m_budget - std::min(m_budget, needed + m_budget / 8);
+        std::vector<std::pair<int64_t, std::string_view>> candidates;
+        candidates.reserve(m_entries.size());
+        for (const auto& [path, slot] : m_entries) {
+            candidates.emplace_back(slot.lastUsed.load(std::memory_order_relaxed), path);
+        }
+        std::sort(candidates.begin(), candidates.end());
+        for (const auto& candidate : candidates) {
+            if (m_size <= target) {
+                break;
+            }
+            Erase(candidate.second);
+        }
+    }
+
+    Entry Read(const std::string& path, const FileDesc& fd, const struct stat& st, std::string_view mimeType) const
+    {
+        const auto size = static_cast<size_t>(st.st_size);
+        auto file = std::make_shared<CachedFile>();
+        auto& identity = file->variants[static_cast<size_t>(ContentEncoding::Identity)];
+        if (!ReadAll(fd, size, identity.body)) {
+            return nullptr;
+        }
+        identity.info.emplace(mimeType, ContentEncoding::Identity, st);
+        for (const ContentEncoding encoding : { ContentEncoding::Brotli, ContentEncoding::Gzip }) {
+            auto& variant = file->variants[static_cast<size_t>(encoding)];
+            struct stat siblingStat{};
+            if (ReadSibling(path + std::string(GetEncodingInfo(encoding).suffix), variant.body, siblingStat)) {
+                variant.info.emplace(mimeType, encoding, siblingStat);
+            } else if (encoding == ContentEncoding::Gzip && IsCompressible(mimeType)) {
+                if (auto compressed = GzipCompress(identity.body)) {
+                    variant.body = std::move(*compressed);
+                    variant.info.emplace(mimeType, encoding, st);
+                    variant.info->size = variant.body.size();
+                }
+            }
+        }
+        for (auto& variant : file->variants) {
+            if (!variant.Available()) {
+                continue;
+            }
+            variant.keepAliveHead = variant.info->FullHead(true);
+            variant.closeHead = variant.info->FullHead(false);
+            file->bytes += variant.body.size();
+        }
+        return file;
+    }
+
+    static bool ReadAll(const FileDesc& fd, size_t size, std::string& out)
+    {
+        out.resize(size);
+        size_t done = 0;
+        while (done < size) {
+            const ssize_t bytesRead = pread(fd.Get(), out.data() + done, size - done, static_cast<off_t>(done));
+            if (bytesRead <= 0) {
+                return false;
+            }
+            done += static_cast<size_t>(bytesRead);
+        }
+        return true;
+    }
+
+    // Заранее сжатый файл рядом с исходным; false — его нет или он не подходит для кэша
+    bool ReadSibling(const std::string& path, std::string& out, struct stat& st) const
+    {
+        const FileDesc fd(open((m_root + path).c_str(), O_RDONLY | O_CLOEXEC));
+        if (!fd.IsOpen() || fstat(fd.Get(), &st) != 0 || !S_ISREG(st.st_mode)
+            || static_cast<size_t>(st.st_size) > MaxFileSize) {
+            return false;
+        }
+        if (!ReadAll(fd, static_cast<size_t>(st.st_size), out)) {
+            out.clear();
+            return false;
+        }
+        return true;
+    }
+
+    // dir — путь относительно root в том же виде, что и ключи кэша ("" или "/sub")
+    void Watch(const std::string& dir)
+    {
+        const std::string fullPath = m_root + dir;
+        const int wd = inotify_add_watch(m_inotify.Get(), fullPath.c_str(),
+                                         IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_DELETE | IN_MOVED_FROM
+                                         | IN_MOVED_TO | IN_CREATE | IN_DELETE_SELF | IN_MOVE_SELF);
+        if (wd == -1) {
+            LOG_WARNING("Server", "Cannot watch " + fullPath + " for changes: " + std::strerror(errno));
+            return;
+        }
+        m_watches[wd] = dir;
+
+        // Подкаталоги тоже отслеживаются: inotify не рекурсивен
+        DIR* handle = opendir(fullPath.c_str());
+        if (!handle) {
+            return;
+        }
+        while (const dirent* entry = readdir(handle)) {
+            const std::string name = entry->d_name;
+            if (entry->d_type == DT_DIR && name != "." && name != "..") {
+                Watch(dir + "/" + name);
+            }
+        }
+        closedir(handle);
+    }
+
+    void WatchLoop()
+    {
+        alignas(inotify_event) char buffer[16384];
+        pollfd fds[2] = { { m_inotify.Get(), POLLIN, 0 }, { m_stop.Get(), POLLIN, 0 } };
+        while (true) {
+            if (poll(fds, 2, -1) == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                LOG_ERROR("Server", "File cache watcher stopped: " + std::string(std::strerror(errno)));
+                Clear();
+                return;
+            }
+            if (fds[1].revents != 0) {
+                return;
+            }
+            ssize_t length;
+            while ((length = read(m_inotify.Get(), buffer, sizeof(buffer))) > 0) {
+                for (char* ptr = buffer; ptr < buffer + length;) {
+                    const auto* event = reinterpret_cast<const inotify_event*>(ptr);
+                    OnEvent(*event);
+                    ptr += sizeof(inotify_event) + event->len;
+                }
+            }
+        }
+    }
+
+    void OnEvent(const inotify_event& event)
+    {
+        const auto watch = m_watches.find(event.wd);
+        if ((event.mask & IN_Q_OVERFLOW) || watch == m_watches.end()
+            || (event.mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED))) {
+            // События потеряны или исчез целый каталог — проще начать кэш заново
+            Clear();
+            if (event.mask & IN_IGNORED) {
+                m_watches.erase(event.wd);
+            }
+            return;
+        }
+        const std::string path = watch->second + "/" + event.name;
+        if ((event.mask & IN_ISDIR) && (event.mask & (IN_CREATE | IN_MOVED_TO))) {
+            Watch(path);
+        }
+        if (event.mask & IN_ISDIR) {
+            // Переименованный или удалённый каталог уносит с собой все вложенные пути
+            Clear();
+            return;
+        }
+        std::unique_lock lock(m_mutex);
+        m_generation.fetch_add(1, std::memory_order_release);
+        Erase(path);
+        // Появившийся, изменённый или удалённый x.css.gz меняет варианты x.css
+        for (const auto& info : ContentEncodings) {
+            if (!info.suffix.empty() && path.ends_with(info.suffix)) {
+                Erase(std::string_view(path).substr(0, path.size() - info.suffix.size()));
+            }
+        }
+    }
+
+    void Erase(std::string_view path)
+    {
+        const auto it = m_entries.find(path);
+        if (it != m_entries.end()) {
+            m_size -= it->second.file->bytes;
+            m_entries.erase(it);
+        }
+    }
+
+    void Clear()
+    {
+        std::unique_lock lock(m_mutex);
+        m_generation.fetch_add(1, std::memory_order_release);
+        m_entries.clear();
+        m_size = 0;
+    }
+
+    std::string m_root;
+    size_t m_budget;
+    FileDesc m_inotify;
+    FileDesc m_stop;
+
+    mutable std::shared_mutex m_mutex;
+    std::unordered_map<std::string, Slot, StringHash, std::equal_to<>> m_entries;
+    size_t m_size = 0;
+    // Файлы, которые сейчас читает и сжимает какой-то поток: второй запрос не сжимает то же самое параллельно
+    std::unordered_set<std::string> m_loading;
+    std::atomic<uint64_t> m_generation = 0;
+
+    // Только для потока наблюдателя (и конструктора до его запуска)
+    std::unordered_map<int, std::string> m_watches;
+    std::thread m_watcher;
+};
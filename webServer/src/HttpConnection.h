@@ -0,0 +1,300 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "../../lib/EventLoop.h"
+#include "../../lib/HttpParser.h"
+#include "../../lib/Logger.h"
+#include "../../lib/Socket.h"
+#include "StaticFiles.h"
+
+// Соединение с клиентом как конечный автомат поверх EventLoop. Соединение живёт между запросами (keep-alive),
+// запросы могут идти конвейером (pipelining): ответы встают в очередь и уходят строго по порядку.
+// Запрос может прийти по частям, а ответ — уйти не целиком: состояние хранится между событиями цикла
+class HttpConnection : public std::enable_shared_from_this<HttpConnection>
+{
+public:
+    HttpConnection(EventLoop& loop, Socket socket, const StaticFiles& files)
+        : m_loop(loop)
+        , m_socket(std::move(socket))
+        , m_files(files)
+    {
+    }
+
+    void Start()
+    {
+        auto self = shared_from_this();
+        m_loop.Add(m_socket.Get(), 0, [self](uint32_t events) {
+            self->OnEvent(events);
+        });
+        // Чтение отдано циклу: с io_uring данные приходят готовыми из кольца буферов, без вызова read на каждую порцию
+        m_loop.AddReceiver(m_socket.Get(), [self](const char* data, ssize_t size) {
+            self->OnData(data, size);
+        });
+        m_lastActivity = Clock::now();
+        ArmIdleTimer(IdleTimeout);
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // Сколько ответов может ждать отправки; пока очередь полна, новые запросы не читаются
+    static constexpr size_t MaxQueuedResponses = 16;
+    // Соединение, по которому ничего не читается и не пишется, закрывается
+    static constexpr std::chrono::seconds IdleTimeout{ 30 };
+    // Заголовок запроса должен прийти целиком за это время, даже если клиент шлёт его по байту (slowloris)
+    static constexpr std::chrono::seconds HeaderTimeout{ 10 };
+
+    // Таймер не переставляется на каждое чтение и запись: они только отмечают время,
+    // а сработавший таймер заводится заново на оставшийся срок
+    void ArmIdleTimer(Clock::duration delay)
+    {
+        std::weak_ptr<HttpConnection> weak = weak_from_this();
+        const auto ms = std::chrono::ceil<std::chrono::milliseconds>(delay);
+        m_idleTimer = m_loop.RunAfter(ms, [weak] {
+            if (auto self = weak.lock()) {
+                self->OnIdleTimer();
+            }
+        });
+    }
+
+    void OnIdleTimer()
+    {
+        m_idleTimer = 0;
+        if (m_closed) {
+            return;
+        }
+        const auto now = Clock::now();
+        Clock::time_point deadline = m_lastActivity + IdleTimeout;
+        if (m_headerStart != Clock::time_point{}) {
+            deadline = std::min(deadline, m_headerStart + HeaderTimeout);
+        }
+        if (now >= deadline) {
+            LOG_DEBUG("Server", "Closing idle connection");
+            Close();
+            return;
+        }
+        ArmIdleTimer(deadline - now);
+    }
+
+    void OnEvent(uint32_t events)
+    {
+        try
+        {
+            if (events & EPOLLERR) {
+                Close();
+                return;
+            }
+            Flush();
+        }
+        catch (const std::exception& e)
+        {
+            LOG_ERROR("Server", "Error handling client: " + std::string(e.what()));
+            Close();
+        }
+    }
+
+    void OnData(const char* data, ssize_t size)
+    {
+        try
+        {
+            if (size < 0) {
+                Close();
+                return;
+            }
+            if (size == 0) {
+                m_peerClosed = true;
+            } else {
+                m_lastActivity = Clock::now();
+                m_input.append(data, static_cast<size_t>(size));
+                ProcessRequests();
+            }
+            Flush();
+        }
+        catch (const std::exception& e)
+        {
+            LOG_ERROR("Server", "Error handling client: " + std::string(e.what()));
+            Close();
+        }
+    }
+
+    // Разбирает все запросы, которые уже целиком лежат в буфере
+    void ProcessRequests()
+    {
+        while (!m_closing && m_responses.size() < MaxQueuedResponses && m_inputPos < m_input.size()) {
+            const std::string_view pending = std::string_view(m_input).substr(m_inputPos);
+            const auto result = m_parser.Parse(pending);
+            if (result == HttpRequestParser::Result::Incomplete) {
+                if (m_headerStart == Clock::time_point{}) {
+                    // Срок заголовка короче срока простоя: таймер переводится на него
+                    m_headerStart = Clock::now();
+                    m_loop.CancelTimer(m_idleTimer);
+                    ArmIdleTimer(HeaderTimeout);
+                }
+                break;
+            }
+            m_headerStart = {};
+            if (result == HttpRequestParser::Result::Error) {
+                LOG_WARNING("Server", "Invalid or unsupported request.");
+                m_responses.push_back(StaticFiles::Error("400 Bad Request", "Bad Request", false));
+                m_closing = true;
+                break;
+            }
+
+            const HttpRequestView& request = m_parser.Request();
+            bool keepAlive = KeepAlive(request);
+            if (HasBody(request)) {
+                // Тела запросов GET не поддерживаются: где кончается тело, а где следующий запрос, не разобрать
+                keepAlive = false;
+                m_responses.push_back(StaticFiles::Error("400 Bad Request", "Request body is not supported", false));
+            } else {
+                m_responses.push_back(m_files.Serve(request, keepAlive));
+            }
+            m_closing = !keepAlive;
+
+            m_inputPos += m_parser.Consumed();
+            m_parser.Reset();
+        }
+
+        if (m_inputPos == m_input.size()) {
+            m_input.clear();
+            m_inputPos = 0;
+        } else if (m_inputPos > m_input.size() / 2) {
+            m_input.erase(0, m_inputPos);
+            m_inputPos = 0;
+        }
+    }
+
+    // Отправляет ответы по порядку. Освободившееся место в очереди сразу занимают запросы, уже лежащие в буфере
+    void Flush()
+    {
+        bool blocked = false;
+        while (!blocked && !m_responses.empty()) {
+            blocked = !SendFront();
+            if (!blocked && m_responses.empty()) {
+                ProcessRequests();
+            }
+        }
+
+        if (m_responses.empty() && (m_closing || m_peerClosed)) {
+            Close();
+            return;
+        }
+        const uint32_t events = blocked ? uint32_t{ EPOLLOUT } : 0;
+        if (events != m_events) {
+            m_loop.Modify(m_socket.Get(), events);
+            m_events = events;
+        }
+        m_loop.SetReceiving(m_socket.Get(), !m_closing && !m_peerClosed && m_responses.size() < MaxQueuedResponses);
+    }
+
+    // false — сокет заполнен, ответ отправлен не целиком.
+    // Ответ уходит кусками: заголовок с основным телом, затем части parts, у каждой свой заголовок и диапазон
+    bool SendFront()
+    {
+        HttpResponse& response = m_responses.front();
+        const std::string& head = response.head.empty() && response.variant
+            ? response.variant->Head(response.keepAlive)
+            : response.head;
+        while (m_partIndex <= response.parts.size()) {
+            bool sent;
+            if (m_partIndex == 0) {
+                sent = SendPart(response, head, response.offset, response.end);
+            } else {
+                const RangePart& part = response.parts[m_partIndex - 1];
+                sent = SendPart(response, part.head, static_cast<off_t>(part.offset), static_cast<off_t>(part.end));
+            }
+            if (!sent) {
+                return false;
+            }
+            ++m_partIndex;
+            m_sentPos = 0;
+        }
+        m_responses.pop_front();
+        m_partIndex = 0;
+        return true;
+    }
+
+    // Заголовок и тело из памяти уходят одним вызовом; m_sentPos — позиция в их общей последовательности
+    bool SendPart(const HttpResponse& response, std::string_view prefix, off_t begin, off_t end)
+    {
+        const size_t length = prefix.size() + static_cast<size_t>(end - begin);
+        while (m_sentPos < length) {
+            const size_t bodyPos = m_sentPos > prefix.size() ? m_sentPos - prefix.size() : 0;
+            std::optional<size_t> sent;
+            if (response.variant || m_sentPos < prefix.size()) {
+                iovec iov[2];
+                size_t count = 0;
+                if (m_sentPos < prefix.size()) {
+                    iov[count++] = { const_cast<char*>(prefix.data()) + m_sentPos, prefix.size() - m_sentPos };
+                }
+                if (response.variant && begin + static_cast<off_t>(bodyPos) < end) {
+                    char* data = const_cast<char*>(response.variant->body.data()) + begin + bodyPos;
+                    iov[count++] = { data, static_cast<size_t>(end - begin) - bodyPos };
+                }
+                sent = m_socket.TrySendV(iov, count);
+            } else {
+                off_t offset = begin + static_cast<off_t>(bodyPos);
+                sent = m_socket.TrySendFile(response.file.Get(), offset, static_cast<size_t>(end - offset));
+                if (sent && *sent == 0) {
+                    throw std::runtime_error("File truncated while sending");
+                }
+            }
+            if (!sent) {
+                return false;
+            }
+            m_sentPos += *sent;
+            m_lastActivity = Clock::now();
+        }
+        return true;
+    }
+
+    static bool KeepAlive(const HttpRequestView& request)
+    {
+        const std::string_view connection = request.Header("Connection");
+        if (request.version == "HTTP/1.0") {
+            return HttpRequestView::EqualsIgnoreCase(connection, "keep-alive");
+        }
+        return !HttpRequestView::EqualsIgnoreCase(connection, "close");
+    }
+
+    static bool HasBody(const HttpRequestView& request)
+    {
+        const std::string_view length = request.Header("Content-Length");
+        return !request.Header("Transfer-Encoding").empty() || (!length.empty() && length != "0");
+    }
+
+    void Close()
+    {
+        if (m_closed) {
+            return;
+        }
+        m_closed = true;
+        m_loop.CancelTimer(m_idleTimer);
+        m_loop.Remove(m_socket.Get());
+    }
+
+    EventLoop& m_loop;
+    Socket m_socket;
+    const StaticFiles& m_files;
+
+    std::string m_input;
+    size_t m_inputPos = 0;
+    HttpRequestParser m_parser;
+
+    std::deque<HttpResponse> m_responses;
+    size_t m_partIndex = 0;
+    size_t m_sentPos = 0;
+
+    uint32_t m_events = 0;
+    EventLoop::TimerId m_idleTimer = 0;
+    Clock::time_point m_lastActivity;
+    // Когда начал приходить ещё не дочитанный запрос; пустое значение — такого нет
+    Clock::time_point m_headerStart;
+    bool m_peerClosed = false;
+    bool m_closing = false;
+    bool m_closed = false;
+};
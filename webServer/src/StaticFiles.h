@@ -0,0 +1,276 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/stat.h>
+#include <utility>
+#include <vector>
+#include "../../lib/FileDesc.h"
+#include "../../lib/HttpParser.h"
+#include "../../lib/HttpRange.h"
+#include "../../lib/Logger.h"
+#include "ContentEncoding.h"
+#include "FileCache.h"
+
+// Готовый ответ: заголовок и тело — кусок [offset, end) варианта файла из кэша или файла на диске,
+// а для нескольких диапазонов ещё и части parts из того же источника.
+// Пустой head у ответа из кэша — готовый заголовок варианта с нужным Connection; cached держит variant живым
+struct HttpResponse
+{
+    std::string head;
+    FileCache::Entry cached;
+    const CachedVariant* variant = nullptr;
+    bool keepAlive = false;
+    FileDesc file;
+    off_t offset = 0;
+    off_t end = 0;
+    std::vector<RangePart> parts;
+};
+
+// Отдача файлов из каталога root. Общий для всех потоков: кэш файлов сам следит за согласованностью
+class StaticFiles
+{
+public:
+    explicit StaticFiles(std::string root)
+        : m_root(std::move(root))
+        , m_cache(m_root)
+    {
+    }
+
+    HttpResponse Serve(const HttpRequestView& request, bool keepAlive) const
+    {
+        std::string normalized;
+        const std::string_view path = ParseRequestPath(request, normalized);
+        if (path.empty()) {
+            return Error("400 Bad Request", "Bad Request", keepAlive);
+        }
+        const uint32_t accepted = ParseAcceptEncoding(request.Header("Accept-Encoding"));
+
+        // Попадание в кэш без условий и диапазонов не выделяет память и не обращается к файловой системе
+        if (auto cached = m_cache.Find(path)) {
+            LOG_DEBUG("Server", "GET " + std::string(path) + " -> 200 OK (cached)");
+            return FromCache(request, std::move(cached), accepted, keepAlive);
+        }
+
+        const std::string filePath = m_root + std::string(path);
+        try
+        {
+            FileDesc file;
+            struct stat st = OpenFile(filePath, file);
+            const std::string_view mimeType = GetMimeType(path);
+            LOG_DEBUG("Server", "GET " + std::string(path) + " -> 200 OK, " + std::to_string(st.st_size) + " bytes");
+
+            if (auto cached = m_cache.Load(std::string(path), file, st, mimeType)) {
+                return FromCache(request, std::move(cached), accepted, keepAlive);
+            }
+
+            // Крупный файл сжимать на каждый запрос дорого: отдаётся только заранее сжатый, если он есть
+            ContentEncoding encoding = ContentEncoding::Identity;
+            for (const ContentEncoding candidate : { ContentEncoding::Brotli, ContentEncoding::Gzip }) {
+                if (!(accepted & EncodingBit(candidate))) {
+                    continue;
+                }
+                try
+                {
+                    FileDesc sibling;
+                    st = OpenFile(filePath + std::string(GetEncodingInfo(candidate).suffix), sibling);
+                    file = std::move(sibling);
+                    encoding = candidate;
+                    break;
+                }
+                catch (const std::runtime_error&)
+                {
+                }
+            }
+
+            HttpResponse response;
+            response.file = std::move(file);
+            response.keepAlive = keepAlive;
+            return Respond(request, FileRepresentation(mimeType, encoding, st), std::move(response));
+        }
+        catch (const std::runtime_error& e)
+        {
+            LOG_INFO("Server", "GET " + std::string(path) + " -> 404 Not Found (" + e.what() + ")");
+            return Error("404 Not Found", "File Not Found", keepAlive);
+        }
+    }
+
+    static HttpResponse Error(const std::string& status, const std::string& body, bool keepAlive)
+    {
+        HttpResponse response;
+        response.head = "HTTP/1.1 " + status + "\r\n";
+        response.head += "Content-Type: text/plain\r\n";
+        response.head += "Content-Length: " + std::to_string(body.length()) + "\r\n";
+        response.head += ConnectionHeader(keepAlive);
+        response.head += "\r\n";
+        response.head += body;
+        return response;
+    }
+
+private:
+    static HttpResponse FromCache(const HttpRequestView& request, FileCache::Entry cached, uint32_t accepted,
+                                  bool keepAlive)
+    {
+        const CachedVariant& variant = cached->Select(accepted);
+        return Respond(request, *variant.info,
+                       HttpResponse{ .head = {},
+                                     .cached = std::move(cached),
+                                     .variant = &variant,
+                                     .keepAlive = keepAlive,
+                                     .file = {},
+                                     .offset = 0,
+                                     .end = 0,
+                                     .parts = {} });
+    }
+
+    // Условный GET и диапазоны (RFC 9110, 13.2.2): сначала If-None-Match/If-Modified-Since, затем Range с If-Range
+    static HttpResponse Respond(const HttpRequestView& request, const FileRepresentation& info, HttpResponse response)
+    {
+        const bool keepAlive = response.keepAlive;
+        if (HttpRange::IsNotModified(request, info.etag, info.lastModified)) {
+            response.head = info.Head("304 Not Modified", "", keepAlive);
+            response.variant = nullptr;
+            response.file.Close();
+            return response;
+        }
+
+        const auto ranges = HttpRange::Parse(request, info.size, info.etag, info.lastModified);
+        if (!ranges) {
+            if (!response.variant) {
+                response.head = info.FullHead(keepAlive);
+            }
+            response.end = static_cast<off_t>(info.size);
+            return response;
+        }
+        if (ranges->empty()) {
+            response.head = info.Head("416 Range Not Satisfiable",
+                                      "Content-Range: bytes */" + std::to_string(info.size) + "\r\nContent-Length: 0\r\n",
+                                      keepAlive);
+            response.variant = nullptr;
+            response.file.Close();
+            return response;
+        }
+        if (ranges->size() == 1) {
+            const ByteRange& range = ranges->front();
+            response.head = info.Head("206 Partial Content",
+                                      "Content-Type: " + std::string(info.mimeType) + "\r\n"
+                                      + "Content-Length: " + std::to_string(range.last - range.first + 1) + "\r\n"
+                                      + "Content-Range: " + HttpRange::ContentRange(range, info.size) + "\r\n",
+                                      keepAlive);
+            response.offset = static_cast<off_t>(range.first);
+            response.end = static_cast<off_t>(range.last + 1);
+            return response;
+        }
+
+        const std::string boundary = HttpRange::MakeBoundary();
+        uint64_t length = 0;
+        response.parts = HttpRange::Multipart(*ranges, info.size, info.mimeType, boundary, length);
+        response.head = info.Head("206 Partial Content",
+                                  "Content-Type: multipart/byteranges; boundary=" + boundary + "\r\n"
+                                  + "Content-Length: " + std::to_string(length) + "\r\n",
+                                  keepAlive);
+        return response;
+    }
+
+    // Путь в том же виде, что и ключи кэша и пути из событий inotify: без query, пустых сегментов и ".".
+    // Иначе "/./index.html" и "//index.html" стали бы отдельными записями кэша, которые inotify не сбрасывает.
+    // Канонический путь возвращается без копии, остальные собираются в storage. Пустой результат — запрос не обслуживается
+    static std::string_view ParseRequestPath(const HttpRequestView& request, std::string& storage)
+    {
+        if (request.method != "GET") {
+            return ""; // Поддерживаем только GET
+        }
+
+        std::string_view path = request.target.substr(0, request.target.find('?'));
+        if (path.empty() || path.front() != '/') {
+            return "";
+        }
+
+        bool canonical = true;
+        for (size_t begin = 1; begin <= path.size();) {
+            const size_t end = std::min(path.find('/', begin), path.size());
+            const std::string_view segment = path.substr(begin, end - begin);
+            if (segment == "..") {
+                return "";
+            }
+            if (segment == "." || (segment.empty() && end < path.size())) {
+                canonical = false;
+            }
+            begin = end + 1;
+        }
+
+        if (!canonical) {
+            storage.clear();
+            for (size_t begin = 1; begin <= path.size();) {
+                const size_t end = std::min(path.find('/', begin), path.size());
+                const std::string_view segment = path.substr(begin, end - begin);
+                if (!segment.empty() && segment != ".") {
+                    storage += '/';
+                    storage += segment;
+                }
+                begin = end + 1;
+            }
+            // Завершающий "/" или "/." означает каталог
+            if (storage.empty() || path.back() == '/' || path.ends_with("/.")) {
+                storage += '/';
+            }
+            path = storage;
+        }
+
+        if (path == "/") {
+            path = "/index.html";
+        }
+        return path;
+    }
+
+    static std::string_view GetMimeType(std::string_view path)
+    {
+        static constexpr std::array<std::pair<std::string_view, std::string_view>, 6> types{ {
+            { ".html", "text/html" },
+            { ".css", "text/css" },
+            { ".js", "application/javascript" },
+            { ".jpg", "image/jpeg" },
+            { ".jpeg", "image/jpeg" },
+            { ".png", "image/png" },
+        } };
+        const size_t dot = path.rfind('.');
+        if (dot != std::string_view::npos) {
+            const std::string_view extension = path.substr(dot);
+            for (const auto& [ext, type] : types) {
+                if (ext == extension) {
+                    return type;
+                }
+            }
+        }
+        return "application/octet-stream";
+    }
+
+    // Явный заголовок нужен клиентам HTTP/1.0: без него они считают, что соединение закроется
+    static std::string ConnectionHeader(bool keepAlive)
+    {
+        return keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+    }
+
+    // Крупный файл не читается в память: тело уходит в сокет через sendfile
+    static struct stat OpenFile(const std::filesystem::path& file_path, FileDesc& fd)
+    {
+        fd = FileDesc(open(file_path.c_str(), O_RDONLY | O_CLOEXEC));
+        if (!fd.IsOpen()) {
+            throw std::runtime_error("Could not open file");
+        }
+
+        struct stat st{};
+        if (fstat(fd.Get(), &st) != 0 || !S_ISREG(st.st_mode)) {
+            throw std::runtime_error("Could not read file");
+        }
+
+        return st;
+    }
+
+    std::string m_root;
+    // Сам кэш потокобезопасен, а Serve логически ничего не меняет
+    mutable FileCache m_cache;
+};
@@ -0,0 +1,237 @@
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../../../lib/HttpParser.h"
+#include "../../../lib/HttpRange.h"
+
+// Проверка разбора запросов на входе, который присылает клиент: заголовок, пришедший частями,
+// слишком длинный заголовок, obs-fold и повторяющиеся заголовки, затем Range, If-Range и ETag.
+// Код возврата 1 — хотя бы одна проверка не прошла
+
+namespace
+{
+
+int failures = 0;
+
+void Check(const bool ok, const std::string& what)
+{
+    if (!ok)
+    {
+        std::cerr << "FAIL: " << what << std::endl;
+        ++failures;
+    }
+}
+
+using Result = HttpRequestParser::Result;
+
+// Разбор буфера, который дочитывается по step байт, как из сокета
+Result ParseInSteps(HttpRequestParser& parser, std::string& buffer, std::string_view input, const size_t step)
+{
+    Result result = Result::Incomplete;
+    for (size_t pos = 0; pos < input.size() && result == Result::Incomplete; pos += step)
+    {
+        buffer.append(input.substr(pos, step));
+        result = parser.Parse(buffer);
+    }
+    return result;
+}
+
+Result ParseWhole(std::string_view input)
+{
+    HttpRequestParser parser;
+    return parser.Parse(input);
+}
+
+void CheckSplitHeads()
+{
+    const std::string head = "GET /index.html HTTP/1.1\r\nHost: example.com\r\nAccept:  */* \r\n\r\n";
+    const std::string next = "GET /next HTTP/1.1\r\n\r\n";
+    for (size_t step = 1; step <= head.size(); ++step)
+    {
+        HttpRequestParser parser;
+        std::string buffer;
+        const Result result = ParseInSteps(parser, buffer, head + next, step);
+        const std::string where = " (step " + std::to_string(step) + ")";
+        Check(result == Result::Complete, "split head completes" + where);
+        if (result != Result::Complete)
+        {
+            continue;
+        }
+        const HttpRequestView& request = parser.Request();
+        Check(parser.Consumed() == head.size(), "consumed covers only the first head" + where);
+        Check(request.method == "GET" && request.target == "/index.html" && request.version == "HTTP/1.1",
+              "request line" + where);
+        Check(request.Header("host") == "example.com", "header lookup ignores case" + where);
+        Check(request.Header("Accept") == "*/*", "value is trimmed" + where);
+    }
+
+    Check(ParseWhole("GET / HTTP/1.1\r\nHost: a") == Result::Incomplete, "head without terminator is incomplete");
+    Check(ParseWhole("GET / HTTP/1.1\r\nHost: a\r\n") == Result::Incomplete, "head without empty line is incomplete");
+    Check(ParseWhole("\r\n\r\nGET / HTTP/1.1\r\n\r\n") == Result::Complete, "leading empty lines are skipped");
+    Check(ParseWhole("GET / HTTP/1.1\n\n") == Result::Complete, "bare LF line endings");
+    Check(ParseWhole("GET /\r\n\r\n") == Result::Error, "request line without version");
+    Check(ParseWhole("GET  HTTP/1.1\r\n\r\n") == Result::Error, "request line without target");
+    Check(ParseWhole("GET / HTTP/1.1\r\nNoColon\r\n\r\n") == Result::Error, "header without colon");
+    Check(ParseWhole("GET / HTTP/1.1\r\n: value\r\n\r\n") == Result::Error, "header without name");
+}
+
+void CheckOversizeHeads()
+{
+    const std::string big(HttpRequestParser::MaxHeadSize, 'a');
+    Check(ParseWhole("GET / HTTP/1.1\r\nX: " + big) == Result::Error, "oversize head without terminator");
+    Check(ParseWhole("GET / HTTP/1.1\r\nX: " + big + "\r\n\r\n") == Result::Error,
+          "oversize head in one read is rejected too");
+    {
+        HttpRequestParser parser;
+        std::string buffer;
+        Check(ParseInSteps(parser, buffer, "GET / HTTP/1.1\r\nX: " + big + "\r\n\r\n", 1000) == Result::Error,
+              "oversize head read in parts");
+    }
+
+    std::string manyHeaders = "GET / HTTP/1.1\r\n";
+    for (size_t i = 0; i <= HttpRequestView::MaxHeaders; ++i)
+    {
+        manyHeaders += "X-" + std::to_string(i) + ": 1\r\n";
+    }
+    Check(ParseWhole(manyHeaders + "\r\n") == Result::Error, "more than MaxHeaders headers");
+}
+
+void CheckHeaderFolding()
+{
+    Check(ParseWhole("GET / HTTP/1.1\r\nX-A: 1\r\n continued\r\n\r\n") == Result::Error, "obs-fold with SP");
+    Check(ParseWhole("GET / HTTP/1.1\r\nX-A: 1\r\n\tcontinued\r\n\r\n") == Result::Error, "obs-fold with HT");
+    // Свёрнутая строка с двоеточием не должна стать отдельным заголовком
+    Check(ParseWhole("GET / HTTP/1.1\r\nX-A: 1\r\n Host: evil\r\n\r\n") == Result::Error, "obs-fold with a colon");
+    Check(ParseWhole("GET / HTTP/1.1\r\nHost : a\r\n\r\n") == Result::Error, "whitespace before colon");
+}
+
+void CheckDuplicateHeaders()
+{
+    HttpRequestParser parser;
+    Check(parser.Parse("GET / HTTP/1.1\r\nAccept: a\r\naccept: b\r\n\r\n") == Result::Complete,
+          "repeated list header is allowed");
+    Check(parser.Request().Header("Accept") == "a", "first occurrence wins");
+
+    // Разные части цепочки могли бы выбрать разные значения (RFC 9112, 3.2 и 6.3)
+    Check(ParseWhole("GET / HTTP/1.1\r\nHost: a\r\nHost: b\r\n\r\n") == Result::Error, "duplicate Host");
+    Check(ParseWhole("GET / HTTP/1.1\r\nHost: a\r\nhost: a\r\n\r\n") == Result::Error, "duplicate Host, other case");
+    Check(ParseWhole("GET / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\n") == Result::Error,
+          "duplicate Content-Length");
+}
+
+using Ranges = std::optional<std::vector<ByteRange>>;
+
+bool Same(const Ranges& actual, const std::vector<ByteRange>& expected)
+{
+    if (!actual || actual->size() != expected.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < expected.size(); ++i)
+    {
+        if ((*actual)[i].first != expected[i].first || (*actual)[i].last != expected[i].last)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void CheckRanges()
+{
+    Check(Same(HttpRange::Parse("bytes=0-0", 10), { { 0, 0 } }), "single first byte");
+    Check(Same(HttpRange::Parse("bytes=2-", 10), { { 2, 9 } }), "open-ended range");
+    Check(Same(HttpRange::Parse("bytes=5-100", 10), { { 5, 9 } }), "last is clamped to the body");
+    Check(Same(HttpRange::Parse("bytes=-3", 10), { { 7, 9 } }), "suffix range");
+    Check(Same(HttpRange::Parse("bytes=-30", 10), { { 0, 9 } }), "suffix longer than the body");
+    Check(Same(HttpRange::Parse("Bytes=1-2", 10), { { 1, 2 } }), "unit is case-insensitive");
+    Check(!HttpRange::Parse("bytes 1-2", 10), "unit without '=' is not a range");
+
+    // Пустой список — 416, nullopt — тело целиком
+    Check(Same(HttpRange::Parse("bytes=-0", 10), {}), "bytes=-0 is unsatisfiable");
+    Check(Same(HttpRange::Parse("bytes=10-", 10), {}), "range past the end is unsatisfiable");
+    Check(Same(HttpRange::Parse("bytes=-1", 0), {}), "suffix of an empty body is unsatisfiable");
+    Check(!HttpRange::Parse("bytes=3-1", 10), "reversed range is ignored");
+    Check(!HttpRange::Parse("bytes=a-b", 10), "non-numeric range is ignored");
+    Check(!HttpRange::Parse("bytes=99999999999999999999-", 10), "overlong number is ignored");
+    Check(!HttpRange::Parse("items=0-1", 10), "other unit is ignored");
+    Check(!HttpRange::Parse("bytes=", 10), "empty range set is ignored");
+
+    Check(Same(HttpRange::Parse("bytes=6-7, 0-1", 10), { { 6, 7 }, { 0, 1 } }), "disjoint ranges keep their order");
+    Check(Same(HttpRange::Parse("bytes=0-4,2-6", 10), { { 0, 6 } }), "overlapping ranges are coalesced");
+    Check(Same(HttpRange::Parse("bytes=0-,0-,0-,0-", 10), { { 0, 9 } }), "repeated whole-body ranges are coalesced");
+    Check(Same(HttpRange::Parse("bytes=8-9,-5,0-1", 10), { { 0, 1 }, { 5, 9 } }), "suffix overlapping a range");
+
+    std::string many = "bytes=";
+    for (size_t i = 0; i < HttpRange::MaxRanges; ++i)
+    {
+        many += std::to_string(i * 2) + "-" + std::to_string(i * 2) + ",";
+    }
+    Check(HttpRange::Parse(many, 100).value_or(std::vector<ByteRange>{}).size() == HttpRange::MaxRanges,
+          "MaxRanges ranges are served");
+    Check(!HttpRange::Parse(many + "90-91", 100), "more than MaxRanges ranges get the whole body");
+}
+
+// Запрос с заголовками; буфер должен жить, пока используется результат
+HttpRequestView Request(std::string& buffer, const std::string& headers)
+{
+    buffer = "GET / HTTP/1.1\r\n" + headers + "\r\n";
+    HttpRequestParser parser;
+    Check(parser.Parse(buffer) == HttpRequestParser::Result::Complete, "request parses: " + headers);
+    return parser.Request();
+}
+
+void CheckConditions()
+{
+    const std::string date = "Sun, 06 Nov 1994 08:49:37 GMT";
+    std::string buffer;
+
+    Check(HttpRange::Parse(Request(buffer, "Range: bytes=0-1\r\nIf-Range: \"v1\"\r\n"), 10, "\"v1\"", "").has_value(),
+          "If-Range with the same strong ETag");
+    Check(!HttpRange::Parse(Request(buffer, "Range: bytes=0-1\r\nIf-Range: \"v2\"\r\n"), 10, "\"v1\"", ""),
+          "If-Range with another ETag");
+    Check(!HttpRange::Parse(Request(buffer, "Range: bytes=0-1\r\nIf-Range: W/\"v1\"\r\n"), 10, "W/\"v1\"", ""),
+          "If-Range never matches a weak ETag");
+    Check(!HttpRange::Parse(Request(buffer, "Range: bytes=0-1\r\nIf-Range: \"v1\"\r\n"), 10, "W/\"v1\"", ""),
+          "If-Range strong tag against a weak resource ETag");
+    Check(!HttpRange::Parse(Request(buffer, "Range: bytes=0-1\r\nIf-Range: \"v1\"\r\n"), 10, "", date),
+          "If-Range ETag without a resource ETag");
+    Check(HttpRange::Parse(Request(buffer, "Range: bytes=0-1\r\nIf-Range: " + date + "\r\n"), 10, "", date).has_value(),
+          "If-Range with the same date");
+    Check(!HttpRange::Parse(Request(buffer, "Range: bytes=0-1\r\nIf-Range: Mon, 07 Nov 1994 08:49:37 GMT\r\n"), 10,
+                            "", date),
+          "If-Range with another date");
+
+    Check(HttpRange::IsNotModified(Request(buffer, "If-None-Match: W/\"v1\"\r\n"), "\"v1\"", ""),
+          "If-None-Match compares weakly");
+    Check(HttpRange::IsNotModified(Request(buffer, "If-None-Match: \"v0\", W/\"v1\"\r\n"), "W/\"v1\"", ""),
+          "If-None-Match list");
+    Check(HttpRange::IsNotModified(Request(buffer, "If-None-Match: *\r\n"), "\"v1\"", ""), "If-None-Match: *");
+    Check(!HttpRange::IsNotModified(Request(buffer, "If-None-Match: \"v2\"\r\nIf-Modified-Since: " + date + "\r\n"),
+                                    "\"v1\"", date),
+          "If-None-Match takes precedence over If-Modified-Since");
+    Check(HttpRange::IsNotModified(Request(buffer, "If-Modified-Since: " + date + "\r\n"), "", date),
+          "If-Modified-Since with the same date");
+    Check(!HttpRange::IsNotModified(Request(buffer, "If-Modified-Since: garbage\r\n"), "", date),
+          "malformed If-Modified-Since");
+}
+
+}
+
+int main()
+{
+    CheckSplitHeads();
+    CheckOversizeHeads();
+    CheckHeaderFolding();
+    CheckDuplicateHeaders();
+    CheckRanges();
+    CheckConditions();
+    if (failures > 0)
+    {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "all checks passed" << std::endl;
+    return 0;
+}
@@ -1,66 +1,62 @@
+#include <algorithm>
+#include <csignal>
 #include <iostream>
+#include <memory>
 #include <string>
-#include <fstream>
-#include <sstream>
+#include <string_view>
+#include <thread>
 #include <vector>
-#include <stdexcept>
-#include <filesystem>
 #include "../../lib/Acceptor.h"
+#include "../../lib/EventLoop.h"
+#include "../../lib/Logger.h"
+#include "HttpConnection.h"
+#include "StaticFiles.h"
 
 constexpr int PORT = 8080;
 const std::string WEB_ROOT = "www";
 
-std::string ParseRequestPath(const std::string& request_str)
+// Каждый поток держит свой слушающий сокет (SO_REUSEPORT) и свой цикл событий,
+// поэтому медленный клиент задерживает только свои запросы, а не весь сервер
+void RunWorker(const sockaddr_in& addr, const StaticFiles& files, IoBackend backend)
 {
-    std::istringstream request_stream(request_str);
-    std::string method, path;
-    request_stream >> method >> path;
-
-    if (method != "GET") {
-        return ""; // Поддерживаем только GET
-    }
-
-    if (path == "/") {
-        path = "/index.html";
-    }
-
-    if (path.find("..") != std::string::npos) {
-        return "";
+    EventLoop loop(backend);
+    if (backend == IoBackend::Uring && !loop.UsesIoUring()) {
+        LOG_WARNING("Server", "io_uring is not supported by the kernel, falling back to epoll");
     }
+    Acceptor acceptor(addr, SOMAXCONN, /*reusePort*/ true);
+    acceptor.SetNonBlocking();
 
-    return path;
-}
+    loop.AddAcceptor(acceptor.Get(), [&](FileDesc client) {
+        try
+        {
+            LOG_DEBUG("Server", "New connection accepted");
+            std::make_shared<HttpConnection>(loop, Socket{ std::move(client) }, files)->Start();
+        }
+        catch (const std::exception& e)
+        {
+            LOG_ERROR("Server", "Error accepting client: " + std::string(e.what()));
+        }
+    });
 
-std::string GetMimeType(const std::string& path)
-{
-    if (path.ends_with(".html")) return "text/html";
-    if (path.ends_with(".css")) return "text/css";
-    if (path.ends_with(".js")) return "application/javascript";
-    if (path.ends_with(".jpg") || path.ends_with(".jpeg")) return "image/jpeg";
-    if (path.ends_with(".png")) return "image/png";
-    return "application/octet-stream";
+    loop.Run();
 }
 
-std::vector<char> ReadFile(const std::filesystem::path& file_path)
+int main(int argc, char* argv[])
 {
-    std::ifstream file(file_path, std::ios::binary | std::ios::ate);
-    if (!file.is_open()) {
-        throw std::runtime_error("Could not open file");
-    }
-
-    std::streamsize size = file.tellg();
-    file.seekg(0, std::ios::beg);
-
-    std::vector<char> buffer(size);
-    if (!file.read(buffer.data(), size)) {
-        throw std::runtime_error("Could not read file");
+    // Клиент может закрыть соединение посреди sendfile — это не повод завершать сервер
+    std::signal(SIGPIPE, SIG_IGN);
+
+    unsigned workers = std::max(1u, std::thread::hardware_concurrency());
+    IoBackend backend = IoBackend::Epoll;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (arg == "--io-uring") {
+            backend = IoBackend::Uring;
+        } else {
+            workers = static_cast<unsigned>(std::max(1, std::stoi(argv[i])));
+        }
     }
 
-    return buffer;
-}
-
-int main()
-{
     try
     {
         sockaddr_in server_addr{};
@@ -68,69 +64,30 @@ int main()
         server_addr.sin_port = htons(PORT);
         server_addr.sin_addr.s_addr = INADDR_ANY;
 
-        Acceptor acceptor(server_addr, 10);
-        std::cout << "Server started on port " << PORT << ". Waiting for connections..." << std::endl;
-        std::cout << "Serving files from directory: '" << WEB_ROOT << "'" << std::endl;
-
-        while (true)
-        {
-            try
-            {
-                Socket clientSocket = acceptor.Accept();
-                std::cout << "\n--- New connection accepted ---" << std::endl;
-
-                char buffer[4096];
-                size_t bytesRead = clientSocket.Read(buffer, sizeof(buffer) - 1);
-                buffer[bytesRead] = '\0';
-                std::string requestStr(buffer);
-
-                std::string path = ParseRequestPath(requestStr);
-                if (path.empty()) {
-                    std::cout << "Invalid or unsupported request." << std::endl;
-                    continue;
-                }
-
-                std::filesystem::path filePath = WEB_ROOT + path;
-                std::cout << "Requested file: " << filePath << std::endl;
+        // Первый сокет создаётся в главном потоке, чтобы ошибка bind всплыла до старта воркеров
+        { Acceptor probe(server_addr, SOMAXCONN, /*reusePort*/ true); }
 
-                std::stringstream response;
+        const StaticFiles files(WEB_ROOT);
+        LOG_INFO("Server", "Server started on port " + std::to_string(PORT) + " with "
+                 + std::to_string(workers) + " event loops. Waiting for connections...");
+        LOG_INFO("Server", "Serving files from directory: '" + WEB_ROOT + "'");
 
+        std::vector<std::thread> threads;
+        for (unsigned i = 0; i < workers; ++i) {
+            threads.emplace_back([server_addr, &files, backend] {
                 try
                 {
-                    auto fileContent = ReadFile(filePath);
-                    std::string mimeType = GetMimeType(filePath.string());
-
-                    response << "HTTP/1.1 200 OK\r\n";
-                    response << "Content-Type: " << mimeType << "\r\n";
-                    response << "Content-Length: " << fileContent.size() << "\r\n";
-                    response << "\r\n";
-
-                    clientSocket.Send(response.str().c_str(), response.str().length(), 0);
-                    clientSocket.Send(fileContent.data(), fileContent.size(), 0);
-
-                    std::cout << "Sent response: 200 OK, " << fileContent.size() << " bytes" << std::endl;
+                    RunWorker(server_addr, files, backend);
                 }
-                catch (const std::runtime_error& e)
+                catch (const std::exception& e)
                 {
-                    std::cerr << "Error: " << e.what() << " for file " << filePath << std::endl;
-
-                    std::string body = "File Not Found";
-                    response << "HTTP/1.1 404 Not Found\r\n";
-                    response << "Content-Type: text/plain\r\n";
-                    response << "Content-Length: " << body.length() << "\r\n";
-                    response << "\r\n";
-                    response << body;
-
-                    clientSocket.Send(response.str().c_str(), response.str().length(), 0);
-                    std::cout << "Sent response: 404 Not Found" << std::endl;
+                    std::cerr << "Fatal error: " << e.what() << std::endl;
+                    std::exit(1);
                 }
-
-                std::cout << "--- Connection closed ---" << std::endl;
-            }
-            catch (const std::exception& e)
-            {
-                std::cerr << "Error handling client: " << e.what() << std::endl;
-            }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
         }
     }
     catch (const std::system_error& e)
@@ -140,4 +97,4 @@ int main()
     }
 
     return 0;
-}
\ No newline at end of file
+}